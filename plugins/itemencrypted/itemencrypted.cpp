@@ -37,13 +37,22 @@
 #endif
 
 #include <QAbstractItemModel>
+#include <QCoreApplication>
 #include <QDir>
+#include <QEvent>
 #include <QIODevice>
 #include <QLabel>
 #include <QModelIndex>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QSaveFile>
 #include <QTextEdit>
+#include <QThreadPool>
 #include <QtPlugin>
 #include <QVBoxLayout>
+#include <QVector>
+#include <QWaitCondition>
 
 namespace {
 
@@ -54,6 +63,11 @@ const char dataFileHeaderV2[] = "CopyQ_encrypted_tab v2";
 
 const int maxItemCount = 10000;
 
+// Limit data waiting to be passed to GnuPG process.
+const qint64 maxGpgInputBufferSize = 1024 * 1024;
+
+const int gpgTimeoutMs = 30000;
+
 struct KeyPairPaths {
     KeyPairPaths()
     {
@@ -195,6 +209,287 @@ QByteArray readGpgOutput(const QStringList &args, const QByteArray &input = QByt
     return p.readAllStandardOutput();
 }
 
+/**
+ * Passes data to GnuPG process and handles available output.
+ *
+ * Waits while too much data is buffered so the whole input
+ * is not kept in memory.
+ */
+template <typename OutputHandler>
+bool writeGpgInput(QProcess *p, const QByteArray &bytes, int timeoutMs, OutputHandler handleOutput)
+{
+    p->write(bytes);
+
+    while ( p->bytesToWrite() > maxGpgInputBufferSize ) {
+        if ( !p->waitForBytesWritten(timeoutMs) || !handleOutput(p->readAllStandardOutput()) )
+            return false;
+    }
+
+    return handleOutput( p->readAllStandardOutput() );
+}
+
+/// Closes input of GnuPG process and handles remaining output.
+template <typename OutputHandler>
+bool finishGpgProcess(QProcess *p, int timeoutMs, OutputHandler handleOutput)
+{
+    p->closeWriteChannel();
+
+    while ( p->waitForReadyRead(timeoutMs) ) {
+        if ( !handleOutput(p->readAllStandardOutput()) )
+            return false;
+    }
+
+    return verifyProcess(p, timeoutMs) && handleOutput( p->readAllStandardOutput() );
+}
+
+template <typename T>
+QByteArray toBytes(const T &value)
+{
+    QByteArray bytes;
+    QDataStream stream(&bytes, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_4_7);
+    stream << value;
+    return bytes;
+}
+
+/**
+ * Parses items as soon as enough decrypted data is available.
+ */
+class DecryptedItemsParser final {
+public:
+    explicit DecryptedItemsParser(int maxItems)
+        : m_maxItems(maxItems)
+    {
+    }
+
+    bool addData(const QByteArray &bytes)
+    {
+        m_bytes.append(bytes);
+
+        // Avoid parsing incomplete item again until enough data is available.
+        if ( m_bytes.size() - m_offset < 2 * m_incompleteSize )
+            return true;
+
+        return parse(false);
+    }
+
+    bool finish()
+    {
+        if ( m_bytes.isEmpty() ) {
+            COPYQ_LOG("ItemEncrypt ERROR: Failed to read encrypted data.");
+            return false;
+        }
+
+        return parse(true);
+    }
+
+    /// Returns items parsed since last call.
+    QVector<QVariantMap> takeItems()
+    {
+        QVector<QVariantMap> items;
+        items.swap(m_items);
+        return items;
+    }
+
+private:
+    bool parse(bool atEnd)
+    {
+        if (m_offset > m_bytes.size() / 2) {
+            m_bytes.remove(0, m_offset);
+            m_offset = 0;
+        }
+
+        QDataStream stream(m_bytes);
+        stream.setVersion(QDataStream::Qt_4_7);
+        stream.skipRawData(m_offset);
+
+        while (m_count == -1 || m_row < m_count) {
+            if (m_count == -1)
+                parseItemCount(&stream);
+            else
+                parseItem(&stream);
+
+            if ( stream.status() == QDataStream::ReadPastEnd ) {
+                if (!atEnd) {
+                    m_incompleteSize = m_bytes.size() - m_offset;
+                    return true;
+                }
+
+                COPYQ_LOG("ItemEncrypt ERROR: Decrypted data are incomplete!");
+                return false;
+            }
+
+            if ( stream.status() != QDataStream::Ok )
+                return false;
+
+            m_offset = static_cast<int>( stream.device()->pos() );
+            m_incompleteSize = 0;
+        }
+
+        return true;
+    }
+
+    void parseItemCount(QDataStream *stream)
+    {
+        quint64 length;
+        *stream >> length;
+        if ( stream->status() == QDataStream::ReadPastEnd )
+            return;
+
+        if ( stream->status() != QDataStream::Ok ) {
+            COPYQ_LOG("ItemEncrypt ERROR: Failed to parse item count!");
+            return;
+        }
+
+        length = qMin(length, static_cast<quint64>(m_maxItems));
+        m_count = length < maxItemCount ? static_cast<int>(length) : maxItemCount;
+    }
+
+    void parseItem(QDataStream *stream)
+    {
+        QVariantMap dataMap;
+        *stream >> dataMap;
+        if ( stream->status() == QDataStream::ReadPastEnd )
+            return;
+
+        if ( stream->status() != QDataStream::Ok ) {
+            COPYQ_LOG("ItemEncrypt ERROR: Failed to decrypt item!");
+            return;
+        }
+
+        m_items.append(dataMap);
+        ++m_row;
+    }
+
+    int m_maxItems;
+    int m_count = -1;
+    int m_row = 0;
+    QByteArray m_bytes;
+    int m_offset = 0;
+    int m_incompleteSize = 0;
+    QVector<QVariantMap> m_items;
+};
+
+/**
+ * Decrypts tab data (without header).
+ *
+ * Items are passed to handler as soon as they are decrypted
+ * to avoid keeping whole tab in memory.
+ */
+template <typename ItemsHandler>
+bool decryptItems(const QByteArray &encryptedBytes, int maxItems, ItemsHandler handleItems)
+{
+    importGpgKey();
+
+    DecryptedItemsParser parser(maxItems);
+    const auto addDecryptedData = [&](const QByteArray &bytes) {
+        return parser.addData(bytes) && handleItems( parser.takeItems() );
+    };
+
+    QProcess p;
+    startGpgProcess( &p, QStringList("--decrypt"), QIODevice::ReadWrite );
+
+    const int chunkSize = static_cast<int>(maxGpgInputBufferSize);
+    for (int i = 0; i < encryptedBytes.size(); i += chunkSize) {
+        // Wait for password entry dialog.
+        const auto bytes = encryptedBytes.mid(i, chunkSize);
+        if ( !writeGpgInput(&p, bytes, -1, addDecryptedData) )
+            return false;
+    }
+
+    return finishGpgProcess(&p, -1, addDecryptedData)
+            && parser.finish()
+            && handleItems( parser.takeItems() );
+}
+
+/// Encrypts items and writes the tab data to file.
+bool encryptItems(const QVector<QVariantMap> &items, QIODevice *file)
+{
+    QDataStream stream(file);
+    stream.setVersion(QDataStream::Qt_4_7);
+    stream << QString(dataFileHeaderV2);
+
+    // Items are passed to GnuPG one by one and encrypted data are written
+    // to the file as soon as available to avoid keeping whole tab in memory.
+    qint64 encryptedSize = 0;
+    const auto writeEncryptedData = [&](const QByteArray &bytes) {
+        encryptedSize += bytes.size();
+        return stream.writeRawData( bytes.constData(), bytes.size() ) == bytes.size();
+    };
+
+    QProcess p;
+    startGpgProcess( &p, QStringList("--encrypt"), QIODevice::ReadWrite );
+
+    bool ok = writeGpgInput( &p, toBytes(static_cast<quint64>(items.size())), gpgTimeoutMs, writeEncryptedData );
+
+    for (int i = 0; ok && i < items.size(); ++i)
+        ok = writeGpgInput( &p, toBytes(items[i]), gpgTimeoutMs, writeEncryptedData );
+
+    if ( !ok || !finishGpgProcess(&p, gpgTimeoutMs, writeEncryptedData) || encryptedSize == 0 ) {
+        COPYQ_LOG("ItemEncrypt ERROR: Failed to read encrypted data");
+        return false;
+    }
+
+    if ( stream.status() != QDataStream::Ok ) {
+        COPYQ_LOG("ItemEncrypt ERROR: Failed to write encrypted data");
+        return false;
+    }
+
+    return true;
+}
+
+/// Appends decrypted items to model.
+void addDecryptedItems(QAbstractItemModel *model, const QVector<QVariantMap> &items, int maxItems)
+{
+    for (const auto &dataMap : items) {
+        const int row = model->rowCount();
+        if (row >= maxItems)
+            return;
+
+        if ( !model->insertRow(row) ) {
+            COPYQ_LOG("ItemEncrypt ERROR: Failed to insert item!");
+            return;
+        }
+
+        model->setData( model->index(row, 0), dataMap, contentType::data );
+    }
+}
+
+QVector<QVariantMap> itemsToSave(const QAbstractItemModel &model)
+{
+    QVector<QVariantMap> items;
+    items.reserve( model.rowCount() );
+    for (int row = 0; row < model.rowCount(); ++row)
+        items.append( model.index(row, 0).data(contentType::data).toMap() );
+    return items;
+}
+
+const QEvent::Type itemsDecryptedEventType =
+        static_cast<QEvent::Type>(QEvent::registerEventType());
+
+const QEvent::Type decryptFinishedEventType =
+        static_cast<QEvent::Type>(QEvent::registerEventType());
+
+const QEvent::Type decryptFailedEventType =
+        static_cast<QEvent::Type>(QEvent::registerEventType());
+
+const QEvent::Type encryptFailedEventType =
+        static_cast<QEvent::Type>(QEvent::registerEventType());
+
+class ItemsDecryptedEvent final : public QEvent {
+public:
+    explicit ItemsDecryptedEvent(const QVector<QVariantMap> &items)
+        : QEvent(itemsDecryptedEventType)
+        , m_items(items)
+    {
+    }
+
+    const QVector<QVariantMap> &items() const { return m_items; }
+
+private:
+    QVector<QVariantMap> m_items;
+};
+
 bool keysExist()
 {
     return !readGpgOutput( QStringList("--list-keys") ).isEmpty();
@@ -215,7 +510,7 @@ bool encryptMimeData(const QVariantMap &data, const QModelIndex &index, QAbstrac
     QVariantMap dataToEncrypt;
     QVariantMap dataMap;
     for (auto it = data.constBegin(); it != data.constEnd(); ++it) {
-        if ( it.key().startsWith(COPYQ_MIME_PREFIX) )
+        if ( isInternalFormat(it.key()) )
             dataMap.insert(it.key(), it.value());
         else
             dataToEncrypt.insert(it.key(), it.value());
@@ -285,53 +580,217 @@ ItemEncrypted::ItemEncrypted(QWidget *parent)
     layout->addWidget(iconWidget);
 }
 
-bool ItemEncryptedSaver::saveItems(const QString &, const QAbstractItemModel &model, QIODevice *file)
+/**
+ * Receiver of items decrypted in background and of errors.
+ *
+ * The saver is unset in ItemEncryptedSaver destructor so the events are not
+ * posted to destroyed object and decryption of unloaded tab is interrupted.
+ */
+struct ItemEncryptedSaver::Receiver {
+    QMutex mutex;
+    ItemEncryptedSaver *saver = nullptr;
+    /// Number of tab files not yet written in background.
+    int pendingSaveCount = 0;
+    QWaitCondition saved;
+};
+
+namespace {
+
+/// Returns false if the saver was already destroyed.
+bool postToSaver(const std::shared_ptr<ItemEncryptedSaver::Receiver> &receiver, QEvent *event)
 {
-    const auto length = model.rowCount();
-    if (length == 0)
-        return false; // No need to encode empty tab.
+    QMutexLocker lock(&receiver->mutex);
+    if (!receiver->saver) {
+        delete event;
+        return false;
+    }
 
-    QByteArray bytes;
+    QCoreApplication::postEvent(receiver->saver, event);
+    return true;
+}
 
+class DecryptTabTask final : public QRunnable {
+public:
+    DecryptTabTask(
+            const std::shared_ptr<ItemEncryptedSaver::Receiver> &receiver,
+            const QByteArray &encryptedBytes, int maxItems)
+        : m_receiver(receiver)
+        , m_encryptedBytes(encryptedBytes)
+        , m_maxItems(maxItems)
     {
-        QDataStream stream(&bytes, QIODevice::WriteOnly);
-        stream.setVersion(QDataStream::Qt_4_7);
+    }
+
+    void run() override
+    {
+        // Stop decrypting if the tab was unloaded.
+        const auto postItems = [&](const QVector<QVariantMap> &items) {
+            if ( items.isEmpty() ) {
+                QMutexLocker lock(&m_receiver->mutex);
+                return m_receiver->saver != nullptr;
+            }
+
+            return postToSaver( m_receiver, new ItemsDecryptedEvent(items) );
+        };
+
+        const bool ok = decryptItems(m_encryptedBytes, m_maxItems, postItems);
+        postToSaver( m_receiver, new QEvent(ok ? decryptFinishedEventType : decryptFailedEventType) );
+    }
 
-        stream << static_cast<quint64>(length);
+private:
+    std::shared_ptr<ItemEncryptedSaver::Receiver> m_receiver;
+    QByteArray m_encryptedBytes;
+    int m_maxItems;
+};
 
-        for (int i = 0; i < length && stream.status() == QDataStream::Ok; ++i) {
-            QModelIndex index = model.index(i, 0);
-            const QVariantMap dataMap = index.data(contentType::data).toMap();
-            stream << dataMap;
+class EncryptTabTask final : public QRunnable {
+public:
+    EncryptTabTask(
+            const std::shared_ptr<ItemEncryptedSaver::Receiver> &receiver,
+            const QString &tabFileName, const QVector<QVariantMap> &items)
+        : m_receiver(receiver)
+        , m_tabFileName(tabFileName)
+        , m_items(items)
+    {
+        QMutexLocker lock(&m_receiver->mutex);
+        ++m_receiver->pendingSaveCount;
+    }
+
+    void run() override
+    {
+        // Tab file is replaced only after all items are encrypted.
+        QSaveFile file(m_tabFileName);
+        if ( !file.open(QIODevice::WriteOnly) || !encryptItems(m_items, &file) || !file.commit() ) {
+            log( QString("ItemEncrypt ERROR: Failed to save \"%1\": %2")
+                 .arg(m_tabFileName, file.errorString()), LogError );
+            postToSaver( m_receiver, new QEvent(encryptFailedEventType) );
         }
+
+        QMutexLocker lock(&m_receiver->mutex);
+        --m_receiver->pendingSaveCount;
+        m_receiver->saved.wakeAll();
     }
 
-    bytes = readGpgOutput(QStringList("--encrypt"), bytes);
-    if ( bytes.isEmpty() ) {
-        emitEncryptFailed();
-        COPYQ_LOG("ItemEncrypt ERROR: Failed to read encrypted data");
+private:
+    std::shared_ptr<ItemEncryptedSaver::Receiver> m_receiver;
+    QString m_tabFileName;
+    QVector<QVariantMap> m_items;
+};
+
+} // namespace
+
+ItemEncryptedSaver::ItemEncryptedSaver(ItemEncryptedLoader *loader, QAbstractItemModel *model, int maxItems)
+    : m_loader(loader)
+    , m_model(model)
+    , m_maxItems(maxItems)
+    , m_receiver(std::make_shared<Receiver>())
+{
+    m_receiver->saver = this;
+
+    connect( model, &QAbstractItemModel::rowsInserted,
+             this, &ItemEncryptedSaver::onModelChanged );
+    connect( model, &QAbstractItemModel::rowsRemoved,
+             this, &ItemEncryptedSaver::onModelChanged );
+    connect( model, &QAbstractItemModel::rowsMoved,
+             this, &ItemEncryptedSaver::onModelChanged );
+    connect( model, &QAbstractItemModel::dataChanged,
+             this, &ItemEncryptedSaver::onModelChanged );
+}
+
+ItemEncryptedSaver::~ItemEncryptedSaver()
+{
+    QMutexLocker lock(&m_receiver->mutex);
+    m_receiver->saver = nullptr;
+}
+
+bool ItemEncryptedSaver::saveItems(const QString &, const QAbstractItemModel &model, QIODevice *file)
+{
+    if (m_decryptFailed) {
+        COPYQ_LOG("ItemEncrypt ERROR: Refusing to overwrite tab which failed to decrypt");
         return false;
     }
 
-    QDataStream stream(file);
-    stream.setVersion(QDataStream::Qt_4_7);
-    stream << QString(dataFileHeaderV2);
-    stream.writeRawData( bytes.data(), bytes.size() );
+    if (m_decrypting)
+        return false;
 
-    if ( stream.status() != QDataStream::Ok ) {
+    if ( !encryptItems(itemsToSave(model), file) ) {
         emitEncryptFailed();
-        COPYQ_LOG("ItemEncrypt ERROR: Failed to write encrypted data");
         return false;
     }
 
+    m_modified = false;
+    return true;
+}
+
+bool ItemEncryptedSaver::saveItemsInBackground(const QString &tabName, const QAbstractItemModel &model, const QString &tabFileName)
+{
+    if (m_decryptFailed || !m_loader)
+        return false;
+
+    // Items are saved only after all of them are decrypted
+    // (the delayed save is triggered by adding them).
+    if ( m_decrypting || (!m_modified && QFile::exists(tabFileName)) )
+        return true;
+
+    QThreadPool *pool = m_loader->tabThreadPool(tabName);
+    pool->start( new EncryptTabTask(m_receiver, tabFileName, itemsToSave(model)) );
+
+    m_modified = false;
     return true;
 }
 
+void ItemEncryptedSaver::waitForSavedItems()
+{
+    QMutexLocker lock(&m_receiver->mutex);
+    while (m_receiver->pendingSaveCount > 0)
+        m_receiver->saved.wait(&m_receiver->mutex);
+}
+
+void ItemEncryptedSaver::decryptItems(QThreadPool *pool, const QByteArray &encryptedBytes)
+{
+    m_decrypting = true;
+    m_modified = false;
+    pool->start( new DecryptTabTask(m_receiver, encryptedBytes, m_maxItems) );
+}
+
+void ItemEncryptedSaver::customEvent(QEvent *event)
+{
+    const auto type = event->type();
+    if (type == itemsDecryptedEventType) {
+        if (m_model) {
+            m_addingDecryptedItems = true;
+            addDecryptedItems( m_model, static_cast<ItemsDecryptedEvent*>(event)->items(), m_maxItems );
+            m_addingDecryptedItems = false;
+        }
+    } else if (type == decryptFinishedEventType) {
+        m_decrypting = false;
+    } else if (type == decryptFailedEventType) {
+        m_decrypting = false;
+        m_decryptFailed = true;
+        emitDecryptFailed();
+    } else if (type == encryptFailedEventType) {
+        m_modified = true;
+        emitEncryptFailed();
+    } else {
+        QObject::customEvent(event);
+    }
+}
+
+void ItemEncryptedSaver::onModelChanged()
+{
+    if (!m_addingDecryptedItems)
+        m_modified = true;
+}
+
 void ItemEncryptedSaver::emitEncryptFailed()
 {
     emit error( ItemEncryptedLoader::tr("Encryption failed!") );
 }
 
+void ItemEncryptedSaver::emitDecryptFailed()
+{
+    emit error( ItemEncryptedLoader::tr("Decryption failed!") );
+}
+
 bool ItemEncryptedScriptable::isEncrypted()
 {
     const auto args = currentArguments();
@@ -368,7 +827,7 @@ void ItemEncryptedScriptable::encryptItem()
     const auto formats = call("dataFormats").toList();
     for (const auto &formatValue : formats) {
         const auto format = formatValue.toString();
-        if ( !format.startsWith(COPYQ_MIME_PREFIX) ) {
+        if ( !isInternalFormat(format) ) {
             const auto data = call("data", QVariantList() << format).toByteArray();
             dataMap.insert(format, data);
         }
@@ -410,7 +869,7 @@ void ItemEncryptedScriptable::encryptItems()
         QVariantMap itemDataToEncrypt;
         const auto formats = itemData.keys();
         for (const auto &format : formats) {
-            if ( !format.startsWith(COPYQ_MIME_PREFIX) ) {
+            if ( !isInternalFormat(format) ) {
                 itemDataToEncrypt.insert(format, itemData[format]);
                 itemData.remove(format);
             }
@@ -566,6 +1025,10 @@ ItemEncryptedLoader::ItemEncryptedLoader()
 ItemEncryptedLoader::~ItemEncryptedLoader()
 {
     terminateGpgProcess();
+
+    // Tasks must not outlive the plugin library.
+    for (const auto &pool : m_tabThreadPools)
+        pool->waitForDone();
 }
 
 ItemWidget *ItemEncryptedLoader::create(const QVariantMap &data, QWidget *parent, bool) const
@@ -660,7 +1123,7 @@ bool ItemEncryptedLoader::canSaveItems(const QString &tabName) const
     return false;
 }
 
-ItemSaverPtr ItemEncryptedLoader::loadItems(const QString &, QAbstractItemModel *model, QIODevice *file, int maxItems)
+ItemSaverPtr ItemEncryptedLoader::loadItems(const QString &tabName, QAbstractItemModel *model, QIODevice *file, int maxItems)
 {
     // This is needed to skip header.
     if ( !canLoadItems(file) )
@@ -671,86 +1134,63 @@ ItemSaverPtr ItemEncryptedLoader::loadItems(const QString &, QAbstractItemModel
         return nullptr;
     }
 
-    importGpgKey();
-
-    QProcess p;
-    startGpgProcess( &p, QStringList("--decrypt"), QIODevice::ReadWrite );
-
-    char encryptedBytes[4096];
+    // Tab which should no longer be encrypted is re-saved by other plugin
+    // right after loading so all items need to be decrypted first.
+    if ( !canSaveItems(tabName) ) {
+        const auto addItems = [&](const QVector<QVariantMap> &items) {
+            addDecryptedItems(model, items, maxItems);
+            return true;
+        };
 
-    QDataStream stream(file);
-    while ( !stream.atEnd() ) {
-        const int bytesRead = stream.readRawData(encryptedBytes, 4096);
-        if (bytesRead == -1) {
+        if ( !decryptItems(file->readAll(), maxItems, addItems) ) {
             emitDecryptFailed();
-            COPYQ_LOG("ItemEncrypted ERROR: Failed to read encrypted data");
             return nullptr;
         }
-        p.write(encryptedBytes, bytesRead);
-    }
-
-    p.closeWriteChannel();
-
-    // Wait for password entry dialog.
-    p.waitForFinished(-1);
 
-    if ( !verifyProcess(&p) ) {
-        emitDecryptFailed();
-        return nullptr;
+        return createSaver(model, maxItems);
     }
 
-    const QByteArray bytes = p.readAllStandardOutput();
-    if ( bytes.isEmpty() ) {
-        emitDecryptFailed();
-        COPYQ_LOG("ItemEncrypt ERROR: Failed to read encrypted data.");
-        verifyProcess(&p);
-        return nullptr;
-    }
-
-    QDataStream stream2(bytes);
+    // Tab file is not replaced in background at this point since savers
+    // wait for saved items before the tab is unloaded.
+    QThreadPool *pool = tabThreadPool(tabName);
 
-    quint64 length;
-    stream2 >> length;
-    if ( length <= 0 || stream2.status() != QDataStream::Ok ) {
-        emitDecryptFailed();
-        COPYQ_LOG("ItemEncrypt ERROR: Failed to parse item count!");
-        return nullptr;
-    }
-    length = qMin(length, static_cast<quint64>(maxItems)) - static_cast<quint64>(model->rowCount());
-
-    const auto count = length < maxItemCount ? static_cast<int>(length) : maxItemCount;
-    for ( int i = 0; i < count && stream2.status() == QDataStream::Ok; ++i ) {
-        if ( !model->insertRow(i) ) {
+    QByteArray encryptedBytes;
+    const auto fileDevice = qobject_cast<QFileDevice*>(file);
+    if (fileDevice) {
+        QFile tabFile( fileDevice->fileName() );
+        if ( !tabFile.open(QIODevice::ReadOnly) || !canLoadItems(&tabFile) ) {
             emitDecryptFailed();
-            COPYQ_LOG("ItemEncrypt ERROR: Failed to insert item!");
+            COPYQ_LOG("ItemEncrypted ERROR: Failed to read encrypted data");
             return nullptr;
         }
-        QVariantMap dataMap;
-        stream2 >> dataMap;
-        model->setData( model->index(i, 0), dataMap, contentType::data );
-    }
-
-    if ( stream2.status() != QDataStream::Ok ) {
-        emitDecryptFailed();
-        COPYQ_LOG("ItemEncrypt ERROR: Failed to decrypt item!");
-        return nullptr;
+        encryptedBytes = tabFile.readAll();
+    } else {
+        encryptedBytes = file->readAll();
     }
 
-    return createSaver();
+    auto saver = createSaver(model, maxItems);
+    saver->decryptItems(pool, encryptedBytes);
+    return saver;
 }
 
-ItemSaverPtr ItemEncryptedLoader::initializeTab(const QString &, QAbstractItemModel *, int)
+ItemSaverPtr ItemEncryptedLoader::initializeTab(const QString &, QAbstractItemModel *model, int maxItems)
 {
     if (status() == GpgNotInstalled)
         return nullptr;
 
-    return createSaver();
+    return createSaver(model, maxItems);
 }
 
 QObject *ItemEncryptedLoader::tests(const TestInterfacePtr &test) const
 {
 #ifdef HAS_TESTS
+    QVariantMap settings;
+    settings["encrypt_tabs"] = QStringList()
+            << ItemEncryptedTests::testTab(1)
+            << ItemEncryptedTests::testTab(2);
+
     QObject *tests = new ItemEncryptedTests(test);
+    tests->setProperty("CopyQ_test_settings", settings);
     return tests;
 #else
     Q_UNUSED(test);
@@ -915,9 +1355,9 @@ void ItemEncryptedLoader::emitDecryptFailed()
     emit error( ItemEncryptedLoader::tr("Decryption failed!") );
 }
 
-ItemSaverPtr ItemEncryptedLoader::createSaver()
+std::shared_ptr<ItemEncryptedSaver> ItemEncryptedLoader::createSaver(QAbstractItemModel *model, int maxItems)
 {
-    auto saver = std::make_shared<ItemEncryptedSaver>();
+    auto saver = std::make_shared<ItemEncryptedSaver>(this, model, maxItems);
     connect( saver.get(), &ItemEncryptedSaver::error,
              this, &ItemEncryptedLoader::error );
     return saver;
@@ -947,3 +1387,14 @@ bool ItemEncryptedLoader::setData(const QVariantMap &data, const QModelIndex &in
 
     return encryptMimeData(data, index, model);
 }
+
+QThreadPool *ItemEncryptedLoader::tabThreadPool(const QString &tabName)
+{
+    auto &pool = m_tabThreadPools[tabName];
+    if (!pool) {
+        pool = std::make_shared<QThreadPool>();
+        pool->setMaxThreadCount(1);
+    }
+
+    return pool.get();
+}
@@ -23,6 +23,8 @@
 #include "item/itemwidget.h"
 #include "gui/icons.h"
 
+#include <QHash>
+#include <QPointer>
 #include <QProcess>
 #include <QWidget>
 
@@ -32,7 +34,9 @@ namespace Ui {
 class ItemEncryptedSettings;
 }
 
+class ItemEncryptedLoader;
 class QIODevice;
+class QThreadPool;
 
 class ItemEncrypted final : public QWidget, public ItemWidget
 {
@@ -42,18 +46,60 @@ public:
     explicit ItemEncrypted(QWidget *parent);
 };
 
+/**
+ * Saves encrypted tab in background.
+ *
+ * Items are encrypted and decrypted in thread pool of the tab
+ * (see ItemEncryptedLoader::tabThreadPool()) so GnuPG does not block UI
+ * and multiple tabs can be processed at the same time.
+ */
 class ItemEncryptedSaver final : public QObject, public ItemSaverInterface
 {
     Q_OBJECT
 
 public:
+    struct Receiver;
+
+    ItemEncryptedSaver(ItemEncryptedLoader *loader, QAbstractItemModel *model, int maxItems);
+
+    ~ItemEncryptedSaver();
+
     bool saveItems(const QString &tabName, const QAbstractItemModel &model, QIODevice *file) override;
 
+    bool saveItemsInBackground(const QString &tabName, const QAbstractItemModel &model, const QString &tabFileName) override;
+
+    void waitForSavedItems() override;
+
+    /**
+     * Decrypts tab data in background and appends items to the model.
+     *
+     * Items are not saved until all of them are decrypted.
+     */
+    void decryptItems(QThreadPool *pool, const QByteArray &encryptedBytes);
+
 signals:
     void error(const QString &);
 
+protected:
+    void customEvent(QEvent *event) override;
+
 private:
+    void onModelChanged();
+
     void emitEncryptFailed();
+    void emitDecryptFailed();
+
+    QPointer<ItemEncryptedLoader> m_loader;
+    QPointer<QAbstractItemModel> m_model;
+    int m_maxItems;
+    std::shared_ptr<Receiver> m_receiver;
+
+    bool m_decrypting = false;
+    bool m_decryptFailed = false;
+    bool m_addingDecryptedItems = false;
+
+    /// Items changed since tab file was written.
+    bool m_modified = true;
 };
 
 class ItemEncryptedScriptable final : public ItemScriptable
@@ -128,6 +174,14 @@ public:
 
     bool setData(const QVariantMap &data, const QModelIndex &index, QAbstractItemModel *model) const override;
 
+    /**
+     * Returns thread pool for encrypting and decrypting tab.
+     *
+     * Tasks for the same tab run one after another, different tabs are
+     * processed concurrently.
+     */
+    QThreadPool *tabThreadPool(const QString &tabName);
+
 signals:
     void error(const QString &);
 
@@ -148,7 +202,7 @@ private:
 
     void emitDecryptFailed();
 
-    ItemSaverPtr createSaver();
+    std::shared_ptr<ItemEncryptedSaver> createSaver(QAbstractItemModel *model, int maxItems);
 
     GpgProcessStatus status() const;
 
@@ -157,6 +211,8 @@ private:
 
     mutable GpgProcessStatus m_gpgProcessStatus;
     QProcess *m_gpgProcess;
+
+    QHash<QString, std::shared_ptr<QThreadPool>> m_tabThreadPools;
 };
 
 #endif // ITEMENCRYPTED_H
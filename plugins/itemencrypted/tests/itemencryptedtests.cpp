@@ -21,12 +21,21 @@
 
 #include "tests/test_utils.h"
 
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+
 ItemEncryptedTests::ItemEncryptedTests(const TestInterfacePtr &test, QObject *parent)
     : QObject(parent)
     , m_test(test)
 {
 }
 
+QString ItemEncryptedTests::testTab(int i)
+{
+    return ::testTab(i);
+}
+
 void ItemEncryptedTests::initTestCase()
 {
     SKIP_ON_ENV("COPYQ_TESTS_SKIP_ITEMENCRYPT");
@@ -71,6 +80,125 @@ void ItemEncryptedTests::encryptDecryptData()
     QCOMPARE(stdoutActual, input);
 }
 
+void ItemEncryptedTests::encryptDecryptTab()
+{
+    if ( !isGpgInstalled() )
+        SKIP("gpg2 is required to run the test");
+
+    RUN("-e" << "plugins.itemencrypted.generateTestKeys()", "\n");
+
+    const auto tab = testTab(1);
+    const Args args = Args("tab") << tab;
+    const auto script = QString("tab('%1');").arg(tab);
+
+    // Large item exceeds buffer limits for GnuPG input.
+    RUN("-e" << script + "add(new Array(2 * 1024 * 1024 + 1).join('x'))", "");
+    RUN(args << "add" << "C" << "B" << "A", "");
+
+    RUN("unload" << tab, tab + "\n");
+
+    // Items are decrypted in background.
+    WAIT_ON_OUTPUT(args << "size", "4\n");
+    RUN(args << "read" << "0" << "1" << "2", "A\nB\nC");
+    RUN("-e" << script + "str(read(3)).length", "2097152\n");
+}
+
+void ItemEncryptedTests::encryptDecryptTabsInBackground()
+{
+    if ( !isGpgInstalled() )
+        SKIP("gpg2 is required to run the test");
+
+    RUN("-e" << "plugins.itemencrypted.generateTestKeys()", "\n");
+
+    const auto tab1 = testTab(1);
+    const Args args1 = Args("tab") << tab1;
+    const auto tab2 = testTab(2);
+    const Args args2 = Args("tab") << tab2;
+
+    RUN(args1 << "add" << "C" << "B" << "A", "");
+    RUN(args2 << "add" << "Z" << "Y" << "X", "");
+
+    RUN("unload" << tab1, tab1 + "\n");
+    RUN("unload" << tab2, tab2 + "\n");
+
+    // Both tabs are decrypted at the same time.
+    RUN("-e" << QString("tab('%1'); size(); tab('%2'); size(); print('')").arg(tab1, tab2), "");
+    WAIT_ON_OUTPUT(args1 << "size", "3\n");
+    WAIT_ON_OUTPUT(args2 << "size", "3\n");
+    RUN(args1 << "read" << "0" << "1" << "2", "A\nB\nC");
+    RUN(args2 << "read" << "0" << "1" << "2", "X\nY\nZ");
+
+    // Tab is saved in background before it's loaded again.
+    RUN(args1 << "remove" << "1", "");
+    RUN("unload" << tab1, tab1 + "\n");
+    WAIT_ON_OUTPUT(args1 << "size", "2\n");
+    RUN(args1 << "read" << "0" << "1", "A\nC");
+}
+
+void ItemEncryptedTests::addItemsToUnloadedTab()
+{
+    if ( !isGpgInstalled() )
+        SKIP("gpg2 is required to run the test");
+
+    RUN("-e" << "plugins.itemencrypted.generateTestKeys()", "\n");
+
+    const auto tab = testTab(1);
+    const Args args = Args("tab") << tab;
+
+    RUN(args << "add" << "A", "");
+    RUN("unload" << tab, tab + "\n");
+
+    const auto script = QString("setData(mimeOutputTab, '%1'); setData(mimeText, 'SECRET'); saveData()").arg(tab);
+    RUN("-e" << script, "");
+
+    // Item must not be stored unencrypted next to the tab file.
+    QByteArray configPath;
+    QCOMPARE( m_test->run(Args("-e") << "info('config')", &configPath), 0 );
+    const QDir configDir = QFileInfo( QString::fromUtf8(configPath).trimmed() ).absoluteDir();
+    for ( const auto &fileName : configDir.entryList(QDir::Files) ) {
+        QFile file( configDir.absoluteFilePath(fileName) );
+        QVERIFY( file.open(QIODevice::ReadOnly) );
+        QVERIFY2( !file.readAll().contains("SECRET"), qPrintable(fileName) );
+    }
+
+    WAIT_ON_OUTPUT(args << "size", "2\n");
+    RUN(args << "read" << "0" << "1", "SECRET\nA");
+}
+
+void ItemEncryptedTests::renameAndRemoveTabWhileSaving()
+{
+    if ( !isGpgInstalled() )
+        SKIP("gpg2 is required to run the test");
+
+    RUN("-e" << "plugins.itemencrypted.generateTestKeys()", "\n");
+
+    const auto tab1 = testTab(1);
+    const Args args1 = Args("tab") << tab1;
+    const auto tab2 = testTab(2);
+    const Args args2 = Args("tab") << tab2;
+
+    // Tab is saved before its files are moved.
+    RUN(args1 << "add" << "C" << "B" << "A", "");
+    RUN("renametab" << tab1 << tab2, "");
+    RUN("unload" << tab2, tab2 + "\n");
+    WAIT_ON_OUTPUT(args2 << "size", "3\n");
+    RUN(args2 << "read" << "0" << "1" << "2", "A\nB\nC");
+
+    // Removed tab file is not written again.
+    RUN(args2 << "add" << "D", "");
+    RUN("removetab" << tab2, "");
+
+    QByteArray configPath;
+    QCOMPARE( m_test->run(Args("-e") << "info('config')", &configPath), 0 );
+    const QFileInfo configFileInfo( QString::fromUtf8(configPath).trimmed() );
+    const QDir configDir = configFileInfo.absoluteDir();
+    for (const auto &tab : {tab1, tab2}) {
+        const QString tabFilePrefix = configFileInfo.completeBaseName() + "_tab_"
+                + QString(tab.toUtf8().toBase64()).replace('/', '-');
+        QVERIFY2( configDir.entryList({tabFilePrefix + "*"}, QDir::Files).isEmpty(), qPrintable(tab) );
+    }
+}
+
 bool ItemEncryptedTests::isGpgInstalled() const
 {
     QByteArray actualStdout;
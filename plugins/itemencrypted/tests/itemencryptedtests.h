@@ -30,6 +30,8 @@ class ItemEncryptedTests final : public QObject
 public:
     explicit ItemEncryptedTests(const TestInterfacePtr &test, QObject *parent = nullptr);
 
+    static QString testTab(int i);
+
 private slots:
     void initTestCase();
     void cleanupTestCase();
@@ -37,6 +39,10 @@ private slots:
     void cleanup();
 
     void encryptDecryptData();
+    void encryptDecryptTab();
+    void encryptDecryptTabsInBackground();
+    void addItemsToUnloadedTab();
+    void renameAndRemoveTabWhileSaving();
 
 private:
     bool isGpgInstalled() const;
@@ -21,20 +21,36 @@
 #include "ui_itemimagesettings.h"
 
 #include "common/contenttype.h"
+#include "common/log.h"
 #include "common/mimetypes.h"
+#include "common/textdata.h"
 #include "item/itemeditor.h"
 
 #include <QBuffer>
+#include <QCache>
+#include <QCoreApplication>
+#include <QEvent>
 #include <QHBoxLayout>
+#include <QImage>
+#include <QImageReader>
 #include <QModelIndex>
 #include <QMovie>
+#include <QMutex>
+#include <QMutexLocker>
 #include <QPainter>
 #include <QPixmap>
+#include <QRunnable>
+#include <QThreadPool>
 #include <QtPlugin>
 #include <QVariant>
 
+#include <algorithm>
+
 namespace {
 
+// Limit for thumbnails kept in memory.
+const int maxThumbnailMemoryCacheKiB = 32 * 1024;
+
 QString findImageFormat(const QList<QString> &formats)
 {
     // Check formats in this order.
@@ -88,41 +104,246 @@ bool getAnimatedImageData(const QVariantMap &dataMap, QByteArray *data, QByteArr
     return false;
 }
 
-bool getPixmapFromData(const QVariantMap &dataMap, QPixmap *pix)
+QSize thumbnailSize(const QSize &size, int maxWidth, int maxHeight)
 {
-    QString mime;
-    QByteArray data;
-    if ( !getImageData(dataMap, &data, &mime) && !getSvgData(dataMap, &data, &mime) )
-        return false;
+    if ( maxWidth > 0 && size.width() > maxWidth
+         && (maxHeight <= 0 || 1.0 * size.width() / maxWidth > 1.0 * size.height() / maxHeight) )
+    {
+        const int h = qRound(1.0 * size.height() * maxWidth / size.width());
+        return QSize(maxWidth, qMax(1, h));
+    }
 
-    pix->loadFromData( data, mime.toLatin1() );
+    if ( maxHeight > 0 && size.height() > maxHeight ) {
+        const int w = qRound(1.0 * size.width() * maxHeight / size.height());
+        return QSize(qMax(1, w), maxHeight);
+    }
 
-    return true;
+    return size;
+}
+
+/// Returns image size without decoding the whole image.
+QSize imageSize(const QByteArray &data)
+{
+    QByteArray bytes = data;
+    QBuffer buffer(&bytes);
+    QImageReader reader(&buffer);
+    return reader.size();
 }
 
+QImage loadThumbnail(const QByteArray &data, const QString &mime, int maxWidth, int maxHeight)
+{
+    QImage image;
+    image.loadFromData( data, mime.toLatin1() );
+    if ( image.isNull() )
+        return image;
+
+    const QSize size = thumbnailSize(image.size(), maxWidth, maxHeight);
+    if ( size != image.size() )
+        image = image.scaled(size, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+
+    return image;
+}
+
+const QEvent::Type imageLoadedEventType =
+        static_cast<QEvent::Type>(QEvent::registerEventType());
+
+class ImageLoadedEvent final : public QEvent {
+public:
+    explicit ImageLoadedEvent(const QImage &image)
+        : QEvent(imageLoadedEventType)
+        , m_image(image)
+    {
+    }
+
+    const QImage &image() const { return m_image; }
+
+private:
+    QImage m_image;
+};
+
+} // namespace
+
+/**
+ * Thumbnails of images in memory.
+ *
+ * Thumbnails are identified by item hash (or hash of the image data if item
+ * hash is not available) and maximum thumbnail size. These are never stored
+ * on disk since images can come from encrypted tabs.
+ *
+ * All methods are thread-safe.
+ */
+class ThumbnailCache final {
+public:
+    ThumbnailCache()
+        : m_images(maxThumbnailMemoryCacheKiB)
+    {
+    }
+
+    static QString key(quint64 dataHash, int maxWidth, int maxHeight)
+    {
+        return QString("%1-%2x%3")
+                .arg(dataHash, 16, 16, QChar('0'))
+                .arg(maxWidth)
+                .arg(maxHeight);
+    }
+
+    bool find(const QString &key, QImage *image)
+    {
+        QMutexLocker lock(&m_mutex);
+        const QImage *cachedImage = m_images.object(key);
+        if (!cachedImage)
+            return false;
+
+        *image = *cachedImage;
+        return true;
+    }
+
+    void insert(const QString &key, const QImage &image)
+    {
+        const int cost = std::max(1, image.bytesPerLine() * image.height() / 1024);
+        QMutexLocker lock(&m_mutex);
+        m_images.insert( key, new QImage(image), cost );
+    }
+
+private:
+    QMutex m_mutex;
+    QCache<QString, QImage> m_images;
+};
+
+/**
+ * Receiver of images loaded in background.
+ *
+ * The item is unset in ItemImage destructor so the images are not posted
+ * to destroyed widget.
+ */
+struct ItemImage::ImageReceiver {
+    QMutex mutex;
+    ItemImage *item = nullptr;
+
+    bool isValid()
+    {
+        QMutexLocker lock(&mutex);
+        return item != nullptr;
+    }
+
+    void setImage(const QImage &image)
+    {
+        QMutexLocker lock(&mutex);
+        if (item)
+            QCoreApplication::postEvent( item, new ImageLoadedEvent(image) );
+    }
+};
+
+namespace {
+
+class ThumbnailTask final : public QRunnable {
+public:
+    ThumbnailTask(
+            const std::shared_ptr<ItemImage::ImageReceiver> &receiver,
+            const std::shared_ptr<ThumbnailCache> &cache, quint64 itemHash,
+            const QByteArray &data, const QString &mime,
+            int maxWidth, int maxHeight)
+        : m_receiver(receiver)
+        , m_cache(cache)
+        , m_itemHash(itemHash)
+        , m_data(data)
+        , m_mime(mime)
+        , m_maxWidth(maxWidth)
+        , m_maxHeight(maxHeight)
+    {
+    }
+
+    void run() override
+    {
+        if ( !m_receiver->isValid() )
+            return;
+
+        // Hashing large image data is slow too.
+        quint64 dataHash = m_itemHash;
+        if (dataHash == 0) {
+            QVariantMap imageData;
+            imageData.insert(m_mime, m_data);
+            dataHash = hash(imageData);
+        }
+        const QString key = ThumbnailCache::key(dataHash, m_maxWidth, m_maxHeight);
+
+        QImage image;
+        if ( !m_cache->find(key, &image) ) {
+            COPYQ_LOG( QString("ItemImage: Loading thumbnail %1").arg(key) );
+            image = loadThumbnail(m_data, m_mime, m_maxWidth, m_maxHeight);
+            if ( image.isNull() )
+                return;
+
+            m_cache->insert(key, image);
+        }
+
+        m_receiver->setImage(image);
+    }
+
+private:
+    std::shared_ptr<ItemImage::ImageReceiver> m_receiver;
+    std::shared_ptr<ThumbnailCache> m_cache;
+    quint64 m_itemHash;
+    QByteArray m_data;
+    QString m_mime;
+    int m_maxWidth;
+    int m_maxHeight;
+};
+
 } // namespace
 
 ItemImage::ItemImage(
-        const QPixmap &pix,
+        const QSize &imageSize,
         const QByteArray &animationData, const QByteArray &animationFormat,
         QWidget *parent)
     : QLabel(parent)
     , ItemWidget(this)
-    , m_pixmap(pix)
+    , m_imageSize(imageSize)
     , m_animationData(animationData)
     , m_animationFormat(animationFormat)
     , m_animation(nullptr)
 {
     setMargin(4);
-    setPixmap(pix);
+}
+
+ItemImage::~ItemImage()
+{
+    if (m_imageReceiver) {
+        QMutexLocker lock(&m_imageReceiver->mutex);
+        m_imageReceiver->item = nullptr;
+    }
+}
+
+void ItemImage::setImage(const QImage &image)
+{
+    m_pixmap = QPixmap::fromImage(image);
+    m_pixmap.setDevicePixelRatio( devicePixelRatio() );
+    m_imageSize = m_pixmap.size();
+
+    if (m_animation)
+        m_animation->setScaledSize(m_imageSize);
+    else
+        setPixmap(m_pixmap);
+
+    // Resizing the widget notifies the view about the size hint change.
+    updateSize(QSize(), 0);
+}
+
+std::shared_ptr<ItemImage::ImageReceiver> ItemImage::imageReceiver()
+{
+    if (!m_imageReceiver) {
+        m_imageReceiver = std::make_shared<ImageReceiver>();
+        m_imageReceiver->item = this;
+    }
+    return m_imageReceiver;
 }
 
 void ItemImage::updateSize(QSize, int)
 {
     const auto m2 = 2 * margin();
     const int ratio = devicePixelRatio();
-    const int w = (m_pixmap.width() + 1) / ratio + m2;
-    const int h = (m_pixmap.height() + 1) / ratio + m2;
+    const int w = (m_imageSize.width() + 1) / ratio + m2;
+    const int h = (m_imageSize.height() + 1) / ratio + m2;
     setFixedSize( QSize(w, h) );
 }
 
@@ -133,7 +354,7 @@ void ItemImage::setCurrent(bool current)
             if (!m_animation) {
                 QBuffer *stream = new QBuffer(&m_animationData, this);
                 m_animation = new QMovie(stream, m_animationFormat, this);
-                m_animation->setScaledSize( m_pixmap.size() );
+                m_animation->setScaledSize(m_imageSize);
             }
 
             if (m_animation) {
@@ -174,6 +395,14 @@ void ItemImage::paintEvent(QPaintEvent *event)
     }
 }
 
+void ItemImage::customEvent(QEvent *event)
+{
+    if (event->type() == imageLoadedEventType)
+        setImage( static_cast<ImageLoadedEvent*>(event)->image() );
+    else
+        QLabel::customEvent(event);
+}
+
 void ItemImage::startAnimation()
 {
     if (movie())
@@ -187,37 +416,50 @@ void ItemImage::stopAnimation()
 }
 
 ItemImageLoader::ItemImageLoader()
+    : m_thumbnailCache(std::make_shared<ThumbnailCache>())
+    , m_thumbnailPool(new QThreadPool)
 {
 }
 
-ItemImageLoader::~ItemImageLoader() = default;
+ItemImageLoader::~ItemImageLoader()
+{
+    // Tasks must not outlive the plugin library.
+    m_thumbnailPool->waitForDone();
+}
 
 ItemWidget *ItemImageLoader::create(const QVariantMap &data, QWidget *parent, bool preview) const
 {
     if ( data.value(mimeHidden).toBool() )
         return nullptr;
 
-    // TODO: Just check if image provided and load it in different thread.
-    QPixmap pix;
-    if ( !getPixmapFromData(data, &pix) )
+    QString mime;
+    QByteArray imageData;
+    if ( !getImageData(data, &imageData, &mime) && !getSvgData(data, &imageData, &mime) )
         return nullptr;
 
-    pix.setDevicePixelRatio( parent->devicePixelRatio() );
-
-    // scale pixmap
     const int w = preview ? 0 : m_settings.value("max_image_width", 320).toInt();
     const int h = preview ? 0 : m_settings.value("max_image_height", 240).toInt();
-    if ( w > 0 && pix.width() > w && (h <= 0 || 1.0 * pix.width()/w > 1.0 * pix.height()/h) ) {
-        pix = pix.scaledToWidth(w, Qt::SmoothTransformation);
-    } else if (h > 0 && pix.height() > h) {
-        pix = pix.scaledToHeight(h, Qt::SmoothTransformation);
-    }
 
     QByteArray animationData;
     QByteArray animationFormat;
     getAnimatedImageData(data, &animationData, &animationFormat);
 
-    return new ItemImage(pix, animationData, animationFormat, parent);
+    const QSize size = thumbnailSize( imageSize(imageData), w, h );
+    auto item = new ItemImage(size, animationData, animationFormat, parent);
+
+    // Use cached thumbnail right away so recreated item doesn't show up empty.
+    const quint64 itemHash = data.value(mimeItemHash).toULongLong();
+    QImage image;
+    if ( itemHash != 0 && m_thumbnailCache->find(ThumbnailCache::key(itemHash, w, h), &image) ) {
+        item->setImage(image);
+        return item;
+    }
+
+    // Decoding and scaling the image is slow so it's done in different thread.
+    m_thumbnailPool->start( new ThumbnailTask(
+        item->imageReceiver(), m_thumbnailCache, itemHash, imageData, mime, w, h) );
+
+    return item;
 }
 
 QStringList ItemImageLoader::formatsToSave() const
@@ -29,6 +29,8 @@
 #include <memory>
 
 class QMovie;
+class QThreadPool;
+class ThumbnailCache;
 
 namespace Ui {
 class ItemImageSettings;
@@ -39,11 +41,25 @@ class ItemImage final : public QLabel, public ItemWidget
     Q_OBJECT
 
 public:
+    struct ImageReceiver;
+
+    /**
+     * Creates item with given image size.
+     *
+     * The image itself is set later with setImage().
+     */
     ItemImage(
-            const QPixmap &pix,
+            const QSize &imageSize,
             const QByteArray &animationData, const QByteArray &animationFormat,
             QWidget *parent);
 
+    ~ItemImage();
+
+    void setImage(const QImage &image);
+
+    /// Returns object which passes image loaded in a different thread to the item.
+    std::shared_ptr<ImageReceiver> imageReceiver();
+
     void updateSize(QSize maximumSize, int idealWidth) override;
 
     void setCurrent(bool current) override;
@@ -52,15 +68,18 @@ protected:
     void showEvent(QShowEvent *event) override;
     void hideEvent(QHideEvent *event) override;
     void paintEvent(QPaintEvent *event) override;
+    void customEvent(QEvent *event) override;
 
 private:
     void startAnimation();
     void stopAnimation();
 
+    QSize m_imageSize;
     QPixmap m_pixmap;
     QByteArray m_animationData;
     QByteArray m_animationFormat;
     QMovie *m_animation;
+    std::shared_ptr<ImageReceiver> m_imageReceiver;
 };
 
 class ItemImageLoader final : public QObject, public ItemLoaderInterface
@@ -96,6 +115,9 @@ public:
 private:
     QVariantMap m_settings;
     std::unique_ptr<Ui::ItemImageSettings> ui;
+    std::shared_ptr<ThumbnailCache> m_thumbnailCache;
+    /// Loads thumbnails in background.
+    std::unique_ptr<QThreadPool> m_thumbnailPool;
 };
 
 #endif // ITEMIMAGE_H
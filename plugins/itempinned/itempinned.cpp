@@ -185,6 +185,21 @@ bool ItemPinnedSaver::saveItems(const QString &tabName, const QAbstractItemModel
     return m_saver->saveItems(tabName, model, file);
 }
 
+bool ItemPinnedSaver::saveItemsInBackground(const QString &tabName, const QAbstractItemModel &model, const QString &tabFileName)
+{
+    return m_saver->saveItemsInBackground(tabName, model, tabFileName);
+}
+
+void ItemPinnedSaver::waitForSavedItems()
+{
+    m_saver->waitForSavedItems();
+}
+
+bool ItemPinnedSaver::saveChanges(const QString &tabName, const QAbstractItemModel &model, QIODevice *journal)
+{
+    return m_saver->saveChanges(tabName, model, journal);
+}
+
 bool ItemPinnedSaver::canRemoveItems(const QList<QModelIndex> &indexList, QString *error)
 {
     if ( !containsPinnedItems(indexList) )
@@ -60,6 +60,12 @@ public:
 
     bool saveItems(const QString &tabName, const QAbstractItemModel &model, QIODevice *file) override;
 
+    bool saveItemsInBackground(const QString &tabName, const QAbstractItemModel &model, const QString &tabFileName) override;
+
+    void waitForSavedItems() override;
+
+    bool saveChanges(const QString &tabName, const QAbstractItemModel &model, QIODevice *journal) override;
+
     bool canRemoveItems(const QList<QModelIndex> &indexList, QString *error) override;
 
     bool canMoveItems(const QList<QModelIndex> &indexList) override;
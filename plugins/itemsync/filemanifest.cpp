@@ -0,0 +1,177 @@
+/*
+    Copyright (c) 2019, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "filemanifest.h"
+
+#include "common/log.h"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QSaveFile>
+#include <QSet>
+#include <QStandardPaths>
+
+namespace {
+
+const char manifestFileHeader[] = "CopyQ_itemsync_manifest v1";
+
+/**
+ * File modified shortly before its hash was stored could have been modified
+ * again without changing its size and modification time.
+ *
+ * Some file systems store modification time only in whole seconds (FAT even
+ * in two second steps). Otherwise the time is still updated only on each
+ * clock tick of the kernel (up to 10ms on Linux) and can lag behind.
+ */
+const qint64 coarseModificationTimePrecisionMs = 2000;
+const qint64 fineModificationTimePrecisionMs = 100;
+
+qint64 lastModifiedMs(const QFileInfo &info)
+{
+    return info.lastModified().toMSecsSinceEpoch();
+}
+
+qint64 modificationTimePrecisionMs(qint64 lastModifiedMs)
+{
+    return lastModifiedMs % 1000 == 0
+            ? coarseModificationTimePrecisionMs
+            : fineModificationTimePrecisionMs;
+}
+
+} // namespace
+
+FileManifest::FileManifest(const QString &path)
+{
+    const QByteArray pathHash = QCryptographicHash::hash(
+                QDir(path).absolutePath().toUtf8(), QCryptographicHash::Sha1);
+    m_manifestPath = QStandardPaths::writableLocation(QStandardPaths::CacheLocation)
+            + "/itemsync/" + QString::fromLatin1( pathHash.toHex() ) + ".dat";
+
+    load();
+}
+
+FileManifest::~FileManifest()
+{
+    save();
+}
+
+bool FileManifest::findHash(const QFileInfo &info, QByteArray *hash) const
+{
+    const auto it = m_entries.constFind( info.fileName() );
+    if ( it == m_entries.constEnd() )
+        return false;
+
+    // Hash stored within precision of modification time (usually right after
+    // the file was written) is verified again when the file is read next time.
+    const Entry &entry = it.value();
+    if ( entry.size != info.size()
+         || entry.lastModifiedMs != lastModifiedMs(info)
+         || entry.storedMs - entry.lastModifiedMs < modificationTimePrecisionMs(entry.lastModifiedMs) )
+    {
+        return false;
+    }
+
+    *hash = entry.hash;
+    return true;
+}
+
+void FileManifest::setHash(const QFileInfo &info, const QByteArray &hash)
+{
+    Entry &entry = m_entries[info.fileName()];
+    entry.size = info.size();
+    entry.lastModifiedMs = lastModifiedMs(info);
+    entry.storedMs = QDateTime::currentMSecsSinceEpoch();
+    entry.hash = hash;
+    m_modified = true;
+}
+
+void FileManifest::removeMissing(const QFileInfoList &files)
+{
+    QSet<QString> fileNames;
+    for (const auto &info : files)
+        fileNames.insert( info.fileName() );
+
+    for (auto it = m_entries.begin(); it != m_entries.end(); ) {
+        if ( fileNames.contains(it.key()) ) {
+            ++it;
+        } else {
+            it = m_entries.erase(it);
+            m_modified = true;
+        }
+    }
+}
+
+void FileManifest::save()
+{
+    if (!m_modified)
+        return;
+
+    m_modified = false;
+
+    if ( !QDir().mkpath(QFileInfo(m_manifestPath).absolutePath()) )
+        return;
+
+    QSaveFile file(m_manifestPath);
+    if ( !file.open(QIODevice::WriteOnly) ) {
+        log( QString("ItemSync: Failed to save file manifest: %1").arg(file.errorString()), LogWarning );
+        return;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_4_7);
+    stream << QString(manifestFileHeader) << static_cast<quint32>( m_entries.size() );
+    for (auto it = m_entries.constBegin(); it != m_entries.constEnd(); ++it) {
+        const Entry &entry = it.value();
+        stream << it.key() << entry.size << entry.lastModifiedMs << entry.storedMs << entry.hash;
+    }
+
+    if ( stream.status() != QDataStream::Ok || !file.commit() )
+        log( QString("ItemSync: Failed to save file manifest: %1").arg(file.errorString()), LogWarning );
+}
+
+void FileManifest::load()
+{
+    QFile file(m_manifestPath);
+    if ( !file.open(QIODevice::ReadOnly) )
+        return;
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_4_7);
+
+    QString header;
+    quint32 count;
+    stream >> header >> count;
+    if ( stream.status() != QDataStream::Ok || header != manifestFileHeader )
+        return;
+
+    for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+        QString fileName;
+        Entry entry;
+        stream >> fileName >> entry.size >> entry.lastModifiedMs >> entry.storedMs >> entry.hash;
+        if ( stream.status() == QDataStream::Ok )
+            m_entries.insert(fileName, entry);
+    }
+
+    if ( stream.status() != QDataStream::Ok ) {
+        COPYQ_LOG("ItemSync: Failed to load file manifest");
+        m_entries.clear();
+    }
+}
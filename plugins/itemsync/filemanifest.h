@@ -0,0 +1,70 @@
+/*
+    Copyright (c) 2019, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef FILEMANIFEST_H
+#define FILEMANIFEST_H
+
+#include <QByteArray>
+#include <QFileInfo>
+#include <QHash>
+#include <QString>
+
+/**
+ * Content hashes of files in a synchronized directory.
+ *
+ * Hash of a file is valid only while its size and modification time don't
+ * change. The manifest is stored in application cache directory so the files
+ * don't need to be hashed again after restart.
+ */
+class FileManifest final {
+public:
+    explicit FileManifest(const QString &path);
+
+    ~FileManifest();
+
+    /// Returns true and sets @a hash if the file has not changed since the hash was stored.
+    bool findHash(const QFileInfo &info, QByteArray *hash) const;
+
+    void setHash(const QFileInfo &info, const QByteArray &hash);
+
+    /// Removes hashes of files not in @a files.
+    void removeMissing(const QFileInfoList &files);
+
+    /// Saves changes to disk.
+    void save();
+
+    FileManifest(const FileManifest &) = delete;
+    FileManifest &operator=(const FileManifest &) = delete;
+
+private:
+    struct Entry {
+        qint64 size;
+        qint64 lastModifiedMs;
+        qint64 storedMs;
+        QByteArray hash;
+    };
+
+    void load();
+
+    QString m_manifestPath;
+    QHash<QString, Entry> m_entries;
+    bool m_modified = false;
+};
+
+#endif // FILEMANIFEST_H
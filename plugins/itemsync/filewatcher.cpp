@@ -30,6 +30,8 @@
 #include <QMimeData>
 #include <QUrl>
 
+#include <vector>
+
 const char mimeExtensionMap[] = COPYQ_MIME_PREFIX_ITEMSYNC "mime-to-extension-map";
 const char mimeBaseName[] = COPYQ_MIME_PREFIX_ITEMSYNC "basename";
 const char mimeNoSave[] = COPYQ_MIME_PREFIX_ITEMSYNC "no-save";
@@ -56,6 +58,7 @@ struct BaseNameExtensions {
         , exts(exts) {}
     QString baseName;
     QList<Ext> exts;
+    FilesState state;
 };
 
 namespace {
@@ -65,6 +68,11 @@ const char noteFileSuffix[] = "_note.txt";
 
 const int defaultUpdateFocusItemsIntervalMs = 10000;
 
+// Wait for more changes in synchronization directory before updating items.
+const int updateAfterChangeDelayMs = 100;
+
+const int saveManifestDelayMs = 10000;
+
 const qint64 sizeLimit = 10 << 20;
 
 FileFormat getFormatSettingsFromFileName(const QString &fileName,
@@ -195,19 +203,18 @@ bool saveItemFile(const QString &filePath, const QByteArray &bytes,
     return true;
 }
 
-bool canUseFile(QFileInfo &info)
+bool canUseFile(const QFileInfo &info)
 {
     return !info.isHidden() && !info.fileName().startsWith('.') && info.isReadable();
 }
 
-bool getBaseNameExtension(const QString &filePath, const QList<FileFormat> &formatSettings,
+bool getBaseNameExtension(const QFileInfo &info, const QList<FileFormat> &formatSettings,
                           QString *baseName, Ext *ext)
 {
-    QFileInfo info(filePath);
     if ( !canUseFile(info) )
         return false;
 
-    *ext = findByExtension(filePath, formatSettings);
+    *ext = findByExtension(info.filePath(), formatSettings);
     if ( ext->format.isEmpty() || ext->format == "-" )
         return false;
 
@@ -217,16 +224,16 @@ bool getBaseNameExtension(const QString &filePath, const QList<FileFormat> &form
     return true;
 }
 
-BaseNameExtensionsList listFiles(const QStringList &files,
+BaseNameExtensionsList listFiles(const QFileInfoList &files,
                                  const QList<FileFormat> &formatSettings)
 {
     BaseNameExtensionsList fileList;
-    QMap<QString, int> fileMap;
+    QHash<QString, int> fileMap;
 
-    for (const auto &filePath : files) {
+    for (const auto &info : files) {
         QString baseName;
         Ext ext;
-        if ( getBaseNameExtension(filePath, formatSettings, &baseName, &ext) ) {
+        if ( getBaseNameExtension(info, formatSettings, &baseName, &ext) ) {
             int i = fileMap.value(baseName, -1);
             if (i == -1) {
                 i = fileList.size();
@@ -234,29 +241,67 @@ BaseNameExtensionsList listFiles(const QStringList &files,
                 fileMap.insert(baseName, i);
             }
 
-            fileList[i].exts.append(ext);
+            BaseNameExtensions &baseNameWithExts = fileList[i];
+            baseNameWithExts.exts.append(ext);
+
+            FilesState &state = baseNameWithExts.state;
+            state.lastModifiedMs = qMax( state.lastModifiedMs, info.lastModified().toMSecsSinceEpoch() );
+            state.size += info.size();
+            ++state.count;
         }
     }
 
     return fileList;
 }
 
-/// Load hash of all existing files to map (hash -> filename).
-QStringList listFiles(const QDir &dir, QDir::SortFlags sortFlags = QDir::NoSort)
+BaseNameExtensionsList listFiles(const QStringList &files,
+                                 const QList<FileFormat> &formatSettings)
+{
+    QFileInfoList fileInfos;
+    fileInfos.reserve( files.size() );
+    for (const auto &filePath : files)
+        fileInfos.append( QFileInfo(filePath) );
+
+    return listFiles(fileInfos, formatSettings);
+}
+
+/// Returns state of item files as it would be listed in synchronization directory.
+FilesState itemFilesState(const QString &filePath, const QVariantMap &mimeToExtension,
+                          const QList<FileFormat> &formatSettings)
 {
     QStringList files;
+    for (const auto &ext : mimeToExtension) {
+        const QString fileName = filePath + ext.toString();
+        if ( !files.contains(fileName) )
+            files.append(fileName);
+    }
+
+    const BaseNameExtensionsList fileList = listFiles(files, formatSettings);
+    return fileList.isEmpty() ? FilesState() : fileList.first().state;
+}
+
+QFileInfoList listFileInfos(const QDir &dir, QDir::SortFlags sortFlags = QDir::NoSort)
+{
+    QFileInfoList files;
 
     const QDir::Filters itemFileFilter = QDir::Files | QDir::Readable | QDir::Writable;
-    for ( const auto &fileName : dir.entryList(itemFileFilter, sortFlags) ) {
-        const QString path = dir.absoluteFilePath(fileName);
-        QFileInfo info(path);
+    for ( const auto &info : dir.entryInfoList(itemFileFilter, sortFlags) ) {
         if ( canUseFile(info) )
-            files.append(path);
+            files.append(info);
     }
 
     return files;
 }
 
+/// Load hash of all existing files to map (hash -> filename).
+QStringList listFiles(const QDir &dir)
+{
+    QStringList files;
+    for ( const auto &info : listFileInfos(dir) )
+        files.append( info.absoluteFilePath() );
+    return files;
+}
+
 /// Return true only if no file name in @a fileNames starts with @a baseName.
 bool isUniqueBaseName(const QString &baseName, const QStringList &fileNames,
                       const QStringList &baseNames = QStringList())
@@ -408,6 +453,7 @@ FileWatcher::FileWatcher(
     , m_path(path)
     , m_valid(true)
     , m_indexData()
+    , m_manifest(path)
     , m_maxItems(maxItems)
 {
     m_updateTimer.setSingleShot(true);
@@ -419,6 +465,19 @@ FileWatcher::FileWatcher(
     connect( &m_updateTimer, &QTimer::timeout,
              this, &FileWatcher::updateItems );
 
+    m_changeTimer.setSingleShot(true);
+    m_changeTimer.setInterval(updateAfterChangeDelayMs);
+    connect( &m_changeTimer, &QTimer::timeout,
+             this, &FileWatcher::updateItems );
+
+    connect( &m_fileSystemWatcher, &QFileSystemWatcher::directoryChanged,
+             this, &FileWatcher::onDirectoryChanged );
+
+    m_saveManifestTimer.setSingleShot(true);
+    m_saveManifestTimer.setInterval(saveManifestDelayMs);
+    connect( &m_saveManifestTimer, &QTimer::timeout,
+             this, [this]() { m_manifest.save(); } );
+
     connect( m_model, &QAbstractItemModel::rowsInserted,
              this, &FileWatcher::onRowsInserted );
     connect( m_model, &QAbstractItemModel::rowsAboutToBeRemoved,
@@ -430,6 +489,9 @@ FileWatcher::FileWatcher(
         saveItems(0, model->rowCount() - 1);
 
     createItemsFromFiles( QDir(path), listFiles(paths, m_formatSettings) );
+
+    watchDirectory();
+    saveManifestLater();
 }
 
 bool FileWatcher::lock()
@@ -450,15 +512,21 @@ bool FileWatcher::createItemFromFiles(const QDir &dir, const BaseNameExtensions
 {
     QVariantMap dataMap;
     QVariantMap mimeToExtension;
+    QMap<QString, Hash> formatHash;
 
-    updateDataAndWatchFile(dir, baseNameWithExts, &dataMap, &mimeToExtension);
+    updateDataAndWatchFile(dir, baseNameWithExts, &dataMap, &mimeToExtension, &formatHash);
 
     if ( !mimeToExtension.isEmpty() ) {
-        dataMap.insert( mimeBaseName, QFileInfo(baseNameWithExts.baseName).fileName() );
+        const QString baseName = QFileInfo(baseNameWithExts.baseName).fileName();
+        dataMap.insert(mimeBaseName, baseName);
         dataMap.insert(mimeExtensionMap, mimeToExtension);
 
-        if ( !createItem(dataMap, targetRow) )
+        if ( !createItem(dataMap, formatHash, targetRow) )
             return false;
+
+        const QPersistentModelIndex index = m_baseNameToIndex.value(baseName);
+        if ( index.isValid() )
+            indexData(index).filesState = baseNameWithExts.state;
     }
 
     return true;
@@ -478,50 +546,81 @@ void FileWatcher::createItemsFromFiles(const QDir &dir, const BaseNameExtensions
 void FileWatcher::updateItems()
 {
     if ( !lock() ) {
-        m_updateTimer.start();
+        if (m_watchingDirectory)
+            m_changeTimer.start();
+        else
+            m_updateTimer.start();
         return;
     }
 
+    m_changeTimer.stop();
     m_lastUpdateTimeMs = QDateTime::currentMSecsSinceEpoch();
 
     const QDir dir(m_path);
-    const QStringList files = listFiles(dir, QDir::Time | QDir::Reversed);
-    BaseNameExtensionsList fileList = listFiles(files, m_formatSettings);
+    const QFileInfoList files = listFileInfos(dir, QDir::Time | QDir::Reversed);
+    const BaseNameExtensionsList fileList = listFiles(files, m_formatSettings);
+    m_manifest.removeMissing(files);
 
-    for ( int row = 0; row < m_model->rowCount(); ++row ) {
-        const QModelIndex index = m_model->index(row, 0);
-        const QString baseName = getBaseName(index);
+    std::vector<bool> rowsWithFiles(static_cast<size_t>(m_model->rowCount()), false);
+    BaseNameExtensionsList newFileList;
 
-        int i = 0;
-        for ( i = 0; i < fileList.size() && fileList[i].baseName != baseName; ++i ) {}
+    for (const auto &baseNameWithExts : fileList) {
+        const QPersistentModelIndex index = m_baseNameToIndex.value(baseNameWithExts.baseName);
+        if ( !index.isValid() ) {
+            newFileList.append(baseNameWithExts);
+            continue;
+        }
+
+        IndexData &data = indexData(index);
+        if (data.filesState == baseNameWithExts.state) {
+            rowsWithFiles[static_cast<size_t>(index.row())] = true;
+            continue;
+        }
 
         QVariantMap dataMap;
         QVariantMap mimeToExtension;
+        QMap<QString, Hash> formatHash;
+        updateDataAndWatchFile(
+            dir, baseNameWithExts, &dataMap, &mimeToExtension, &formatHash,
+            index.data(contentType::data).toMap(), data.formatHash );
+        if ( mimeToExtension.isEmpty() )
+            continue;
 
-        if ( i < fileList.size() ) {
-            updateDataAndWatchFile(dir, fileList[i], &dataMap, &mimeToExtension);
-            fileList.removeAt(i);
-        }
+        dataMap.insert(mimeBaseName, baseNameWithExts.baseName);
+        dataMap.insert(mimeExtensionMap, mimeToExtension);
+        updateIndexData(index, dataMap, formatHash);
+        indexData(index).filesState = baseNameWithExts.state;
+        rowsWithFiles[static_cast<size_t>(index.row())] = true;
+    }
 
-        if ( mimeToExtension.isEmpty() ) {
-            m_model->removeRow(row--);
-        } else {
-            dataMap.insert(mimeBaseName, baseName);
-            dataMap.insert(mimeExtensionMap, mimeToExtension);
-            updateIndexData(index, dataMap);
-        }
+    // Remove items with removed files.
+    for (int row = static_cast<int>(rowsWithFiles.size()) - 1; row >= 0; --row) {
+        if ( !rowsWithFiles[static_cast<size_t>(row)] )
+            m_model->removeRow(row);
     }
 
-    createItemsFromFiles(dir, fileList);
+    createItemsFromFiles(dir, newFileList);
+
+    if (!m_watchingDirectory)
+        watchDirectory();
+
+    saveManifestLater();
 
     unlock();
 
+    // Files modified in place are not reported by directory watcher.
     if (m_updatesEnabled)
         m_updateTimer.start();
 }
 
 void FileWatcher::updateItemsIfNeeded()
 {
+    // Apply pending changes.
+    if ( m_changeTimer.isActive() ) {
+        updateItems();
+        return;
+    }
+
     const auto time = QDateTime::currentMSecsSinceEpoch();
     if (time < m_lastUpdateTimeMs + m_updateTimer.interval())
         return;
@@ -552,40 +651,56 @@ void FileWatcher::onRowsRemoved(const QModelIndex &, int first, int last)
 {
     for ( const auto &index : indexList(first, last) ) {
         Q_ASSERT(index.isValid());
-        IndexDataList::iterator it = findIndexData(index);
+        IndexDataMap::iterator it = findIndexData(index);
         Q_ASSERT( it != m_indexData.end() );
         if ( isOwnBaseName(it->baseName) )
             removeFilesForRemovedIndex(m_path, index);
+        if ( m_baseNameToIndex.value(it->baseName) == index )
+            m_baseNameToIndex.remove(it->baseName);
         m_indexData.erase(it);
     }
 }
 
-FileWatcher::IndexDataList::iterator FileWatcher::findIndexData(const QModelIndex &index)
+void FileWatcher::onDirectoryChanged()
+{
+    m_changeTimer.start();
+}
+
+void FileWatcher::watchDirectory()
 {
-    return qFind(m_indexData.begin(), m_indexData.end(), index);
+    if ( !m_watchingDirectory && QDir(m_path).exists() )
+        m_watchingDirectory = m_fileSystemWatcher.addPath(m_path);
+}
+
+FileWatcher::IndexDataMap::iterator FileWatcher::findIndexData(const QModelIndex &index)
+{
+    return m_indexData.find( QPersistentModelIndex(index) );
 }
 
 FileWatcher::IndexData &FileWatcher::indexData(const QModelIndex &index)
 {
-    IndexDataList::iterator it = findIndexData(index);
+    const QPersistentModelIndex persistentIndex(index);
+    IndexDataMap::iterator it = m_indexData.find(persistentIndex);
     if ( it == m_indexData.end() )
-        return *m_indexData.insert( m_indexData.end(), IndexData(index) );
+        it = m_indexData.insert( persistentIndex, IndexData(index) );
     return *it;
 }
 
-bool FileWatcher::createItem(const QVariantMap &dataMap, int targetRow)
+bool FileWatcher::createItem(const QVariantMap &dataMap, const QMap<QString, Hash> &formatHash, int targetRow)
 {
     const int row = qMax( 0, qMin(targetRow, m_model->rowCount()) );
     if ( m_model->insertRow(row) ) {
         const QModelIndex &index = m_model->index(row, 0);
-        updateIndexData(index, dataMap);
+        updateIndexData(index, dataMap, formatHash);
         return true;
     }
 
     return false;
 }
 
-void FileWatcher::updateIndexData(const QModelIndex &index, const QVariantMap &itemData)
+void FileWatcher::updateIndexData(
+        const QModelIndex &index, const QVariantMap &itemData,
+        const QMap<QString, Hash> &knownFormatHash)
 {
     m_model->setData(index, itemData, contentType::data);
 
@@ -597,14 +712,25 @@ void FileWatcher::updateIndexData(const QModelIndex &index, const QVariantMap &i
 
     IndexData &data = indexData(index);
 
-    data.baseName = baseName;
+    if (data.baseName != baseName) {
+        if ( m_baseNameToIndex.value(data.baseName) == data.index )
+            m_baseNameToIndex.remove(data.baseName);
+        m_baseNameToIndex.insert(baseName, data.index);
+        data.baseName = baseName;
+    }
 
     QMap<QString, Hash> &formatData = data.formatHash;
     formatData.clear();
 
     for ( const auto &format : mimeToExtension.keys() ) {
-        if ( !format.startsWith(COPYQ_MIME_PREFIX_ITEMSYNC) )
-            formatData.insert(format, calculateHash(itemData.value(format).toByteArray()) );
+        if ( format.startsWith(COPYQ_MIME_PREFIX_ITEMSYNC) )
+            continue;
+
+        const auto it = knownFormatHash.constFind(format);
+        if ( it != knownFormatHash.constEnd() )
+            formatData.insert( format, it.value() );
+        else
+            formatData.insert( format, calculateHash(itemData.value(format).toByteArray()) );
     }
 }
 
@@ -631,6 +757,8 @@ void FileWatcher::saveItems(int first, int last)
         return;
     }
 
+    watchDirectory();
+
     if ( !renameMoveCopy(dir, indexList) )
         return;
 
@@ -670,8 +798,11 @@ void FileWatcher::saveItems(int first, int last)
             } else {
                 mimeToExtension.insert(format, ext);
                 const Hash oldHash = indexData(index).formatHash.value(format);
+                const bool writeFile = hash != oldHash || !existingFiles.contains(filePath + ext);
                 if ( !saveItemFile(filePath + ext, bytes, &existingFiles, hash != oldHash) )
                     return;
+                if (writeFile)
+                    m_manifest.setHash( QFileInfo(filePath + ext), hash );
             }
         }
 
@@ -701,8 +832,13 @@ void FileWatcher::saveItems(int first, int last)
             // Remove files of removed formats.
             removeFormatFiles(filePath, oldMimeToExtension);
         }
+
+        // Avoid reading the files again after the directory change is reported.
+        indexData(index).filesState = itemFilesState(filePath, mimeToExtension, m_formatSettings);
     }
 
+    saveManifestLater();
+
     unlock();
 }
 
@@ -714,7 +850,7 @@ bool FileWatcher::renameMoveCopy(const QDir &dir, const QList<QPersistentModelIn
         if ( !index.isValid() )
             continue;
 
-        IndexDataList::iterator it = findIndexData(index);
+        IndexDataMap::iterator it = findIndexData(index);
         const QString olderBaseName = (it != m_indexData.end()) ? it->baseName : QString();
         const QString oldBaseName = getBaseName(index);
         QString baseName = oldBaseName;
@@ -758,8 +894,10 @@ bool FileWatcher::renameMoveCopy(const QDir &dir, const QList<QPersistentModelIn
     return true;
 }
 
-void FileWatcher::updateDataAndWatchFile(const QDir &dir, const BaseNameExtensions &baseNameWithExts,
-                            QVariantMap *dataMap, QVariantMap *mimeToExtension)
+void FileWatcher::updateDataAndWatchFile(
+        const QDir &dir, const BaseNameExtensions &baseNameWithExts,
+        QVariantMap *dataMap, QVariantMap *mimeToExtension, QMap<QString, Hash> *formatHash,
+        const QVariantMap &oldDataMap, const QMap<QString, Hash> &oldFormatHash)
 {
     const QString basePath = dir.absoluteFilePath(baseNameWithExts.baseName);
 
@@ -767,8 +905,22 @@ void FileWatcher::updateDataAndWatchFile(const QDir &dir, const BaseNameExtensio
         Q_ASSERT( !ext.format.isEmpty() );
 
         const QString fileName = basePath + ext.extension;
+        const QFileInfo info( dir.absoluteFilePath(fileName) );
+
+        // Avoid reading unchanged files.
+        Hash hash;
+        const bool hasHash = m_manifest.findHash(info, &hash);
+        if ( hasHash && ext.extension != dataFileSuffix && !ext.format.startsWith(mimeNoFormat)
+             && !dataMap->contains(ext.format) && oldDataMap.contains(ext.format)
+             && oldFormatHash.value(ext.format) == hash )
+        {
+            dataMap->insert( ext.format, oldDataMap[ext.format] );
+            mimeToExtension->insert(ext.format, ext.extension);
+            formatHash->insert(ext.format, hash);
+            continue;
+        }
 
-        QFile f( dir.absoluteFilePath(fileName) );
+        QFile f( info.absoluteFilePath() );
         if ( !f.open(QIODevice::ReadOnly) )
             continue;
 
@@ -779,12 +931,24 @@ void FileWatcher::updateDataAndWatchFile(const QDir &dir, const BaseNameExtensio
         {
             mimeToExtension->insert(mimeNoFormat + ext.extension, ext.extension);
         } else {
-            dataMap->insert(ext.format, f.readAll());
+            const QByteArray bytes = f.readAll();
+            if (!hasHash) {
+                hash = calculateHash(bytes);
+                m_manifest.setHash(info, hash);
+            }
+            dataMap->insert(ext.format, bytes);
             mimeToExtension->insert(ext.format, ext.extension);
+            formatHash->insert(ext.format, hash);
         }
     }
 }
 
+void FileWatcher::saveManifestLater()
+{
+    if ( !m_saveManifestTimer.isActive() )
+        m_saveManifestTimer.start();
+}
+
 bool FileWatcher::copyFilesFromUriList(const QByteArray &uriData, int targetRow, const QStringList &baseNames)
 {
     QMimeData tmpData;
@@ -809,7 +973,7 @@ bool FileWatcher::copyFilesFromUriList(const QByteArray &uriData, int targetRow,
                     f.copy(targetFilePath);
                     Ext ext;
                     if ( m_model->rowCount() < m_maxItems
-                         && getBaseNameExtension(targetFilePath, m_formatSettings, &baseName, &ext) )
+                         && getBaseNameExtension(QFileInfo(targetFilePath), m_formatSettings, &baseName, &ext) )
                     {
                             BaseNameExtensions baseNameExts(baseName, QList<Ext>() << ext);
                             createItemFromFiles( QDir(m_path), baseNameExts, targetRow );
@@ -20,8 +20,12 @@
 #ifndef FILEWATCHER_H
 #define FILEWATCHER_H
 
+#include "filemanifest.h"
+
 #include "common/mimetypes.h"
 
+#include <QFileSystemWatcher>
+#include <QHash>
 #include <QObject>
 #include <QPersistentModelIndex>
 #include <QStringList>
@@ -49,6 +53,22 @@ struct FileFormat {
     QString icon;
 };
 
+/// Modification time and size of all files for an item.
+struct FilesState {
+    bool operator==(const FilesState &other) const
+    {
+        return lastModifiedMs == other.lastModifiedMs
+            && size == other.size
+            && count == other.count;
+    }
+
+    bool operator!=(const FilesState &other) const { return !(*this == other); }
+
+    qint64 lastModifiedMs = -1;
+    qint64 size = 0;
+    int count = 0;
+};
+
 using BaseNameExtensionsList = QList<BaseNameExtensions>;
 
 using Hash = QByteArray;
@@ -84,7 +104,9 @@ public:
     void createItemsFromFiles(const QDir &dir, const BaseNameExtensionsList &fileList);
 
     /**
-     * Check for new files.
+     * Check for new, changed and removed files.
+     *
+     * Only items with changed files are read again.
      */
     void updateItems();
 
@@ -99,25 +121,42 @@ private:
 
     void onRowsRemoved(const QModelIndex &, int first, int last);
 
+    void onDirectoryChanged();
+
+    /**
+     * Watches the synchronization directory for added, removed and renamed files.
+     *
+     * Files modified in place are found by checking modification time and size
+     * of files periodically.
+     */
+    void watchDirectory();
+
     struct IndexData {
         QPersistentModelIndex index;
         QString baseName;
         QMap<QString, Hash> formatHash;
+        FilesState filesState;
 
         IndexData() {}
         explicit IndexData(const QModelIndex &index) : index(index) {}
-        bool operator==(const QModelIndex &otherIndex) const { return otherIndex == index; }
     };
 
-    using IndexDataList = QVector<IndexData>;
+    using IndexDataMap = QHash<QPersistentModelIndex, IndexData>;
 
-    IndexDataList::iterator findIndexData(const QModelIndex &index);
+    IndexDataMap::iterator findIndexData(const QModelIndex &index);
 
     IndexData &indexData(const QModelIndex &index);
 
-    bool createItem(const QVariantMap &dataMap, int targetRow);
+    bool createItem(const QVariantMap &dataMap, const QMap<QString, Hash> &formatHash, int targetRow);
 
-    void updateIndexData(const QModelIndex &index, const QVariantMap &itemData);
+    /**
+     * Sets item data and remembers hashes of formats.
+     *
+     * Hashes missing in @a knownFormatHash are calculated.
+     */
+    void updateIndexData(
+            const QModelIndex &index, const QVariantMap &itemData,
+            const QMap<QString, Hash> &knownFormatHash = QMap<QString, Hash>());
 
     QList<QPersistentModelIndex> indexList(int first, int last);
 
@@ -125,18 +164,33 @@ private:
 
     bool renameMoveCopy(const QDir &dir, const QList<QPersistentModelIndex> &indexList);
 
+    /**
+     * Reads item data from files.
+     *
+     * Data of unchanged files are taken from @a oldDataMap if available.
+     */
     void updateDataAndWatchFile(
             const QDir &dir, const BaseNameExtensions &baseNameWithExts,
-            QVariantMap *dataMap, QVariantMap *mimeToExtension);
+            QVariantMap *dataMap, QVariantMap *mimeToExtension, QMap<QString, Hash> *formatHash,
+            const QVariantMap &oldDataMap = QVariantMap(),
+            const QMap<QString, Hash> &oldFormatHash = QMap<QString, Hash>());
+
+    void saveManifestLater();
 
     bool copyFilesFromUriList(const QByteArray &uriData, int targetRow, const QStringList &baseNames);
 
     QAbstractItemModel *m_model;
     QTimer m_updateTimer;
+    QTimer m_changeTimer;
+    QFileSystemWatcher m_fileSystemWatcher;
+    bool m_watchingDirectory = false;
     const QList<FileFormat> &m_formatSettings;
     QString m_path;
     bool m_valid;
-    IndexDataList m_indexData;
+    IndexDataMap m_indexData;
+    QHash<QString, QPersistentModelIndex> m_baseNameToIndex;
+    FileManifest m_manifest;
+    QTimer m_saveManifestTimer;
     int m_maxItems;
     bool m_updatesEnabled = false;
     qint64 m_lastUpdateTimeMs = 0;
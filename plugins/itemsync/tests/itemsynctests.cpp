@@ -22,8 +22,10 @@
 #include "common/mimetypes.h"
 #include "tests/test_utils.h"
 
+#include <QDateTime>
 #include <QDir>
 #include <QFile>
+#include <QSaveFile>
 
 #include <memory>
 
@@ -433,6 +435,132 @@ void ItemSyncTests::modifyFiles()
     RUN(args << "size", "4\n");
 }
 
+void ItemSyncTests::updateItemsOnDirectoryChange()
+{
+    // Disable checking files periodically.
+    TEST(m_test->stopServer());
+    m_test->setEnv("COPYQ_SYNC_UPDATE_INTERVAL_MS", "3600000");
+    TEST(m_test->startServer());
+
+    TestDir dir1(1);
+    const QString tab1 = testTab(1);
+    RUN(Args() << "show" << tab1, "");
+
+    const Args args = Args() << "separator" << "," << "tab" << tab1;
+
+    RUN(args << "add" << "A" << "B", "");
+    RUN(args << "read" << "0" << "1", "B,A");
+
+    // Saving items does not change the items.
+    const QString fileA = fileNameForId(0);
+    const QString fileB = fileNameForId(1);
+    QCOMPARE( dir1.files().join(sep), fileA + sep + fileB );
+    RUN(args << "size", "2\n");
+
+    // New file.
+    TEST(createFile(dir1, "test1.txt", "C"));
+    WAIT_ON_OUTPUT(args << "size", "3\n");
+    RUN(args << "read" << "0", "C");
+
+    // File replaced atomically (as many editors do).
+    QSaveFile saveFile( dir1.filePath(fileB) );
+    QVERIFY( saveFile.open(QIODevice::WriteOnly) );
+    QVERIFY( saveFile.write("X") == 1 );
+    QVERIFY( saveFile.commit() );
+    WAIT_ON_OUTPUT(args << "read" << "0" << "1" << "2", "C,X,A");
+
+    // Removed file.
+    QVERIFY( dir1.remove(fileA) );
+    WAIT_ON_OUTPUT(args << "size", "2\n");
+    RUN(args << "read" << "0" << "1", "C,X");
+
+    TEST(m_test->stopServer());
+    m_test->setEnv("COPYQ_SYNC_UPDATE_INTERVAL_MS", "100");
+    TEST(m_test->startServer());
+}
+
+void ItemSyncTests::skipReadingUnchangedFiles()
+{
+#if QT_VERSION < QT_VERSION_CHECK(5,10,0)
+    SKIP("Qt 5.10 is required to set file modification time");
+#else
+    TestDir dir1(1);
+    const QString tab1 = testTab(1);
+    RUN(Args() << "show" << tab1, "");
+
+    const Args args = Args() << "tab" << tab1;
+
+    RUN(args << "write" << mimeText << "A" << mimeHtml << "<b>B</b>", "");
+
+    const QString fileText = fileNameForId(0);
+    const QString fileHtml = QString(fileText).replace(".txt", ".html");
+    QCOMPARE( dir1.files().join(sep), fileText + sep + fileHtml );
+
+    // Wait so even hashes from file systems with low precision
+    // of modification time are trusted after the item is read again.
+    QTest::qSleep(2100);
+
+    FilePtr file = dir1.file(fileHtml);
+    QVERIFY(file->open(QIODevice::Append));
+    file->write("C");
+    file->close();
+    WAIT_ON_OUTPUT(args << "read" << mimeHtml << "0", "<b>B</b>C");
+
+    // Change text file without changing its size and modification time.
+    file = dir1.file(fileText);
+    QVERIFY(file->open(QIODevice::ReadWrite));
+    const QDateTime lastModified = file->fileTime(QFileDevice::FileModificationTime);
+    file->write("X");
+    file->flush();
+    QVERIFY(file->setFileTime(lastModified, QFileDevice::FileModificationTime));
+    file->close();
+
+    // Unchanged text file is not read again when the item is updated.
+    file = dir1.file(fileHtml);
+    QVERIFY(file->open(QIODevice::Append));
+    file->write("D");
+    file->close();
+    WAIT_ON_OUTPUT(args << "read" << mimeHtml << "0", "<b>B</b>CD");
+    RUN(args << "read" << mimeText << "0", "A");
+#endif
+}
+
+void ItemSyncTests::rewriteFileRightAfterSaving()
+{
+#if QT_VERSION < QT_VERSION_CHECK(5,10,0)
+    SKIP("Qt 5.10 is required to set file modification time");
+#else
+    TestDir dir1(1);
+    const QString tab1 = testTab(1);
+    RUN(Args() << "show" << tab1, "");
+
+    const Args args = Args() << "tab" << tab1;
+
+    RUN(args << "add" << "A", "");
+
+    const QString fileText = fileNameForId(0);
+    QCOMPARE( dir1.files().join(sep), fileText );
+
+    // Rewrite file within the same clock tick, i.e. without changing
+    // its size and modification time.
+    FilePtr file = dir1.file(fileText);
+    QVERIFY(file->open(QIODevice::ReadWrite));
+    const QDateTime lastModified = file->fileTime(QFileDevice::FileModificationTime);
+    file->write("B");
+    file->flush();
+    QVERIFY(file->setFileTime(lastModified, QFileDevice::FileModificationTime));
+    file->close();
+
+    // Hash stored right after saving the file is not trusted.
+    FilePtr otherFile = dir1.file( QString(fileText).replace(".txt", ".html") );
+    QVERIFY(otherFile->open(QIODevice::WriteOnly));
+    otherFile->write("<b>B</b>");
+    otherFile->close();
+    WAIT_ON_OUTPUT(args << "read" << mimeHtml << "0", "<b>B</b>");
+    RUN(args << "read" << mimeText << "0", "B");
+#endif
+}
+
 void ItemSyncTests::itemToClipboard()
 {
     TestDir dir1(1);
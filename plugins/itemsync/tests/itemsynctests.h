@@ -51,6 +51,9 @@ private slots:
 
     void modifyItems();
     void modifyFiles();
+    void updateItemsOnDirectoryChange();
+    void skipReadingUnchangedFiles();
+    void rewriteFileRightAfterSaving();
 
     void itemToClipboard();
 
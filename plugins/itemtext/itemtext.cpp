@@ -30,10 +30,14 @@
 #include <QCursor>
 #include <QMimeData>
 #include <QMouseEvent>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QRunnable>
 #include <QScrollBar>
 #include <QTextBlock>
 #include <QTextCursor>
 #include <QTextDocument>
+#include <QThreadPool>
 #include <QtPlugin>
 
 namespace {
@@ -49,6 +53,9 @@ const int maxLineLengthInPreview = 16 * maxLineLength;
 const int maxLineCount = 4 * 1024;
 const int maxLineCountInPreview = 16 * maxLineCount;
 
+// Larger HTML is parsed in background.
+const int maxRichTextSizeToCreateSynchronously = 8 * 1024;
+
 const char optionUseRichText[] = "use_rich_text";
 const char optionMaximumLines[] = "max_lines";
 const char optionMaximumHeight[] = "max_height";
@@ -107,61 +114,78 @@ void insertEllipsis(QTextCursor *tc)
                     "</span>" );
 }
 
-} // namespace
-
-ItemText::ItemText(const QString &text, const QString &richText, int maxLines, int lineLength, int maximumHeight, QWidget *parent)
-    : QTextEdit(parent)
-    , ItemWidget(this)
-    , m_textDocument()
-    , m_maximumHeight(maximumHeight)
+/**
+ * Returns first @a maxLines lines of @a text and sets @a rest to the remaining
+ * text (starting with the new line character).
+ */
+QString firstLines(const QString &text, int maxLines, QString *rest)
 {
-    m_textDocument.setDefaultFont(font());
+    if (maxLines <= 0)
+        return text;
+
+    int i = -1;
+    for (int lines = 0; lines < maxLines; ++lines) {
+        i = text.indexOf('\n', i + 1);
+        if (i == -1)
+            return text;
+    }
 
-    // Disable slow word wrapping initially.
-    QTextOption option = m_textDocument.defaultTextOption();
-    option.setWrapMode(QTextOption::NoWrap);
-    m_textDocument.setDefaultTextOption(option);
+    *rest = text.mid(i);
+    return text.left(i);
+}
 
-    setReadOnly(true);
-    setUndoRedoEnabled(false);
-    setTextInteractionFlags(
-                textInteractionFlags() | Qt::LinksAccessibleByMouse);
+/// Creates text document and elides it (the slow part of creating ItemText).
+void buildTextDocument(
+        ItemText::Document *result, const QString &text, const QString &richText,
+        int maxLines, int lineLength, const QFont &font)
+{
+    result->document.reset(new QTextDocument);
+    QTextDocument &doc = *result->document;
 
-    setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
-    setFrameStyle(QFrame::NoFrame);
+    doc.setDefaultFont(font);
 
-    setContextMenuPolicy(Qt::NoContextMenu);
+    // Disable slow word wrapping initially.
+    QTextOption option = doc.defaultTextOption();
+    option.setWrapMode(QTextOption::NoWrap);
+    doc.setDefaultTextOption(option);
 
     if ( !richText.isEmpty() ) {
-        m_textDocument.setHtml(richText);
+        doc.setHtml(richText);
         // Use plain text instead if rendering HTML fails or result is empty.
-        m_isRichText = !m_textDocument.isEmpty();
+        result->isRichText = !doc.isEmpty();
     }
 
-    if (!m_isRichText)
-        m_textDocument.setPlainText(text);
+    if (!result->isRichText) {
+        // Avoid creating document from lines which would be elided anyway.
+        doc.setPlainText( firstLines(text, maxLines, &result->elidedText) );
+    }
 
-    m_textDocument.setDocumentMargin(0);
+    doc.setDocumentMargin(0);
 
-    if (maxLines > 0) {
-        QTextBlock block = m_textDocument.findBlockByLineNumber(maxLines);
+    if ( !result->elidedText.isEmpty() ) {
+        QTextCursor tc(&doc);
+        tc.movePosition(QTextCursor::End);
+        result->ellipsisPosition = tc.position();
+        insertEllipsis(&tc);
+    } else if (result->isRichText && maxLines > 0) {
+        QTextBlock block = doc.findBlockByLineNumber(maxLines);
         if (block.isValid()) {
-            QTextCursor tc(&m_textDocument);
+            QTextCursor tc(&doc);
             tc.setPosition(block.position() - 1);
             tc.movePosition(QTextCursor::End, QTextCursor::KeepAnchor);
 
-            m_elidedFragment = tc.selection();
+            result->elidedFragment = tc.selection();
             tc.removeSelectedText();
 
-            m_ellipsisPosition = tc.position();
+            result->ellipsisPosition = tc.position();
             insertEllipsis(&tc);
         }
     }
 
     if (lineLength > 0) {
-        for ( auto block = m_textDocument.begin(); block.isValid(); block = block.next() ) {
+        for ( auto block = doc.begin(); block.isValid(); block = block.next() ) {
             if ( block.length() > lineLength ) {
-                QTextCursor tc(&m_textDocument);
+                QTextCursor tc(&doc);
                 tc.setPosition(block.position() + lineLength);
                 tc.setPosition(block.position() + block.length() - 1, QTextCursor::KeepAnchor);
                 insertEllipsis(&tc);
@@ -169,15 +193,139 @@ ItemText::ItemText(const QString &text, const QString &richText, int maxLines, i
         }
     }
 
-    if (m_isRichText)
-        sanitizeTextDocument(&m_textDocument);
+    if (result->isRichText)
+        sanitizeTextDocument(&doc);
+}
+
+const QEvent::Type documentReadyEventType =
+        static_cast<QEvent::Type>(QEvent::registerEventType());
+
+class DocumentReadyEvent final : public QEvent {
+public:
+    explicit DocumentReadyEvent(ItemText::Document *document)
+        : QEvent(documentReadyEventType)
+        , m_document(document)
+    {
+    }
+
+    ItemText::Document *document() const { return m_document.get(); }
+
+private:
+    std::unique_ptr<ItemText::Document> m_document;
+};
+
+} // namespace
+
+/**
+ * Receiver of documents created in background.
+ *
+ * The item is unset in ItemText destructor so the documents are not posted
+ * to destroyed widget.
+ */
+struct ItemText::DocumentReceiver {
+    QMutex mutex;
+    ItemText *item = nullptr;
+};
+
+namespace {
+
+class DocumentTask final : public QRunnable {
+public:
+    DocumentTask(
+            const std::shared_ptr<ItemText::DocumentReceiver> &receiver,
+            const QString &text, const QString &richText,
+            int maxLines, int lineLength, const QFont &font)
+        : m_receiver(receiver)
+        , m_text(text)
+        , m_richText(richText)
+        , m_maxLines(maxLines)
+        , m_lineLength(lineLength)
+        , m_font(font)
+    {
+    }
+
+    void run() override
+    {
+        {
+            QMutexLocker lock(&m_receiver->mutex);
+            if (!m_receiver->item)
+                return;
+        }
+
+        std::unique_ptr<ItemText::Document> result(new ItemText::Document);
+        buildTextDocument(result.get(), m_text, m_richText, m_maxLines, m_lineLength, m_font);
+        result->document->moveToThread( QCoreApplication::instance()->thread() );
+
+        QMutexLocker lock(&m_receiver->mutex);
+        if (m_receiver->item) {
+            QCoreApplication::postEvent(
+                m_receiver->item, new DocumentReadyEvent(result.release()) );
+        }
+    }
+
+private:
+    std::shared_ptr<ItemText::DocumentReceiver> m_receiver;
+    QString m_text;
+    QString m_richText;
+    int m_maxLines;
+    int m_lineLength;
+    QFont m_font;
+};
+
+} // namespace
+
+ItemText::ItemText(
+        const QString &text, const QString &richText, int maxLines, int lineLength, int maximumHeight,
+        QThreadPool *documentPool, QWidget *parent)
+    : QTextEdit(parent)
+    , ItemWidget(this)
+    , m_maximumHeight(maximumHeight)
+{
+    setReadOnly(true);
+    setUndoRedoEnabled(false);
+    setTextInteractionFlags(
+                textInteractionFlags() | Qt::LinksAccessibleByMouse);
+
+    setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
+    setFrameStyle(QFrame::NoFrame);
+
+    setContextMenuPolicy(Qt::NoContextMenu);
+
+    // Parsing large HTML blocks UI so the plain text is used as placeholder
+    // until the rich text document is created in background.
+    const bool createInBackground = richText.size() > maxRichTextSizeToCreateSynchronously;
+
+    Document document;
+    buildTextDocument(
+        &document, text, createInBackground ? QString() : richText,
+        maxLines, lineLength, font() );
+    setTextDocument(&document);
+
+    if (createInBackground) {
+        m_documentReceiver = std::make_shared<DocumentReceiver>();
+        m_documentReceiver->item = this;
+        documentPool->start(
+            new DocumentTask(m_documentReceiver, text, richText, maxLines, lineLength, font()) );
+    }
 
     connect( this, &QTextEdit::selectionChanged,
              this, &ItemText::onSelectionChanged );
 }
 
+ItemText::~ItemText()
+{
+    if (m_documentReceiver) {
+        QMutexLocker lock(&m_documentReceiver->mutex);
+        m_documentReceiver->item = nullptr;
+    }
+}
+
 void ItemText::highlight(const QRegExp &re, const QFont &highlightFont, const QPalette &highlightPalette)
 {
+    m_highlightRegExp = re;
+    m_highlightFont = highlightFont;
+    m_highlightPalette = highlightPalette;
+
     QList<QTextEdit::ExtraSelection> selections;
 
     if ( !re.isEmpty() ) {
@@ -186,7 +334,7 @@ void ItemText::highlight(const QRegExp &re, const QFont &highlightFont, const QP
         selection.format.setForeground( highlightPalette.text() );
         selection.format.setFont(highlightFont);
 
-        QTextCursor cur = m_textDocument.find(re);
+        QTextCursor cur = m_textDocument->find(re);
         int a = cur.position();
         while ( !cur.isNull() ) {
             if ( cur.hasSelection() ) {
@@ -195,11 +343,11 @@ void ItemText::highlight(const QRegExp &re, const QFont &highlightFont, const QP
             } else {
                 cur.movePosition(QTextCursor::NextCharacter);
             }
-            cur = m_textDocument.find(re, cur);
+            cur = m_textDocument->find(re, cur);
             int b = cur.position();
             if (a == b) {
                 cur.movePosition(QTextCursor::NextCharacter);
-                cur = m_textDocument.find(re, cur);
+                cur = m_textDocument->find(re, cur);
                 b = cur.position();
                 if (a == b) break;
             }
@@ -214,27 +362,30 @@ void ItemText::highlight(const QRegExp &re, const QFont &highlightFont, const QP
 
 void ItemText::updateSize(QSize maximumSize, int idealWidth)
 {
+    m_maximumSize = maximumSize;
+    m_idealWidth = idealWidth;
+
     const int scrollBarWidth = verticalScrollBar()->isVisible() ? verticalScrollBar()->width() : 0;
     setMaximumHeight( maximumSize.height() );
     setFixedWidth(idealWidth);
-    m_textDocument.setTextWidth(idealWidth - scrollBarWidth);
+    m_textDocument->setTextWidth(idealWidth - scrollBarWidth);
 
-    QTextOption option = m_textDocument.defaultTextOption();
+    QTextOption option = m_textDocument->defaultTextOption();
     const QTextOption::WrapMode wrapMode = maximumSize.width() > idealWidth
             ? QTextOption::NoWrap : QTextOption::WrapAtWordBoundaryOrAnywhere;
     if (wrapMode != option.wrapMode()) {
         option.setWrapMode(wrapMode);
-        m_textDocument.setDefaultTextOption(option);
+        m_textDocument->setDefaultTextOption(option);
     }
 
     // setDocument() is slow, so postpone this after resized properly
-    if (document() != &m_textDocument)
-        setDocument(&m_textDocument);
+    if (document() != m_textDocument.get())
+        setDocument(m_textDocument.get());
 
-    const QRectF rect = m_textDocument.documentLayout()->frameBoundingRect(m_textDocument.rootFrame());
+    const QRectF rect = m_textDocument->documentLayout()->frameBoundingRect(m_textDocument->rootFrame());
     setFixedWidth( static_cast<int>(rect.right()) );
 
-    QTextCursor tc(&m_textDocument);
+    QTextCursor tc(m_textDocument.get());
     tc.movePosition(QTextCursor::End, QTextCursor::KeepAnchor);
     const auto h = static_cast<int>( cursorRect(tc).bottom() + 2 * logicalDpiY() / 96.0 );
     if (0 < m_maximumHeight && m_maximumHeight < h) {
@@ -246,6 +397,33 @@ void ItemText::updateSize(QSize maximumSize, int idealWidth)
     }
 }
 
+void ItemText::customEvent(QEvent *event)
+{
+    if (event->type() != documentReadyEventType) {
+        QTextEdit::customEvent(event);
+        return;
+    }
+
+    m_documentReceiver = nullptr;
+
+    // Keep the placeholder if the HTML cannot be rendered.
+    auto result = static_cast<DocumentReadyEvent*>(event)->document();
+    if (!result->isRichText)
+        return;
+
+    const std::unique_ptr<QTextDocument> placeholder = std::move(m_textDocument);
+    setTextDocument(result);
+    if (document() == placeholder.get())
+        setDocument( m_textDocument.get() );
+
+    if ( !m_highlightRegExp.isEmpty() )
+        highlight(m_highlightRegExp, m_highlightFont, m_highlightPalette);
+
+    // Resizing the widget notifies the view about the size hint change.
+    if (m_idealWidth != -1)
+        updateSize(m_maximumSize, m_idealWidth);
+}
+
 bool ItemText::eventFilter(QObject *, QEvent *event)
 {
     return ItemWidget::filterMouseEvents(this, event);
@@ -276,20 +454,39 @@ void ItemText::onSelectionChanged()
     if ( m_ellipsisPosition == -1 || textCursor().selectionEnd() <= m_ellipsisPosition )
         return;
 
-    QTextCursor tc(&m_textDocument);
+    QTextCursor tc(m_textDocument.get());
     tc.setPosition(m_ellipsisPosition);
     m_ellipsisPosition = -1;
     tc.movePosition(QTextCursor::End, QTextCursor::KeepAnchor);
 
-    tc.insertFragment(m_elidedFragment);
-    m_elidedFragment = QTextDocumentFragment();
+    if ( m_elidedText.isEmpty() ) {
+        tc.insertFragment(m_elidedFragment);
+        m_elidedFragment = QTextDocumentFragment();
+    } else {
+        tc.insertText(m_elidedText);
+        m_elidedText.clear();
+    }
+}
+
+void ItemText::setTextDocument(Document *document)
+{
+    m_textDocument = std::move(document->document);
+    m_elidedFragment = document->elidedFragment;
+    m_elidedText = document->elidedText;
+    m_ellipsisPosition = document->ellipsisPosition;
+    m_isRichText = document->isRichText;
 }
 
 ItemTextLoader::ItemTextLoader()
+    : m_documentPool(new QThreadPool)
 {
 }
 
-ItemTextLoader::~ItemTextLoader() = default;
+ItemTextLoader::~ItemTextLoader()
+{
+    // Tasks must not outlive the plugin library.
+    m_documentPool->waitForDone();
+}
 
 ItemWidget *ItemTextLoader::create(const QVariantMap &data, QWidget *parent, bool preview) const
 {
@@ -312,13 +509,17 @@ ItemWidget *ItemTextLoader::create(const QVariantMap &data, QWidget *parent, boo
     ItemText *item = nullptr;
     // Always limit text size for performance reasons.
     if (preview) {
-        item = new ItemText(text, richText, maxLineCountInPreview, maxLineLengthInPreview, 0, parent);
+        item = new ItemText(
+            text, richText, maxLineCountInPreview, maxLineLengthInPreview, 0,
+            m_documentPool.get(), parent);
     } else {
         int maxLines = m_settings.value(optionMaximumLines, maxLineCount).toInt();
         if (maxLines <= 0 || maxLines > maxLineCount)
             maxLines = maxLineCount;
         const int maxHeight = m_settings.value(optionMaximumHeight, 0).toInt();
-        item = new ItemText(text, richText, maxLines, maxLineLength, maxHeight, parent);
+        item = new ItemText(
+            text, richText, maxLines, maxLineLength, maxHeight,
+            m_documentPool.get(), parent);
         item->viewport()->installEventFilter(item);
     }
 
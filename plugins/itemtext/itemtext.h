@@ -23,12 +23,17 @@
 #include "gui/icons.h"
 #include "item/itemwidget.h"
 
+#include <QFont>
+#include <QPalette>
+#include <QRegExp>
 #include <QTextDocument>
 #include <QTextDocumentFragment>
 #include <QTextEdit>
 
 #include <memory>
 
+class QThreadPool;
+
 namespace Ui {
 class ItemTextSettings;
 }
@@ -38,7 +43,22 @@ class ItemText final : public QTextEdit, public ItemWidget
     Q_OBJECT
 
 public:
-    ItemText(const QString &text, const QString &richText, int maxLines, int lineLength, int maximumHeight, QWidget *parent);
+    /// Text document with elided content.
+    struct Document {
+        std::unique_ptr<QTextDocument> document;
+        QTextDocumentFragment elidedFragment;
+        QString elidedText;
+        int ellipsisPosition = -1;
+        bool isRichText = false;
+    };
+
+    struct DocumentReceiver;
+
+    ItemText(
+            const QString &text, const QString &richText, int maxLines, int lineLength, int maximumHeight,
+            QThreadPool *documentPool, QWidget *parent);
+
+    ~ItemText();
 
 protected:
     void highlight(const QRegExp &re, const QFont &highlightFont,
@@ -46,6 +66,8 @@ protected:
 
     void updateSize(QSize maximumSize, int idealWidth) override;
 
+    void customEvent(QEvent *event) override;
+
     bool eventFilter(QObject *, QEvent *event) override;
 
     QMimeData *createMimeDataFromSelection() const override;
@@ -53,11 +75,23 @@ protected:
 private:
     void onSelectionChanged();
 
-    QTextDocument m_textDocument;
+    void setTextDocument(Document *document);
+
+    std::unique_ptr<QTextDocument> m_textDocument;
     QTextDocumentFragment m_elidedFragment;
+    QString m_elidedText;
     int m_ellipsisPosition = -1;
     int m_maximumHeight;
     bool m_isRichText = false;
+
+    QSize m_maximumSize;
+    int m_idealWidth = -1;
+
+    QRegExp m_highlightRegExp;
+    QFont m_highlightFont;
+    QPalette m_highlightPalette;
+
+    std::shared_ptr<DocumentReceiver> m_documentReceiver;
 };
 
 class ItemTextLoader final : public QObject, public ItemLoaderInterface
@@ -89,6 +123,8 @@ public:
 private:
     QVariantMap m_settings;
     std::unique_ptr<Ui::ItemTextSettings> ui;
+    /// Creates rich text documents in background.
+    std::unique_ptr<QThreadPool> m_documentPool;
 };
 
 #endif // ITEMTEXT_H
@@ -36,7 +36,7 @@ bool hasSameData(const QVariantMap &data, const QVariantMap &lastData)
 {
     for (auto it = lastData.constBegin(); it != lastData.constEnd(); ++it) {
         const auto &format = it.key();
-        if ( !format.startsWith(COPYQ_MIME_PREFIX)
+        if ( !isInternalFormat(format)
              && !data.contains(format) )
         {
             return false;
@@ -45,9 +45,9 @@ bool hasSameData(const QVariantMap &data, const QVariantMap &lastData)
 
     for (auto it = data.constBegin(); it != data.constEnd(); ++it) {
         const auto &format = it.key();
-        if ( !format.startsWith(COPYQ_MIME_PREFIX)
-             && !data[format].toByteArray().isEmpty()
-             && data[format] != lastData.value(format) )
+        if ( !isInternalFormat(format)
+             && !it.value().toByteArray().isEmpty()
+             && it.value() != lastData.value(format) )
         {
             return false;
         }
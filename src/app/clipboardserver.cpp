@@ -446,6 +446,14 @@ void ClipboardServer::onClientMessageReceived(
         clientData.proxy->callFunction(message);
         break;
     }
+    case CommandFunctionCalls: {
+        const auto &clientData = m_clients.value(clientId);
+        if (!clientData.isValid())
+            return;
+
+        clientData.proxy->callFunctions(message);
+        break;
+    }
     case CommandReceiveData: {
         const auto &clientData = m_clients.value(clientId);
         if (!clientData.isValid())
@@ -23,15 +23,22 @@
 #include "common/contenttype.h"
 #include "common/mimetypes.h"
 #include "common/textdata.h"
+#include "common/timer.h"
 #include "gui/clipboardbrowser.h"
 #include "gui/mainwindow.h"
 #include "item/serialize.h"
 
 #include <QObject>
 #include <QPersistentModelIndex>
+#include <QTimer>
 
 namespace {
 
+/// Output items are added to tab at once after this many items are received ...
+const int maxPendingOutputItems = 100;
+/// ... or after this interval since first pending item was received.
+const int pendingOutputItemsIntervalMs = 100;
+
 template <typename ActionOutput>
 void connectActionOutput(Action *action, ActionOutput *actionOutput)
 {
@@ -58,6 +65,7 @@ public:
         , m_tab(outputTabName)
         , m_sep(itemSeparator)
     {
+        initSingleShotTimer( &m_timerFlush, pendingOutputItemsIntervalMs, this, &ActionOutputItems::flush );
         connectActionOutput(action, this);
     }
 
@@ -74,14 +82,29 @@ public:
     {
         if ( !m_lastOutput.isEmpty() )
             addItems(QStringList() << m_lastOutput);
+        flush();
     }
 
 private:
     void addItems(const QStringList &items)
     {
-        ClipboardBrowser *c = m_tab.isEmpty() ? m_wnd->browser() : m_wnd->tab(m_tab);
         for (const auto &item : items)
-            c->add( createDataMap(m_outputFormat, item) );
+            m_items.append( createDataMap(m_outputFormat, item) );
+
+        if ( m_items.size() >= maxPendingOutputItems )
+            flush();
+        else if ( !m_timerFlush.isActive() )
+            m_timerFlush.start();
+    }
+
+    void flush()
+    {
+        m_timerFlush.stop();
+        if ( m_items.isEmpty() )
+            return;
+
+        m_wnd->addToTab(m_tab, m_items);
+        m_items.clear();
     }
 
     MainWindow *m_wnd;
@@ -89,6 +112,8 @@ private:
     QString m_tab;
     QRegExp m_sep;
     QString m_lastOutput;
+    QVector<QVariantMap> m_items;
+    QTimer m_timerFlush;
 };
 
 class ActionOutputItem final : public QObject
@@ -120,8 +145,7 @@ public:
         if ( m_output.isEmpty() )
             return;
 
-        ClipboardBrowser *c = m_tab.isEmpty() ? m_wnd->browser() : m_wnd->tab(m_tab);
-        c->add( createDataMap(m_outputFormat, m_output) );
+        m_wnd->addToTab( m_tab, QVector<QVariantMap>() << createDataMap(m_outputFormat, m_output) );
     }
 
 private:
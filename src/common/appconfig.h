@@ -113,6 +113,11 @@ struct show_simple_items : Config<bool> {
     static Value defaultValue() { return false; }
 };
 
+struct paint_items_from_snapshots : Config<bool> {
+    static QString name() { return "paint_items_from_snapshots"; }
+    static Value defaultValue() { return false; }
+};
+
 struct number_search : Config<bool> {
     static QString name() { return "number_search"; }
     static Value defaultValue() { return false; }
@@ -0,0 +1,138 @@
+/*
+    Copyright (c) 2019, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "commandmatcher.h"
+
+#include "common/mimetypes.h"
+#include "common/textdata.h"
+
+namespace {
+
+enum MatchResult : signed char {
+    Unknown = -1,
+    NoMatch = 0,
+    Match = 1
+};
+
+int addPattern(const QRegExp &re, QVector<QRegExp> *patterns)
+{
+    if ( re.isEmpty() )
+        return -1;
+
+    const int i = patterns->indexOf(re);
+    if (i != -1)
+        return i;
+
+    patterns->append(re);
+    return patterns->size() - 1;
+}
+
+bool takesSerializedItem(const QString &input)
+{
+    return input == mimeItems || input == "!OUTPUT";
+}
+
+bool hasInput(const QString &input, const QVariantMap &data)
+{
+    return input.isEmpty() || takesSerializedItem(input) || data.contains(input);
+}
+
+bool matchPattern(
+        int patternIndex, const QVector<QRegExp> &patterns, const QString &text,
+        QVector<MatchResult> *results)
+{
+    if (patternIndex == -1)
+        return true;
+
+    MatchResult &result = (*results)[patternIndex];
+    if (result == Unknown)
+        result = patterns[patternIndex].indexIn(text) != -1 ? Match : NoMatch;
+
+    return result == Match;
+}
+
+} // namespace
+
+CommandMatcher::CommandMatcher(const QVector<Command> &commands)
+    : m_commands(commands)
+{
+    m_commandPatterns.reserve( commands.size() );
+
+    for (const auto &command : commands) {
+        int input = m_inputs.indexOf(command.input);
+        if (input == -1) {
+            input = m_inputs.size();
+            m_inputs.append(command.input);
+        }
+
+        m_commandPatterns.append({
+            input,
+            addPattern(command.re, &m_textPatterns),
+            addPattern(command.wndre, &m_windowTitlePatterns)
+        });
+    }
+}
+
+QVector<int> CommandMatcher::matchingCommands(const QVariantMap &data, int first) const
+{
+    QVector<int> result;
+
+    QVector<MatchResult> hasInputs( m_inputs.size(), Unknown );
+    QVector<MatchResult> textResults( m_textPatterns.size(), Unknown );
+    QVector<MatchResult> windowTitleResults( m_windowTitlePatterns.size(), Unknown );
+
+    // Convert data to text only if needed.
+    QString text;
+    bool hasText = false;
+    QString windowTitle;
+    bool hasWindowTitle = false;
+
+    for (int i = qMax(0, first); i < m_commands.size(); ++i) {
+        const CommandPatterns &patterns = m_commandPatterns[i];
+
+        MatchResult &inputResult = hasInputs[patterns.input];
+        if (inputResult == Unknown)
+            inputResult = hasInput(m_inputs[patterns.input], data) ? Match : NoMatch;
+        if (inputResult == NoMatch)
+            continue;
+
+        // Disallow applying action that takes serialized item more times.
+        const Command &command = m_commands[i];
+        if ( takesSerializedItem(command.input) && data.contains(command.output) )
+            continue;
+
+        if (patterns.text != -1 && !hasText) {
+            text = getTextData(data, mimeText);
+            hasText = true;
+        }
+        if ( !matchPattern(patterns.text, m_textPatterns, text, &textResults) )
+            continue;
+
+        if (patterns.windowTitle != -1 && !hasWindowTitle) {
+            windowTitle = getTextData(data, mimeWindowTitle);
+            hasWindowTitle = true;
+        }
+        if ( !matchPattern(patterns.windowTitle, m_windowTitlePatterns, windowTitle, &windowTitleResults) )
+            continue;
+
+        result.append(i);
+    }
+
+    return result;
+}
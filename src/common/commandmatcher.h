@@ -0,0 +1,74 @@
+/*
+    Copyright (c) 2019, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef COMMANDMATCHER_H
+#define COMMANDMATCHER_H
+
+#include "common/command.h"
+
+#include <QRegExp>
+#include <QStringList>
+#include <QVariantMap>
+#include <QVector>
+
+/**
+ * Finds commands which can be applied to item data.
+ *
+ * Checks required input format and regular expressions for item text and
+ * window title (Command::input, Command::re and Command::wndre).
+ *
+ * Matcher is built once for a command list. Commands are grouped by input
+ * format so availability of each format is checked only once. Equal regular
+ * expressions are evaluated only once for given data.
+ */
+class CommandMatcher final {
+public:
+    CommandMatcher() = default;
+
+    explicit CommandMatcher(const QVector<Command> &commands);
+
+    const QVector<Command> &commands() const { return m_commands; }
+
+    bool isEmpty() const { return m_commands.isEmpty(); }
+
+    /**
+     * Return indexes of matching commands in ascending order.
+     *
+     * Only commands with index @a first or greater are checked.
+     */
+    QVector<int> matchingCommands(const QVariantMap &data, int first = 0) const;
+
+private:
+    struct CommandPatterns {
+        /// Index to m_inputs.
+        int input;
+        /// Index to m_textPatterns or -1 to match any text.
+        int text;
+        /// Index to m_windowTitlePatterns or -1 to match any window title.
+        int windowTitle;
+    };
+
+    QVector<Command> m_commands;
+    QVector<CommandPatterns> m_commandPatterns;
+    QStringList m_inputs;
+    QVector<QRegExp> m_textPatterns;
+    QVector<QRegExp> m_windowTitlePatterns;
+};
+
+#endif // COMMANDMATCHER_H
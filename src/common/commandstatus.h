@@ -44,6 +44,9 @@ enum CommandStatus {
     CommandData = 12,
 
     CommandReceiveData = 13,
+
+    /** Batch of function calls (see CommandFunctionCall) */
+    CommandFunctionCalls = 14,
 };
 
 #endif // COMMANDSTATUS_H
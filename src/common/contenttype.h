@@ -59,7 +59,25 @@ enum {
     color,
 
     /// If true, hide content of item (not notes, tags etc.).
-    isHidden
+    isHidden,
+
+    /// Text from text and internal formats including format names (for search index).
+    searchText,
+
+    /**
+     * Get data for building search text in other thread (see searchText()).
+     *
+     * Data of other formats can be omitted if these reference memory-mapped tab file.
+     */
+    searchData,
+
+    /**
+     * Get data as QVariantMap without copying data referencing memory-mapped
+     * tab file.
+     *
+     * The data must not be used after the item is removed from model.
+     */
+    mappedData
 };
 
 }
@@ -19,6 +19,8 @@
 
 #include "mimetypes.h"
 
+#include <QString>
+
 const char mimeText[] = "text/plain";
 const char mimeHtml[] = "text/html";
 const char mimeUriList[] = "text/uri-list";
@@ -34,3 +36,9 @@ const char mimeHidden[] = COPYQ_MIME_PREFIX "hidden";
 const char mimeShortcut[] = COPYQ_MIME_PREFIX "shortcut";
 const char mimeColor[] = COPYQ_MIME_PREFIX "color";
 const char mimeOutputTab[] = COPYQ_MIME_PREFIX "output-tab";
+const char mimeItemHash[] = COPYQ_MIME_PREFIX "item-hash";
+
+bool isInternalFormat(const QString &format)
+{
+    return format.startsWith( QLatin1String(COPYQ_MIME_PREFIX) );
+}
@@ -20,6 +20,8 @@
 #ifndef MIMETYPES_H
 #define MIMETYPES_H
 
+class QString;
+
 #define COPYQ_MIME_PREFIX "application/x-copyq-"
 extern const char mimeText[];
 extern const char mimeHtml[];
@@ -36,5 +38,10 @@ extern const char mimeHidden[];
 extern const char mimeShortcut[];
 extern const char mimeColor[];
 extern const char mimeOutputTab[];
+/// Item hash passed to plugins when creating item widget (see ItemLoaderInterface::create()).
+extern const char mimeItemHash[];
+
+/// Returns true for formats used internally by the application (COPYQ_MIME_PREFIX).
+bool isInternalFormat(const QString &format);
 
 #endif // MIMETYPES_H
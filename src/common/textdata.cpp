@@ -25,8 +25,49 @@
 #include <QString>
 #include <Qt>
 
+#include <cstring>
+
 namespace {
 
+/// 64-bit hash of bytes (MurmurHash64A).
+quint64 hashBytes(const char *bytes, int size, quint64 seed)
+{
+    const quint64 m = Q_UINT64_C(0xc6a4a7935bd1e995);
+    const int r = 47;
+
+    quint64 h = seed ^ (static_cast<quint64>(size) * m);
+
+    const char *end = bytes + (size / 8) * 8;
+    for ( ; bytes != end; bytes += 8 ) {
+        quint64 k;
+        std::memcpy(&k, bytes, sizeof(k));
+        k *= m;
+        k ^= k >> r;
+        k *= m;
+        h ^= k;
+        h *= m;
+    }
+
+    const auto tail = reinterpret_cast<const uchar *>(bytes);
+    const int tailSize = size % 8;
+    if (tailSize > 0) {
+        for (int i = 0; i < tailSize; ++i)
+            h ^= static_cast<quint64>(tail[i]) << (8 * i);
+        h *= m;
+    }
+
+    h ^= h >> r;
+    h *= m;
+    h ^= h >> r;
+
+    return h;
+}
+
+quint64 hashBytes(const QByteArray &bytes, quint64 seed)
+{
+    return hashBytes(bytes.constData(), bytes.size(), seed);
+}
+
 QString escapeHtmlSpaces(const QString &str)
 {
     QString str2 = str;
@@ -37,20 +78,24 @@ QString escapeHtmlSpaces(const QString &str)
 
 } // namespace
 
-uint hash(const QVariantMap &data)
+quint64 hash(const QVariantMap &data)
 {
-    uint hash = 0;
+    quint64 hash = 0;
 
+    // Formats are sorted in the map so the result doesn't depend on insertion order.
     for (auto it = data.constBegin(); it != data.constEnd(); ++it) {
         const auto &mime = it.key();
 
         // Skip some special data.
         if (mime == mimeWindowTitle || mime == mimeOwner || mime == mimeClipboardMode)
             continue;
-        hash ^= qHash(data[mime].toByteArray()) + qHash(mime);
+
+        hash = hashBytes( mime.toUtf8(), hash );
+        hash = hashBytes( it.value().toByteArray(), hash );
     }
 
-    return hash;
+    // Zero is reserved for items with hash not yet computed.
+    return hash == 0 ? 1 : hash;
 }
 
 QString quoteString(const QString &str)
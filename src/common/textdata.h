@@ -25,7 +25,12 @@
 class QByteArray;
 class QString;
 
-uint hash(const QVariantMap &data);
+/**
+ * Return 64-bit hash of item data.
+ *
+ * Window title, owner and clipboard mode formats are ignored.
+ */
+quint64 hash(const QVariantMap &data);
 
 QString quoteString(const QString &str);
 
@@ -0,0 +1,155 @@
+/*
+    Copyright (c) 2019, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "backgrounditemfilter.h"
+
+#include "item/clipboarditem.h"
+
+#include <QRunnable>
+#include <QThread>
+#include <QThreadPool>
+
+namespace {
+
+/// Number of items matched in single task.
+const int itemsPerTask = 500;
+
+class FilterItemsTask final : public QRunnable {
+public:
+    FilterItemsTask(
+            const QRegExp &re, const QVector<QVariantMap> &items, int begin, int end,
+            QVector<int> *positions, const QAtomicInt &cancelled)
+        : m_re(re)
+        , m_items(items)
+        , m_begin(begin)
+        , m_end(end)
+        , m_positions(positions)
+        , m_cancelled(cancelled)
+    {
+    }
+
+    void run() override
+    {
+        for (int i = m_begin; i < m_end && m_cancelled.load() == 0; ++i) {
+            if ( m_re.isEmpty() || m_re.indexIn(searchText(m_items[i])) != -1 )
+                m_positions->append(i);
+        }
+    }
+
+private:
+    QRegExp m_re;
+    const QVector<QVariantMap> &m_items;
+    int m_begin;
+    int m_end;
+    QVector<int> *m_positions;
+    const QAtomicInt &m_cancelled;
+};
+
+/// Returns false if matching whole text can miss matches in text from single format.
+bool canMatchAllFormats(const QRegExp &re)
+{
+    if ( re.patternSyntax() != QRegExp::RegExp && re.patternSyntax() != QRegExp::RegExp2 )
+        return re.patternSyntax() == QRegExp::FixedString;
+
+    const QString pattern = re.pattern();
+    return !pattern.contains('^')
+        && !pattern.contains('$')
+        && !pattern.contains("(?!");
+}
+
+class SearchTask final : public QRunnable {
+public:
+    SearchTask(
+            BackgroundItemFilter *filter, int searchId, const QRegExp &re,
+            const QVector<QVariantMap> &items, const std::shared_ptr<QAtomicInt> &cancelled)
+        : m_filter(filter)
+        , m_searchId(searchId)
+        , m_re(re)
+        , m_items(items)
+        , m_cancelled(cancelled)
+    {
+    }
+
+    void run() override
+    {
+        QThreadPool pool;
+        const int taskCount = qMax(1, QThread::idealThreadCount());
+        pool.setMaxThreadCount(taskCount);
+
+        const int itemsPerBatch = itemsPerTask * taskCount;
+        for (int begin = 0; begin < m_items.size(); begin += itemsPerBatch) {
+            const int end = qMin(m_items.size(), begin + itemsPerBatch);
+
+            QVector<QVector<int>> taskPositions( (end - begin + itemsPerTask - 1) / itemsPerTask );
+            for (int i = 0; i < taskPositions.size(); ++i) {
+                const int taskBegin = begin + i * itemsPerTask;
+                const int taskEnd = qMin(end, taskBegin + itemsPerTask);
+                pool.start( new FilterItemsTask(m_re, m_items, taskBegin, taskEnd, &taskPositions[i], *m_cancelled) );
+            }
+            pool.waitForDone();
+
+            if ( m_cancelled->load() != 0 )
+                return;
+
+            QVector<int> positions;
+            for (const auto &p : taskPositions)
+                positions += p;
+
+            if ( !positions.isEmpty() )
+                emit m_filter->itemsMatched(m_searchId, positions);
+        }
+
+        emit m_filter->searchFinished(m_searchId);
+    }
+
+private:
+    BackgroundItemFilter *m_filter;
+    int m_searchId;
+    QRegExp m_re;
+    QVector<QVariantMap> m_items;
+    std::shared_ptr<QAtomicInt> m_cancelled;
+};
+
+} // namespace
+
+BackgroundItemFilter::BackgroundItemFilter(QObject *parent)
+    : QObject(parent)
+{
+    m_searchPool.setMaxThreadCount(1);
+}
+
+BackgroundItemFilter::~BackgroundItemFilter()
+{
+    cancel();
+    m_searchPool.waitForDone();
+}
+
+void BackgroundItemFilter::search(int searchId, const QRegExp &re, const QVector<QVariantMap> &items)
+{
+    cancel();
+
+    m_cancelled = std::make_shared<QAtomicInt>(0);
+    const QRegExp searchRe = canMatchAllFormats(re) ? re : QRegExp();
+    m_searchPool.start( new SearchTask(this, searchId, searchRe, items, m_cancelled) );
+}
+
+void BackgroundItemFilter::cancel()
+{
+    if (m_cancelled)
+        m_cancelled->store(1);
+}
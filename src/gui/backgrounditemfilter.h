@@ -0,0 +1,79 @@
+/*
+    Copyright (c) 2019, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef BACKGROUNDITEMFILTER_H
+#define BACKGROUNDITEMFILTER_H
+
+#include <QAtomicInt>
+#include <QObject>
+#include <QRegExp>
+#include <QThreadPool>
+#include <QVariantMap>
+#include <QVector>
+
+#include <memory>
+
+/**
+ * Matches items in background (using multiple threads for many items).
+ *
+ * Results are reported in batches, starting with first items.
+ *
+ * Matching is done on text from all text formats (see contentType::searchText)
+ * so it can match more items than ItemFactory::matches() but never less.
+ * The text is also built in background from item data (see contentType::searchData).
+ * Matched items still need to be checked in main thread.
+ */
+class BackgroundItemFilter final : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit BackgroundItemFilter(QObject *parent = nullptr);
+
+    ~BackgroundItemFilter();
+
+    /**
+     * Cancel current search and start new one.
+     *
+     * If expression cannot be used on text from all formats (e.g. contains anchors),
+     * all items are reported as matching.
+     */
+    void search(int searchId, const QRegExp &re, const QVector<QVariantMap> &items);
+
+    /**
+     * Cancel current search.
+     *
+     * Doesn't wait for the search to finish, cancelled search may still
+     * report some matches (these can be ignored using search ID).
+     */
+    void cancel();
+
+signals:
+    /// Positions of matching items (in ascending order).
+    void itemsMatched(int searchId, const QVector<int> &positions);
+
+    /// Emitted after last batch of matching items unless search was cancelled.
+    void searchFinished(int searchId);
+
+private:
+    /// Runs searches one after another.
+    QThreadPool m_searchPool;
+    std::shared_ptr<QAtomicInt> m_cancelled;
+};
+
+#endif // BACKGROUNDITEMFILTER_H
@@ -58,6 +58,9 @@
 
 namespace {
 
+/// Items after these are filtered in background.
+const int maxSyncFilterRowCount = 1000;
+
 enum class MoveType {
     Absolute,
     Relative
@@ -255,6 +258,7 @@ ClipboardBrowser::ClipboardBrowser(
     , m_tabName(tabName)
     , m_maxItemCount(sharedData->maxItems)
     , m(this)
+    , m_searchIndex(&m)
     , d(this, sharedData)
     , m_editor(nullptr)
     , m_sharedData(sharedData)
@@ -283,6 +287,11 @@ ClipboardBrowser::ClipboardBrowser(
     connect( &m_timerDragDropScroll, &QTimer::timeout,
              this, &ClipboardBrowser::dragDropScroll );
 
+    connect( &m_backgroundFilter, &BackgroundItemFilter::itemsMatched,
+             this, &ClipboardBrowser::onFilterItemsMatched );
+    connect( &m_backgroundFilter, &BackgroundItemFilter::searchFinished,
+             this, &ClipboardBrowser::onFilterFinished );
+
     // ScrollPerItem doesn't work well with hidden items
     setVerticalScrollMode(QAbstractItemView::ScrollPerPixel);
 
@@ -302,7 +311,7 @@ ClipboardBrowser::~ClipboardBrowser()
     saveUnsavedItems();
 }
 
-bool ClipboardBrowser::moveToTop(uint itemHash)
+bool ClipboardBrowser::moveToTop(quint64 itemHash)
 {
     const int row = m.findItem(itemHash);
     if (row < 0)
@@ -372,7 +381,11 @@ QVariantMap ClipboardBrowser::itemData(const QModelIndex &index) const
 
 bool ClipboardBrowser::hideFiltered(int row)
 {
-    const bool hide = isFiltered(row);
+    return hideFiltered( row, isFiltered(row) );
+}
+
+bool ClipboardBrowser::hideFiltered(int row, bool hide)
+{
     setRowHidden(row, hide);
 
     auto w = d.cacheOrNull(row);
@@ -758,7 +771,7 @@ QVariantMap ClipboardBrowser::copyIndexes(const QModelIndexList &indexes) const
             for (auto it = itemData.constBegin(); it != itemData.constEnd(); ++it) {
                 const auto &format = it.key();
                 if ( usedFormats.contains(format) ) {
-                    if ( format.startsWith(COPYQ_MIME_PREFIX) )
+                    if ( isInternalFormat(format) )
                         data[format].clear();
                     else
                         data.remove(format);
@@ -814,7 +827,7 @@ void ClipboardBrowser::paste(const QVariantMap &data, int destinationRow)
         const QByteArray bytes = data[mimeItems].toByteArray();
         QDataStream stream(bytes);
 
-        QList<QVariantMap> dataList;
+        QVector<QVariantMap> dataList;
         while ( !stream.atEnd() ) {
             QVariantMap dataMap;
             stream >> dataMap;
@@ -1077,20 +1090,14 @@ void ClipboardBrowser::paintEvent(QPaintEvent *e)
     // Hide items outside viewport.
     const auto firstVisibleIndex = indexNear(0);
     if ( firstVisibleIndex.isValid() ) {
-        for (int row = firstVisibleIndex.row() - 1; row >= 0; --row) {
-            auto w = d.cacheOrNull(row);
-            if (w)
-                w->widget()->hide();
-        }
+        for (int row = firstVisibleIndex.row() - 1; row >= 0; --row)
+            d.hideItemWidget(row);
     }
     const int h = viewport()->contentsRect().height();
     const auto lastVisibleIndex = indexNear(h - 3 * spacing());
     if ( lastVisibleIndex.isValid() ) {
-        for (int row = lastVisibleIndex.row() + 1; row < m.rowCount(); ++row) {
-            auto w = d.cacheOrNull(row);
-            if (w)
-                w->widget()->hide();
-        }
+        for (int row = lastVisibleIndex.row() + 1; row < m.rowCount(); ++row)
+            d.hideItemWidget(row);
     }
 
     preloadCurrentPage();
@@ -1366,6 +1373,11 @@ void ClipboardBrowser::filterItems(const QRegExp &re)
 
     d.setSearch(re);
 
+    // Cancel filtering items in background.
+    m_backgroundFilter.cancel();
+    m_filterIndexes.clear();
+    ++m_filterSearchId;
+
     // If search string is a number, highlight item in that row.
     bool filterByRowNumber = !m_sharedData->numberSearch;
     if (filterByRowNumber)
@@ -1381,18 +1393,83 @@ void ClipboardBrowser::filterItems(const QRegExp &re)
 
         scrollTo(currentIndex(), PositionAtCenter);
     } else {
-        for ( ; row < length() && hideFiltered(row); ++row ) {}
-
-        setCurrent(row);
+        // Hide items which surely don't match without checking each of them.
+        QVector<bool> candidates;
+        if ( !m_itemSaver || !m_searchIndex.findCandidates(re, &candidates) )
+            candidates.clear();
+
+        const auto hideFilteredRow = [&](int filteredRow) {
+            if ( !candidates.isEmpty() && !candidates[filteredRow] && filteredRow != m_filterRow )
+                return hideFiltered(filteredRow, true);
+            return hideFiltered(filteredRow);
+        };
+
+        // Check first items immediately, the rest is filtered in background.
+        const int syncRowCount = qMin( length(), maxSyncFilterRowCount );
+
+        for ( ; row < syncRowCount && hideFilteredRow(row); ++row ) {}
+
+        if ( row < syncRowCount || syncRowCount == length() )
+            setCurrent(row);
+
+        for ( ; row < syncRowCount; ++row )
+            hideFilteredRow(row);
+
+        // Search text is built in background from data shared with items.
+        QVector<QVariantMap> items;
+        for ( ; row < length(); ++row ) {
+            // Keep items hidden until they are matched.
+            if ( !m_itemSaver || row == m_filterRow || (!candidates.isEmpty() && !candidates[row]) ) {
+                hideFilteredRow(row);
+            } else {
+                hideFiltered(row, true);
+                m_filterIndexes.append( QPersistentModelIndex(index(row)) );
+                items.append( index(row).data(contentType::searchData).toMap() );
+            }
+        }
 
-        for ( ; row < length(); ++row )
-            hideFiltered(row);
+        if ( !items.isEmpty() )
+            m_backgroundFilter.search(m_filterSearchId, re, items);
+        else if (syncRowCount < length())
+            onFilterFinished(m_filterSearchId);
 
         if ( filterByRowNumber && m_filterRow >= 0 && m_filterRow < m.rowCount() )
             setCurrent(m_filterRow);
     }
 }
 
+void ClipboardBrowser::onFilterItemsMatched(int searchId, const QVector<int> &positions)
+{
+    if (searchId != m_filterSearchId)
+        return;
+
+    for (const int position : positions) {
+        const QModelIndex ind = m_filterIndexes.value(position);
+        if ( !ind.isValid() )
+            continue;
+
+        const int row = ind.row();
+        if ( !hideFiltered(row) ) {
+            const QModelIndex current = currentIndex();
+            if ( !current.isValid() || isRowHidden(current.row()) )
+                setCurrent(row);
+        }
+    }
+}
+
+void ClipboardBrowser::onFilterFinished(int searchId)
+{
+    if (searchId != m_filterSearchId)
+        return;
+
+    m_filterIndexes.clear();
+
+    // Nothing matched, unset current item.
+    const QModelIndex current = currentIndex();
+    if ( !current.isValid() || isRowHidden(current.row()) )
+        setCurrent( length() );
+}
+
 void ClipboardBrowser::moveToClipboard(const QModelIndex &ind)
 {
     if ( ind.isValid() )
@@ -1666,6 +1743,57 @@ bool ClipboardBrowser::add(const QVariantMap &data, int row)
     return true;
 }
 
+bool ClipboardBrowser::addItems(const QVector<QVariantMap> &items, int row)
+{
+    if ( items.isEmpty() )
+        return true;
+
+    if ( !isLoaded() ) {
+        loadItems();
+        if ( !isLoaded() )
+            return false;
+    }
+
+    // When adding to top, items which wouldn't fit would be removed anyway.
+    const int count = row == 0 ? qMin(items.size(), m_maxItemCount) : items.size();
+
+    // Some items cannot be removed (e.g. pinned) so add as many items as possible.
+    if ( !allocateSpaceForNewItems(count) ) {
+        for (const auto &item : items) {
+            if ( !add(item, row) )
+                return false;
+        }
+        return true;
+    }
+
+    if (row < 0) {
+        m.insertItems(items, m.rowCount());
+        return true;
+    }
+
+    // Last item ends up on the target row.
+    QVector<QVariantMap> reversedItems;
+    reversedItems.reserve(count);
+    for (int i = items.size() - 1; i >= items.size() - count; --i)
+        reversedItems.append(items[i]);
+
+    m.insertItems( reversedItems, qMin(row, m.rowCount()) );
+
+    return true;
+}
+
+bool ClipboardBrowser::appendItems(const QVector<QVariantMap> &items)
+{
+    if ( !isLoaded() ) {
+        loadItems();
+        if ( !isLoaded() )
+            return false;
+    }
+
+    m.insertItems( items, m.rowCount() );
+    return true;
+}
+
 void ClipboardBrowser::addUnique(const QVariantMap &data, ClipboardMode mode)
 {
     if ( moveToTop(hash(data)) ) {
@@ -1721,11 +1849,13 @@ bool ClipboardBrowser::loadItems()
     m.blockSignals(true);
     m_itemSaver = ::loadItems(m_tabName, m, m_sharedData->itemFactory, m_maxItemCount);
     m.blockSignals(false);
+    m_searchIndex.invalidate();
 
     if ( !isLoaded() )
         return false;
 
     d.rowsInserted(QModelIndex(), 0, m.rowCount());
+    addPendingItems();
     if ( hasFocus() )
         setCurrent(0);
     onItemCountChanged();
@@ -1733,6 +1863,31 @@ bool ClipboardBrowser::loadItems()
     return true;
 }
 
+void ClipboardBrowser::addPendingItems()
+{
+    if ( m_tabName.isEmpty() )
+        return;
+
+    const auto items = loadPendingItems(m_tabName);
+    if ( items.isEmpty() ) {
+        removePendingItems(m_tabName);
+        return;
+    }
+
+    for (const auto &item : items) {
+        if (item.unique)
+            addUnique(item.data, item.mode);
+        else if ( allocateSpaceForNewItems(1) )
+            m.insertItem(item.data, 0);
+        else
+            log( QString("Tab \"%1\": Failed to add pending item (tab is full)").arg(m_tabName), LogWarning );
+    }
+
+    // Keep pending items if they are not saved in the tab yet.
+    if ( saveItems() )
+        removePendingItems(m_tabName);
+}
+
 bool ClipboardBrowser::saveItems()
 {
     m_timerSave.stop();
@@ -1751,6 +1906,12 @@ void ClipboardBrowser::moveToClipboard()
     moveToClipboard( selectionModel()->selectedIndexes() );
 }
 
+void ClipboardBrowser::waitForSavedItems()
+{
+    if (m_itemSaver)
+        m_itemSaver->waitForSavedItems();
+}
+
 void ClipboardBrowser::delayedSaveItems()
 {
     if ( !isLoaded() || tabName().isEmpty() )
@@ -1784,6 +1945,9 @@ void ClipboardBrowser::saveUnsavedItems()
 {
     if ( m_timerSave.isActive() )
         saveItems();
+
+    // Tab files can be renamed or removed after tab is unloaded.
+    waitForSavedItems();
 }
 
 void ClipboardBrowser::purgeItems()
@@ -1791,6 +1955,7 @@ void ClipboardBrowser::purgeItems()
     if ( tabName().isEmpty() )
         return;
 
+    waitForSavedItems();
     removeItems(tabName());
     m_timerSave.stop();
 }
@@ -1810,6 +1975,9 @@ bool ClipboardBrowser::setTabName(const QString &tabName)
 {
     const QString oldTabName = m_tabName;
 
+    // Old tab files are removed after items are saved with the new name.
+    waitForSavedItems();
+
     m_tabName = tabName;
     if ( saveItems() )
         return true;
@@ -1826,8 +1994,10 @@ void ClipboardBrowser::setMaxItemCount(int count)
 void ClipboardBrowser::setStoreItems(bool store)
 {
     m_storeItems = store;
-    if (!m_storeItems)
+    if (!m_storeItems) {
+        waitForSavedItems();
         ::removeItems(m_tabName);
+    }
 }
 
 void ClipboardBrowser::editRow(int row)
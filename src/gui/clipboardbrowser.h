@@ -22,13 +22,16 @@
 
 #include "common/clipboardmode.h"
 #include "common/command.h"
+#include "gui/backgrounditemfilter.h"
 #include "gui/clipboardbrowsershared.h"
 #include "gui/theme.h"
 #include "item/clipboardmodel.h"
 #include "item/itemdelegate.h"
+#include "item/itemsearchindex.h"
 #include "item/itemwidget.h"
 
 #include <QListView>
+#include <QPersistentModelIndex>
 #include <QPointer>
 #include <QTimer>
 #include <QVariantMap>
@@ -61,7 +64,7 @@ class ClipboardBrowser final : public QListView
          *
          * @return true only if item exists
          */
-        bool moveToTop(uint itemHash);
+        bool moveToTop(quint64 itemHash);
 
         /** Sort selected items. */
         void sortItems(const QModelIndexList &indexes);
@@ -142,6 +145,26 @@ class ClipboardBrowser final : public QListView
                 int row = 0 //!< Target row for the new item (negative to append item).
                 );
 
+        /**
+         * Add multiple items to the browser at once.
+         *
+         * Result is the same as calling add() for each item (so the last item
+         * ends up at @a row) but space for new items is allocated only once and
+         * items are inserted to model together.
+         */
+        bool addItems(
+                const QVector<QVariantMap> &items, //!< Data for new items.
+                int row = 0 //!< Target row for the new items (negative to append items).
+                );
+
+        /**
+         * Append items to the end without making space for them.
+         *
+         * Unlike addItems(), this doesn't remove any items even if the tab
+         * has more items than the maximum (e.g. when importing items).
+         */
+        bool appendItems(const QVector<QVariantMap> &items);
+
         /**
          * Add item and remove duplicates.
          */
@@ -150,6 +173,9 @@ class ClipboardBrowser final : public QListView
         /** Number of items in list. */
         int length() const { return m.rowCount(); }
 
+        /** Copies of all items (data are implicitly shared). */
+        QList<ClipboardItem> items() const { return m.items(); }
+
         /** Receive key event. */
         void keyEvent(QKeyEvent *event) { keyPressEvent(event); }
         /** Move item to clipboard. */
@@ -305,8 +331,15 @@ class ClipboardBrowser final : public QListView
     private:
         void onRowsInserted(const QModelIndex &parent, int first, int last);
 
+        void onFilterItemsMatched(int searchId, const QVector<int> &positions);
+
+        void onFilterFinished(int searchId);
+
         void onItemCountChanged();
 
+        /** Add items stored while the tab was not loaded (see savePendingItems()). */
+        void addPendingItems();
+
         void onEditorSave();
 
         void onEditorCancel();
@@ -320,6 +353,9 @@ class ClipboardBrowser final : public QListView
          */
         void delayedSaveItems();
 
+        /** Wait for items saved in background (see ItemSaverInterface::waitForSavedItems()). */
+        void waitForSavedItems();
+
         /**
          * Update item and editor sizes.
          */
@@ -333,6 +369,7 @@ class ClipboardBrowser final : public QListView
          */
         bool hideFiltered(int row);
         bool hideFiltered(const QModelIndex &index);
+        bool hideFiltered(int row, bool hide);
 
         /**
          * Connects signals and starts external editor.
@@ -394,6 +431,7 @@ class ClipboardBrowser final : public QListView
         bool m_storeItems = true;
 
         ClipboardModel m;
+        ItemSearchIndex m_searchIndex;
         ItemDelegate d;
         QTimer m_timerSave;
         QTimer m_timerEmitItemCount;
@@ -413,6 +451,11 @@ class ClipboardBrowser final : public QListView
         QPoint m_dragStartPosition;
 
         int m_filterRow = -1;
+
+        /// Items filtered in background (search ID identifies current search).
+        BackgroundItemFilter m_backgroundFilter;
+        int m_filterSearchId = 0;
+        QVector<QPersistentModelIndex> m_filterIndexes;
 };
 
 #endif // CLIPBOARDBROWSER_H
@@ -22,6 +22,7 @@
 #include "common/common.h"
 #include "common/log.h"
 #include "common/timer.h"
+#include "item/itemfactory.h"
 #include "item/itemstore.h"
 #include "gui/clipboardbrowser.h"
 #include "gui/iconfactory.h"
@@ -76,6 +77,44 @@ ClipboardBrowser *ClipboardBrowserPlaceholder::createBrowser()
     return m_browser;
 }
 
+bool ClipboardBrowserPlaceholder::addItems(const QVector<QVariantMap> &items)
+{
+    QVector<PendingItem> pendingItems;
+    pendingItems.reserve( items.size() );
+    for (const auto &data : items) {
+        PendingItem item;
+        item.data = data;
+        pendingItems.append(item);
+    }
+
+    if ( savePendingItems(pendingItems) )
+        return true;
+
+    auto c = createBrowser();
+    if (!c)
+        return false;
+
+    return c->addItems(items);
+}
+
+bool ClipboardBrowserPlaceholder::addUnique(const QVariantMap &data, ClipboardMode mode)
+{
+    PendingItem item;
+    item.data = data;
+    item.unique = true;
+    item.mode = mode;
+    if ( savePendingItems(QVector<PendingItem>() << item) )
+        return true;
+
+    auto c = createBrowser();
+    if (!c)
+        return false;
+
+    c->addUnique(data, mode);
+    c->setCurrent(0);
+    return true;
+}
+
 bool ClipboardBrowserPlaceholder::setTabName(const QString &tabName)
 {
     if ( isEditorOpen() ) {
@@ -238,6 +277,20 @@ void ClipboardBrowserPlaceholder::restartExpiring()
         m_timerExpire.start(expireTimeoutMs);
 }
 
+bool ClipboardBrowserPlaceholder::savePendingItems(const QVector<PendingItem> &items)
+{
+    // Tab which is visible will be loaded anyway.
+    if (m_browser || m_loadButton || !m_storeItems || isVisible())
+        return false;
+
+    // Pending items file is not encrypted or synchronized so leave it for plugins.
+    const auto itemFactory = m_sharedData->itemFactory;
+    if ( itemFactory && itemFactory->canSaveItems(m_tabName) )
+        return false;
+
+    return ::savePendingItems(m_tabName, items, m_maxItemCount);
+}
+
 bool ClipboardBrowserPlaceholder::isEditorOpen() const
 {
     return m_browser && (
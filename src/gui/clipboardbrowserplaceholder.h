@@ -20,15 +20,19 @@
 #ifndef CLIPBOARDBROWSERPLACEHOLDER_H
 #define CLIPBOARDBROWSERPLACEHOLDER_H
 
+#include "common/clipboardmode.h"
 #include "gui/clipboardbrowsershared.h"
 
 #include <QString>
 #include <QTimer>
+#include <QVariantMap>
+#include <QVector>
 #include <QWidget>
 
 class ClipboardBrowser;
 class MainWindow;
 class QPushButton;
+struct PendingItem;
 
 class ClipboardBrowserPlaceholder final : public QWidget
 {
@@ -49,6 +53,17 @@ public:
      */
     ClipboardBrowser *createBrowser();
 
+    /**
+     * Add items to the top of the tab.
+     *
+     * If the tab is not loaded, items are only stored and added once the tab
+     * is loaded.
+     */
+    bool addItems(const QVector<QVariantMap> &items);
+
+    /** Add item as new clipboard content (see ClipboardBrowser::addUnique()). */
+    bool addUnique(const QVariantMap &data, ClipboardMode mode);
+
     bool setTabName(const QString &tabName);
     QString tabName() const { return m_tabName; }
 
@@ -89,6 +104,9 @@ private:
 
     bool isEditorOpen() const;
 
+    /// Stores items to add without loading the tab; returns false if tab needs to be loaded.
+    bool savePendingItems(const QVector<PendingItem> &items);
+
     ClipboardBrowser *m_browser = nullptr;
     QPushButton *m_loadButton = nullptr;
 
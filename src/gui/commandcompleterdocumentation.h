@@ -101,6 +101,9 @@ void addDocumentation(AddDocumentationCallback addDocumentation)
     addDocumentation("pack", "ByteArray pack(item)", "Returns serialized item.");
     addDocumentation("getItem", "Item getItem(row)", "Returns an item in current tab.");
     addDocumentation("setItem", "setItem(row, text|item)", "Inserts item to current tab.");
+    addDocumentation("getItems", "Item[] getItems(row[], [mimeType|mimeType[]])", "Returns items in given rows in current tab.");
+    addDocumentation("readRange", "Item[] readRange(row, [count], [mimeType|mimeType[]], [function(items, row)])", "Returns items in current tab starting at given row.");
+    addDocumentation("replaceItems", "replaceItems(row[], item[])", "Replaces data of items in given rows in current tab.");
     addDocumentation("toBase64", "String toBase64(data)", "Returns base64-encoded data.");
     addDocumentation("fromBase64", "ByteArray fromBase64(base64String)", "Returns base64-decoded data.");
     addDocumentation("md5sum", "ByteArray md5sum(data)", "Returns MD5 checksum of data.");
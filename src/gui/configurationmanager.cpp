@@ -323,6 +323,7 @@ void ConfigurationManager::initOptions()
     bind<Config::hide_main_window_in_task_bar>();
     bind<Config::max_process_manager_rows>();
     bind<Config::show_advanced_command_settings>();
+    bind<Config::paint_items_from_snapshots>();
 }
 
 template <typename Config, typename Widget>
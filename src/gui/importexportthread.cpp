@@ -0,0 +1,238 @@
+/*
+    Copyright (c) 2019, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "importexportthread.h"
+
+#include "common/contenttype.h"
+#include "common/log.h"
+#include "item/serialize.h"
+
+#include <QDataStream>
+#include <QFile>
+#include <QSaveFile>
+
+const char exportHeaderV4[] = "CopyQ v4";
+
+namespace {
+
+/// Progress is reported after writing this many items.
+const int itemsPerProgress = 100;
+
+/// Maximum number of items passed to main thread at once.
+const int itemsPerBatch = 100;
+
+/// Batch is passed to main thread once item data reach this size.
+const int bytesPerBatch = 4 * 1024 * 1024;
+
+/// Maximum number of batches waiting to be processed in main thread.
+const int maxPendingBatches = 2;
+
+/// Interval to check for cancellation while waiting for main thread.
+const int waitForBatchMs = 100;
+
+/// Null byte array is serialized with this size.
+const quint32 nullBytesSize = 0xffffffff;
+
+} // namespace
+
+ExportThread::ExportThread(
+        const QString &fileName,
+        const QVariantMap &header,
+        const QList< QList<ClipboardItem> > &tabItems,
+        QObject *parent)
+    : QThread(parent)
+    , m_fileName(fileName)
+    , m_header(header)
+    , m_tabItems(tabItems)
+{
+}
+
+ExportThread::~ExportThread()
+{
+    cancel();
+}
+
+void ExportThread::cancel()
+{
+    m_cancelled.store(1);
+    wait();
+}
+
+void ExportThread::run()
+{
+    QSaveFile file(m_fileName);
+    if ( !file.open(QIODevice::WriteOnly) ) {
+        log( QString("Failed to open file \"%1\" for export: %2")
+             .arg(m_fileName, file.errorString()), LogError );
+        return;
+    }
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_4_7);
+    out << QByteArray(exportHeaderV4) << m_header;
+
+    int itemCount = 0;
+    for (const auto &items : m_tabItems) {
+        for (const auto &item : items) {
+            if ( m_cancelled.load() != 0 || out.status() != QDataStream::Ok ) {
+                file.cancelWriting();
+                return;
+            }
+
+            // Item copies keep mapped tab files alive so the data need not be copied.
+            out << serializeItemData( item.data(contentType::mappedData).toMap() );
+
+            ++itemCount;
+            if (itemCount % itemsPerProgress == 0)
+                emit progress(itemCount);
+        }
+    }
+
+    if ( out.status() != QDataStream::Ok ) {
+        log( QString("Failed to write exported file \"%1\"").arg(m_fileName), LogError );
+        file.cancelWriting();
+        return;
+    }
+
+    m_succeeded = file.commit();
+    if (!m_succeeded) {
+        log( QString("Failed to save exported file \"%1\": %2")
+             .arg(m_fileName, file.errorString()), LogError );
+        return;
+    }
+
+    emit progress(itemCount);
+}
+
+ImportThread::ImportThread(
+        const QString &fileName,
+        qint64 position,
+        const QVector<int> &itemCounts,
+        const QVector<int> &maxItems,
+        QObject *parent)
+    : QThread(parent)
+    , m_fileName(fileName)
+    , m_position(position)
+    , m_itemCounts(itemCounts)
+    , m_maxItems(maxItems)
+    , m_freeBatches(maxPendingBatches)
+{
+    qRegisterMetaType< QVector<QVariantMap> >("QVector<QVariantMap>");
+}
+
+ImportThread::~ImportThread()
+{
+    cancel();
+}
+
+void ImportThread::cancel()
+{
+    m_cancelled.store(1);
+    wait();
+}
+
+void ImportThread::itemsProcessed()
+{
+    m_freeBatches.release();
+}
+
+void ImportThread::run()
+{
+    m_succeeded = readItems();
+}
+
+bool ImportThread::readItems()
+{
+    QFile file(m_fileName);
+    if ( !file.open(QIODevice::ReadOnly) || !file.seek(m_position) ) {
+        log( QString("Failed to open file \"%1\" for import: %2")
+             .arg(m_fileName, file.errorString()), LogError );
+        return false;
+    }
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_4_7);
+
+    for (int tabIndex = 0; tabIndex < m_itemCounts.size(); ++tabIndex) {
+        const int itemCount = m_itemCounts[tabIndex];
+        const int maxItems = m_maxItems.value(tabIndex, 0);
+
+        QVector<QVariantMap> items;
+        int batchBytes = 0;
+
+        for (int i = 0; i < itemCount; ++i) {
+            if ( m_cancelled.load() != 0 )
+                return false;
+
+            if (i >= maxItems) {
+                // Skip item without reading it.
+                quint32 size;
+                in >> size;
+                if ( in.status() != QDataStream::Ok )
+                    break;
+                if ( size != nullBytesSize && !file.seek(file.pos() + size) ) {
+                    in.setStatus(QDataStream::ReadPastEnd);
+                    break;
+                }
+                continue;
+            }
+
+            QByteArray bytes;
+            in >> bytes;
+            if ( in.status() != QDataStream::Ok )
+                break;
+
+            QVariantMap data;
+            if ( !deserializeData(&data, bytes) ) {
+                log( QString("Failed to import item from file \"%1\"").arg(m_fileName), LogError );
+                return false;
+            }
+
+            items.append(data);
+            batchBytes += bytes.size();
+
+            if (items.size() >= itemsPerBatch || batchBytes >= bytesPerBatch) {
+                if ( !emitItems(tabIndex, &items) )
+                    return false;
+                batchBytes = 0;
+            }
+        }
+
+        if ( in.status() != QDataStream::Ok ) {
+            log( QString("Corrupted data in imported file \"%1\"").arg(m_fileName), LogError );
+            return false;
+        }
+
+        if ( !items.isEmpty() && !emitItems(tabIndex, &items) )
+            return false;
+    }
+
+    return true;
+}
+
+bool ImportThread::emitItems(int tabIndex, QVector<QVariantMap> *items)
+{
+    while ( !m_freeBatches.tryAcquire(1, waitForBatchMs) ) {
+        if ( m_cancelled.load() != 0 )
+            return false;
+    }
+
+    emit itemsLoaded(tabIndex, *items);
+    items->clear();
+    return true;
+}
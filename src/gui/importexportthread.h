@@ -0,0 +1,137 @@
+/*
+    Copyright (c) 2019, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef IMPORTEXPORTTHREAD_H
+#define IMPORTEXPORTTHREAD_H
+
+#include "item/clipboarditem.h"
+
+#include <QAtomicInt>
+#include <QList>
+#include <QSemaphore>
+#include <QString>
+#include <QThread>
+#include <QVariantMap>
+#include <QVector>
+
+/**
+ * Header of exported data in format version 4.
+ *
+ * Exported file contains:
+ *   - QByteArray with the header,
+ *   - QVariantMap with "settings", "commands" and "tabs" (list of maps with
+ *     "name", "icon" and "count" - number of items in tab),
+ *   - items of all tabs in order, each item is QByteArray with serialized data
+ *     (see serializeItemData()) so it can be skipped without parsing.
+ */
+extern const char exportHeaderV4[];
+
+/**
+ * Writes items to exported file in background.
+ *
+ * File is replaced only if all items are written successfully.
+ */
+class ExportThread final : public QThread
+{
+    Q_OBJECT
+
+public:
+    ExportThread(
+            const QString &fileName,
+            const QVariantMap &header,
+            const QList< QList<ClipboardItem> > &tabItems,
+            QObject *parent = nullptr);
+
+    ~ExportThread();
+
+    /// Cancel writing and wait for thread to finish.
+    void cancel();
+
+    /// Returns true only if all items were written.
+    bool succeeded() const { return m_succeeded; }
+
+signals:
+    /// Number of items written so far.
+    void progress(int itemCount);
+
+protected:
+    void run() override;
+
+private:
+    QString m_fileName;
+    QVariantMap m_header;
+    QList< QList<ClipboardItem> > m_tabItems;
+    QAtomicInt m_cancelled;
+    bool m_succeeded = false;
+};
+
+/**
+ * Reads items from exported file in background.
+ *
+ * Items are passed in small batches so the data are never loaded in memory at
+ * once. Next batch is read only after previous ones are processed (see
+ * itemsProcessed()).
+ */
+class ImportThread final : public QThread
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @param position    position of the first item in file (after header)
+     * @param itemCounts  number of items stored for each tab
+     * @param maxItems    number of items to read for each tab (the rest is skipped)
+     */
+    ImportThread(
+            const QString &fileName,
+            qint64 position,
+            const QVector<int> &itemCounts,
+            const QVector<int> &maxItems,
+            QObject *parent = nullptr);
+
+    ~ImportThread();
+
+    /// Cancel reading and wait for thread to finish.
+    void cancel();
+
+    /// Call after items from itemsLoaded() are added so next batch can be read.
+    void itemsProcessed();
+
+    /// Returns true only if all items were read.
+    bool succeeded() const { return m_succeeded; }
+
+signals:
+    void itemsLoaded(int tabIndex, const QVector<QVariantMap> &items);
+
+protected:
+    void run() override;
+
+private:
+    bool readItems();
+    bool emitItems(int tabIndex, QVector<QVariantMap> *items);
+
+    QString m_fileName;
+    qint64 m_position;
+    QVector<int> m_itemCounts;
+    QVector<int> m_maxItems;
+    QSemaphore m_freeBatches;
+    QAtomicInt m_cancelled;
+    bool m_succeeded = false;
+};
+
+#endif // IMPORTEXPORTTHREAD_H
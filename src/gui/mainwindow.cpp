@@ -46,6 +46,7 @@
 #include "gui/commanddialog.h"
 #include "gui/configurationmanager.h"
 #include "gui/importexportdialog.h"
+#include "gui/importexportthread.h"
 #include "gui/iconfactory.h"
 #include "gui/iconfactory.h"
 #include "gui/iconselectdialog.h"
@@ -73,6 +74,7 @@
 #include <QAction>
 #include <QCloseEvent>
 #include <QDesktopServices>
+#include <QEventLoop>
 #include <QFile>
 #include <QFileDialog>
 #include <QFlags>
@@ -81,6 +83,8 @@
 #include <QMessageBox>
 #include <QMimeData>
 #include <QModelIndex>
+#include <QPointer>
+#include <QProgressDialog>
 #include <QPushButton>
 #include <QTimer>
 #include <QToolBar>
@@ -94,6 +98,13 @@ namespace {
 const int contextMenuUpdateIntervalMsec = 100;
 const int trayMenuUpdateIntervalMsec = 100;
 const int itemPreviewUpdateIntervalMsec = 100;
+const int maxCallbackWorkerCount = 4;
+/// If more callbacks are waiting for a free worker, the oldest ones run in separate processes.
+const int maxPendingCallbackCount = 32;
+/// Idle callback workers exit after this interval.
+const int callbackWorkerIdleTimeoutMsec = 60000;
+const int importExportProgressDelayMsec = 500;
+const int importExportProgressUpdateIntervalMsec = 100;
 
 const QIcon iconClipboard() { return getIcon("clipboard", IconPaste); }
 const QIcon iconTabIcon() { return getIconFromResources("tab_icon"); }
@@ -138,44 +149,21 @@ bool canPaste()
     return !QApplication::queryKeyboardModifiers().testFlag(Qt::ControlModifier);
 }
 
-bool matchData(const QRegExp &re, const QVariantMap &data, const QString &format)
+/**
+ * Return hash of data passed to menu command filters.
+ *
+ * Unlike item hash, this depends on window title which is passed to commands in tray menu.
+ */
+quint64 menuFilterDataHash(const QVariantMap &data)
 {
-    if ( re.isEmpty() )
-        return true;
-
-    const QString text = getTextData(data, format);
-    return re.indexIn(text) != -1;
+    const auto windowTitle = data.value(mimeWindowTitle).toByteArray();
+    return hash(data) ^ (Q_UINT64_C(0x9e3779b97f4a7c15) * qHash(windowTitle));
 }
 
-bool canExecuteCommand(const Command &command, const QVariantMap &data, const QString &sourceTabName)
+bool hasCommandAction(const Command &command, const QString &sourceTabName)
 {
-    // Verify that an action is provided.
-    if ( command.cmd.isEmpty() && !command.remove
-         && (command.tab.isEmpty() || command.tab == sourceTabName) )
-    {
-        return false;
-    }
-
-    // Verify that data for given MIME is available.
-    if ( !command.input.isEmpty() ) {
-        if (command.input == mimeItems || command.input == "!OUTPUT") {
-            // Disallow applying action that takes serialized item more times.
-            if ( data.contains(command.output) )
-                return false;
-        } else if ( !data.contains(command.input) ) {
-            return false;
-        }
-    }
-
-    // Verify that and text matches given regexp.
-    if ( !matchData(command.re, data, mimeText) )
-        return false;
-
-    // Verify that window title matches given regexp.
-    if ( !matchData(command.wndre, data, mimeWindowTitle) )
-        return false;
-
-    return true;
+    return !command.cmd.isEmpty() || command.remove
+        || (!command.tab.isEmpty() && command.tab != sourceTabName);
 }
 
 void stealFocus(const QWidget &window)
@@ -389,6 +377,49 @@ void clearActions(QToolBar *toolBar)
     toolBar->clear();
 }
 
+/**
+ * Runs import/export thread and waits for it to finish.
+ *
+ * Progress dialog is shown if it takes long. Returns false if cancelled.
+ *
+ * Without progress dialog (e.g. if called from script), this only waits for
+ * the thread so the application stays responsive.
+ */
+template <typename Thread>
+bool runWithProgress(Thread *thread, QProgressDialog *progress, const int *progressValue)
+{
+    QEventLoop loop;
+    QObject::connect( thread, &QThread::finished, &loop, &QEventLoop::quit );
+
+    if (!progress) {
+        thread->start();
+        loop.exec();
+        return true;
+    }
+
+    progress->setWindowModality(Qt::ApplicationModal);
+    progress->setMinimumDuration(importExportProgressDelayMsec);
+
+    // Modal dialog processes events in setValue() so it's updated only from timer.
+    QTimer timer;
+    timer.setInterval(importExportProgressUpdateIntervalMsec);
+    QObject::connect( &timer, &QTimer::timeout, progress, [=]() {
+        progress->setValue(*progressValue);
+    } );
+    timer.start();
+
+    QObject::connect( progress, &QProgressDialog::canceled, &loop, &QEventLoop::quit );
+    thread->start();
+    loop.exec();
+
+    if ( progress->wasCanceled() ) {
+        thread->cancel();
+        return false;
+    }
+
+    return true;
+}
+
 bool hasCommandFuzzy(const QVector<Command> &commands, const Command &command)
 {
     return std::any_of(std::begin(commands), std::end(commands), [&command](const Command &cmd){
@@ -501,6 +532,7 @@ MainWindow::MainWindow(ItemFactory *itemFactory, QWidget *parent)
     initSingleShotTimer( &m_timerTrayIconSnip, 500, this, &MainWindow::updateIconSnipTimeout );
     initSingleShotTimer( &m_timerSaveTabPositions, 1000, this, &MainWindow::doSaveTabPositions );
     initSingleShotTimer( &m_timerRaiseLastWindowAfterMenuClosed, 50, this, &MainWindow::raiseLastWindowAfterMenuClosed);
+    initSingleShotTimer( &m_timerStopIdleCallbackWorkers, callbackWorkerIdleTimeoutMsec, this, &MainWindow::stopIdleCallbackWorkers );
     enableHideWindowOnUnfocus();
 
     m_trayMenu->setObjectName("TrayMenu");
@@ -893,6 +925,7 @@ void MainWindow::onAboutToQuit()
     stopMenuCommandFilters(&m_itemMenuMatchCommands);
     stopMenuCommandFilters(&m_trayMenuMatchCommands);
     terminateAction(&m_displayActionId);
+    stopCallbackWorkers();
 }
 
 void MainWindow::onSaveCommand(const Command &command)
@@ -1169,6 +1202,26 @@ void MainWindow::clearHiddenDisplayData()
     }
 }
 
+void MainWindow::stopCallbackWorkers()
+{
+    // Busy workers get "ABORT" once they ask for next callback.
+    for (int actionId : m_idleCallbackActionIds)
+        emit sendActionData(actionId, "ABORT");
+
+    m_idleCallbackActionIds.clear();
+    m_callbackActionIds.clear();
+}
+
+void MainWindow::stopIdleCallbackWorkers()
+{
+    for (int actionId : m_idleCallbackActionIds) {
+        m_callbackActionIds.removeOne(actionId);
+        emit sendActionData(actionId, "ABORT");
+    }
+
+    m_idleCallbackActionIds.clear();
+}
+
 void MainWindow::reloadBrowsers()
 {
     for( int i = 0; i < ui->tabWidget->count(); ++i )
@@ -1349,11 +1402,12 @@ QAction *MainWindow::addItemAction(int id, Receiver *receiver, ReturnType (Recei
     return act;
 }
 
-QVector<Command> MainWindow::commandsForMenu(const QVariantMap &data, const QString &tabName, const QVector<Command> &allCommands)
+QVector<Command> MainWindow::commandsForMenu(const QVariantMap &data, const QString &tabName, const CommandMatcher &matcher)
 {
     QVector<Command> commands;
-    for (const auto &command : allCommands) {
-        if ( canExecuteCommand(command, data, tabName) ) {
+    for (const int i : matcher.matchingCommands(data)) {
+        const Command &command = matcher.commands()[i];
+        if ( hasCommandAction(command, tabName) ) {
             Command cmd = command;
             if ( cmd.outputTab.isEmpty() )
                 cmd.outputTab = tabName;
@@ -1432,6 +1486,33 @@ void MainWindow::addMenuMatchCommand(MenuMatchCommands *menuMatchCommands, const
 
 void MainWindow::runMenuCommandFilters(MenuMatchCommands *menuMatchCommands, const QVariantMap &data)
 {
+    // Filters can depend on other state than the data, so cached results
+    // are used only until selected items or their data change.
+    const quint64 dataHash = menuFilterDataHash(data);
+    if (dataHash != menuMatchCommands->dataHash) {
+        menuMatchCommands->filterResults.clear();
+        menuMatchCommands->dataHash = dataHash;
+    }
+
+    // Apply cached results and run only remaining filters.
+    QStringList matchCommands;
+    QVector< QPointer<QAction> > actions;
+    for (int i = 0; i < menuMatchCommands->matchCommands.size(); ++i) {
+        const auto &matchCommand = menuMatchCommands->matchCommands[i];
+        const auto &action = menuMatchCommands->actions[i];
+        const auto result = menuMatchCommands->filterResults.constFind(matchCommand);
+        if ( result != menuMatchCommands->filterResults.constEnd() ) {
+            // Keep disabled action in menu; it would be missing until menu is rebuilt.
+            if (action)
+                setMenuActionEnabled(action, result.value(), false);
+        } else {
+            matchCommands.append(matchCommand);
+            actions.append(action);
+        }
+    }
+    menuMatchCommands->matchCommands = matchCommands;
+    menuMatchCommands->actions = actions;
+
     if ( menuMatchCommands->actions.isEmpty() ) {
         interruptMenuCommandFilters(menuMatchCommands);
         return;
@@ -1657,8 +1738,8 @@ void MainWindow::addMenuItems(TrayMenu *menu, ClipboardBrowserPlaceholder *place
     for ( int i = 0; i < c->length() && itemCount < maxItemCount; ++i ) {
         const QModelIndex index = c->model()->index(i, 0);
         if ( !searchText.isEmpty() ) {
-            const QString itemText = index.data(contentType::text).toString().toLower();
-            if ( !itemText.contains(searchText.toLower()) )
+            const QString itemText = index.data(contentType::text).toString();
+            if ( !itemText.contains(searchText, Qt::CaseInsensitive) )
                 continue;
         }
         menu->addClipboardItemAction(index, m_options.trayImages);
@@ -1717,19 +1798,31 @@ bool MainWindow::toggleMenu(TrayMenu *menu)
     return toggleMenu(menu, QCursor::pos());
 }
 
-bool MainWindow::exportDataFrom(const QString &fileName, const QStringList &tabs, bool exportConfiguration, bool exportCommands)
+bool MainWindow::exportDataFrom(
+        const QString &fileName, const QStringList &tabs, bool exportConfiguration, bool exportCommands,
+        bool showProgress)
 {
-    QFile file(fileName);
-    if ( !file.open(QIODevice::WriteOnly | QIODevice::Truncate) )
+    // Omit exporting while other import or export waits for items to be processed.
+    if (m_importingOrExporting) {
+        log("Cannot export while other import or export is in progress", LogError);
         return false;
+    }
 
-    QDataStream out(&file);
-    return exportDataV3(&out, tabs, exportConfiguration, exportCommands);
+    m_importingOrExporting = true;
+    const bool exported = exportDataFromHelper(
+                fileName, tabs, exportConfiguration, exportCommands, showProgress);
+    m_importingOrExporting = false;
+
+    return exported;
 }
 
-bool MainWindow::exportDataV3(QDataStream *out, const QStringList &tabs, bool exportConfiguration, bool exportCommands)
+bool MainWindow::exportDataFromHelper(
+        const QString &fileName, const QStringList &tabs, bool exportConfiguration, bool exportCommands,
+        bool showProgress)
 {
     QVariantList tabsList;
+    QList< QList<ClipboardItem> > tabItems;
+    int itemCount = 0;
     for (const auto &tab : tabs) {
         const auto i = findTabIndex(tab);
         if (i == -1)
@@ -1745,31 +1838,23 @@ bool MainWindow::exportDataV3(QDataStream *out, const QStringList &tabs, bool ex
 
         const auto &tabName = c->tabName();
 
-        bool saved = false;
-        QByteArray tabBytes;
-        {
-            QDataStream tabOut(&tabBytes, QIODevice::WriteOnly);
-            tabOut.setVersion(QDataStream::Qt_4_7);
-            saved = serializeData(*c->model(), &tabOut);
-        }
+        // Item copies share data (and memory mapped tab file) with the tab.
+        const auto items = c->items();
 
         if (!wasLoaded)
             placeholder->expire();
 
-        if (!saved) {
-            log(QString("Failed to export tab \"%s\"").arg(tab), LogError);
-            return false;
-        }
-
         const auto iconName = getIconNameForTabName(tabName);
 
         QVariantMap tabMap;
         tabMap["name"] = tabName;
-        tabMap["data"] = tabBytes;
+        tabMap["count"] = items.size();
         if ( !iconName.isEmpty() )
             tabMap["icon"] = iconName;
 
         tabsList.append(tabMap);
+        tabItems.append(items);
+        itemCount += items.size();
     }
 
     QVariantMap settingsMap;
@@ -1801,19 +1886,33 @@ bool MainWindow::exportDataV3(QDataStream *out, const QStringList &tabs, bool ex
         settings.endArray();
     }
 
-    QVariantMap data;
+    QVariantMap header;
     if ( !tabsList.isEmpty() )
-        data["tabs"] = tabsList;
+        header["tabs"] = tabsList;
     if ( !settingsMap.isEmpty() )
-        data["settings"] = settingsMap;
+        header["settings"] = settingsMap;
     if ( !commandsList.isEmpty() )
-        data["commands"] = commandsList;
+        header["commands"] = commandsList;
+
+    ExportThread exportThread(fileName, header, tabItems);
+    tabItems.clear();
+
+    std::unique_ptr<QProgressDialog> progress;
+    if (showProgress) {
+        progress.reset( new QProgressDialog(tr("Exporting items..."), tr("Cancel"), 0, itemCount, this) );
+        progress->setWindowTitle( tr("CopyQ Export") );
+    }
 
-    out->setVersion(QDataStream::Qt_4_7);
-    (*out) << QByteArray("CopyQ v3");
-    (*out) << data;
+    int exportedItemCount = 0;
+    connect( &exportThread, &ExportThread::progress, &exportThread,
+             [&](int count) { exportedItemCount = count; } );
 
-    return out->status() == QDataStream::Ok;
+    if ( !runWithProgress(&exportThread, progress.get(), &exportedItemCount) ) {
+        log(QString("Export to \"%1\" cancelled").arg(fileName), LogWarning);
+        return false;
+    }
+
+    return exportThread.succeeded();
 }
 
 bool MainWindow::importDataV3(QDataStream *in, ImportOptions options)
@@ -1845,19 +1944,12 @@ bool MainWindow::importDataV3(QDataStream *in, ImportOptions options)
     bool importCommands = true;
 
     if (options == ImportOptions::Select) {
-        ImportExportDialog importDialog(this);
-        importDialog.setWindowTitle( tr("CopyQ Options for Import") );
-        importDialog.setTabs(tabs);
-        importDialog.setHasConfiguration( !settingsMap.isEmpty() );
-        importDialog.setHasCommands( !commandsList.isEmpty() );
-        importDialog.setConfigurationEnabled(true);
-        importDialog.setCommandsEnabled(true);
-        if ( importDialog.exec() != QDialog::Accepted )
+        if ( !selectDataToImport(
+                 &tabs, &importConfiguration, &importCommands,
+                 !settingsMap.isEmpty(), !commandsList.isEmpty()) )
+        {
             return true;
-
-        tabs = importDialog.selectedTabs();
-        importConfiguration = importDialog.isConfigurationEnabled();
-        importCommands = importDialog.isCommandsEnabled();
+        }
     }
 
     for (const auto &tabMapValue : tabsList) {
@@ -1896,54 +1988,215 @@ bool MainWindow::importDataV3(QDataStream *in, ImportOptions options)
             getPlaceholder(i)->expire();
     }
 
-    if (importConfiguration) {
-        // Configuration dialog shouldn't be open.
-        if (cm) {
-            log("Failed to import configuration while configuration dialog is open", LogError);
-            return false;
-        }
+    if ( importConfiguration && !importSettings(settingsMap) )
+        return false;
 
-        Settings settings;
+    if ( importCommands && !importCommandList(commandsList) )
+        return false;
 
-        for (auto it = settingsMap.constBegin(); it != settingsMap.constEnd(); ++it)
-            settings.setValue( it.key(), it.value() );
+    return in->status() == QDataStream::Ok;
+}
 
-        emit configurationChanged();
+bool MainWindow::importDataV4(QDataStream *in, const QString &fileName, ImportOptions options)
+{
+    QVariantMap data;
+    (*in) >> data;
+    if ( in->status() != QDataStream::Ok )
+        return false;
+
+    const auto tabsList = data.value("tabs").toList();
+
+    QStringList tabs;
+    tabs.reserve( tabsList.size() );
+    for (const auto &tabMapValue : tabsList)
+        tabs.append( tabMapValue.toMap().value("name").toString() );
+
+    const auto settingsMap = data.value("settings").toMap();
+    const auto commandsList = data.value("commands").toList();
+
+    bool importConfiguration = true;
+    bool importCommands = true;
+
+    if (options == ImportOptions::Select) {
+        if ( !selectDataToImport(
+                 &tabs, &importConfiguration, &importCommands,
+                 !settingsMap.isEmpty(), !commandsList.isEmpty()) )
+        {
+            return true;
+        }
     }
 
-    if (importCommands) {
-        // Close command dialog.
-        if ( !maybeCloseCommandDialog() ) {
-            log("Failed to import command while command dialog is open", LogError);
+    // Don't read items based on current value of "maxitems" option since
+    // the option can be later also imported.
+    const int maxItems = importConfiguration ? Config::maxItems : m_sharedData->maxItems;
+
+    QVector<int> itemCounts;
+    QVector<int> itemsToRead;
+    QVector< QPointer<ClipboardBrowser> > browsers;
+    QStringList importedTabs;
+    int itemCount = 0;
+
+    for (const auto &tabMapValue : tabsList) {
+        const auto tabMap = tabMapValue.toMap();
+        const int count = tabMap.value("count").toInt();
+        if (count < 0) {
+            log("Corrupted data: Invalid number of exported items", LogError);
             return false;
         }
 
-        // Re-create command dialog again later.
-        if (m_commandDialog) {
-            m_commandDialog->deleteLater();
-            m_commandDialog = nullptr;
-        }
+        itemCounts.append(count);
 
-        Settings settings;
+        const auto oldTabName = tabMap.value("name").toString();
+        if ( !tabs.contains(oldTabName) ) {
+            itemsToRead.append(0);
+            browsers.append( QPointer<ClipboardBrowser>() );
+            continue;
+        }
 
-        int i = settings.beginReadArray("Commands");
-        settings.endArray();
+        auto tabName = oldTabName;
+        renameToUnique( &tabName, ui->tabWidget->tabs() );
 
-        settings.beginWriteArray("Commands");
+        const auto iconName = tabMap.value("icon").toString();
+        if ( !iconName.isEmpty() )
+            setIconNameForTabName(tabName, iconName);
 
-        for ( const auto &commandDataValue : commandsList ) {
-            settings.setArrayIndex(i++);
-            const auto commandMap = commandDataValue.toMap();
-            for (auto it = commandMap.constBegin(); it != commandMap.constEnd(); ++it)
-                settings.setValue( it.key(), it.value() );
+        auto c = createTab(tabName, MatchExactTabName)->createBrowser();
+        if (!c) {
+            log(QString("Failed to create tab \"%s\" for import").arg(tabName), LogError);
+            return false;
         }
 
-        settings.endArray();
+        const int toRead = qMax( 0, qMin(count, maxItems - c->length()) );
+        itemsToRead.append(toRead);
+        browsers.append(c);
+        importedTabs.append(tabName);
+        itemCount += toRead;
+    }
+
+    ImportThread importThread(fileName, in->device()->pos(), itemCounts, itemsToRead);
 
-        updateEnabledCommands();
+    // Script callers don't get progress dialog and nested event loop.
+    std::unique_ptr<QProgressDialog> progress;
+    if (options == ImportOptions::Select) {
+        progress.reset( new QProgressDialog(tr("Importing items..."), tr("Cancel"), 0, itemCount, this) );
+        progress->setWindowTitle( tr("CopyQ Import") );
     }
 
-    return in->status() == QDataStream::Ok;
+    int importedItemCount = 0;
+    bool itemsImported = true;
+    connect( &importThread, &ImportThread::itemsLoaded, &importThread,
+             [&](int tabIndex, const QVector<QVariantMap> &items) {
+                 const auto c = browsers.value(tabIndex);
+                 if (!c) {
+                     log("Failed to import items to closed tab", LogError);
+                     itemsImported = false;
+                 } else if ( itemsImported && !c->appendItems(items) ) {
+                     // Items are not limited by current value of "maxitems" option (see above).
+                     log("Failed to insert imported items", LogError);
+                     itemsImported = false;
+                 }
+
+                 importedItemCount += items.size();
+                 importThread.itemsProcessed();
+             } );
+
+    const bool finished = runWithProgress(&importThread, progress.get(), &importedItemCount);
+
+    // Save imported items and release memory.
+    for (const auto &tabName : importedTabs) {
+        const auto i = findTabIndex(tabName);
+        if (i != -1)
+            getPlaceholder(i)->expire();
+    }
+
+    if (!finished) {
+        log(QString("Import from \"%1\" cancelled").arg(fileName), LogWarning);
+        return false;
+    }
+
+    if ( !itemsImported || !importThread.succeeded() )
+        return false;
+
+    if ( importConfiguration && !importSettings(settingsMap) )
+        return false;
+
+    if ( importCommands && !importCommandList(commandsList) )
+        return false;
+
+    return true;
+}
+
+bool MainWindow::selectDataToImport(
+        QStringList *tabs, bool *importConfiguration, bool *importCommands,
+        bool hasConfiguration, bool hasCommands)
+{
+    ImportExportDialog importDialog(this);
+    importDialog.setWindowTitle( tr("CopyQ Options for Import") );
+    importDialog.setTabs(*tabs);
+    importDialog.setHasConfiguration(hasConfiguration);
+    importDialog.setHasCommands(hasCommands);
+    importDialog.setConfigurationEnabled(true);
+    importDialog.setCommandsEnabled(true);
+    if ( importDialog.exec() != QDialog::Accepted )
+        return false;
+
+    *tabs = importDialog.selectedTabs();
+    *importConfiguration = importDialog.isConfigurationEnabled();
+    *importCommands = importDialog.isCommandsEnabled();
+    return true;
+}
+
+bool MainWindow::importSettings(const QVariantMap &settingsMap)
+{
+    // Configuration dialog shouldn't be open.
+    if (cm) {
+        log("Failed to import configuration while configuration dialog is open", LogError);
+        return false;
+    }
+
+    Settings settings;
+
+    for (auto it = settingsMap.constBegin(); it != settingsMap.constEnd(); ++it)
+        settings.setValue( it.key(), it.value() );
+
+    emit configurationChanged();
+
+    return true;
+}
+
+bool MainWindow::importCommandList(const QVariantList &commandsList)
+{
+    // Close command dialog.
+    if ( !maybeCloseCommandDialog() ) {
+        log("Failed to import command while command dialog is open", LogError);
+        return false;
+    }
+
+    // Re-create command dialog again later.
+    if (m_commandDialog) {
+        m_commandDialog->deleteLater();
+        m_commandDialog = nullptr;
+    }
+
+    Settings settings;
+
+    int i = settings.beginReadArray("Commands");
+    settings.endArray();
+
+    settings.beginWriteArray("Commands");
+
+    for ( const auto &commandDataValue : commandsList ) {
+        settings.setArrayIndex(i++);
+        const auto commandMap = commandDataValue.toMap();
+        for (auto it = commandMap.constBegin(); it != commandMap.constEnd(); ++it)
+            settings.setValue( it.key(), it.value() );
+    }
+
+    settings.endArray();
+
+    updateEnabledCommands();
+
+    return true;
 }
 
 void MainWindow::updateEnabledCommands()
@@ -1953,12 +2206,14 @@ void MainWindow::updateEnabledCommands()
 
 void MainWindow::updateCommands(QVector<Command> allCommands, bool forceSave)
 {
+    const auto oldScriptCommands = m_scriptCommands;
+
     m_automaticCommands.clear();
-    m_menuCommands.clear();
     m_scriptCommands.clear();
-    m_trayMenuCommands.clear();
 
     QVector<Command> displayCommands;
+    QVector<Command> menuCommands;
+    QVector<Command> trayMenuCommands;
 
     if ( addPluginCommands(&allCommands) || forceSave )
         saveCommands(allCommands);
@@ -1980,15 +2235,32 @@ void MainWindow::updateCommands(QVector<Command> allCommands, bool forceSave)
             displayCommands.append(command);
 
         if (type & CommandType::Menu)
-            m_menuCommands.append(command);
+            menuCommands.append(command);
 
         if (m_options.trayCommands && type & CommandType::GlobalShortcut)
-            m_trayMenuCommands.append(command);
+            trayMenuCommands.append(command);
 
         if (type & CommandType::Script)
             m_scriptCommands.append(command);
     }
 
+    // Script workers source script commands only once on start.
+    if (m_scriptCommands != oldScriptCommands) {
+        stopCallbackWorkers();
+        if ( !m_callbacks.isEmpty() )
+            wakeUpCallbackWorker();
+    }
+
+    // Filters can use functions from script commands.
+    m_trayMenuMatchCommands.filterResults.clear();
+    m_itemMenuMatchCommands.filterResults.clear();
+
+    // Matchers are compiled only when the command list changes.
+    if (m_menuCommands.commands() != menuCommands)
+        m_menuCommands = CommandMatcher(menuCommands);
+    if (m_trayMenuCommands.commands() != trayMenuCommands)
+        m_trayMenuCommands = CommandMatcher(trayMenuCommands);
+
     if (m_displayCommands != displayCommands) {
         m_displayItemList.clear();
         m_displayCommands = displayCommands;
@@ -2069,6 +2341,18 @@ ClipboardBrowser *MainWindow::tab(const QString &name)
     return createTab(name, MatchSimilarTabName)->createBrowser();
 }
 
+bool MainWindow::addToTab(const QString &name, const QVector<QVariantMap> &items)
+{
+    auto placeholder = name.isEmpty() ? getPlaceholder() : createTab(name, MatchSimilarTabName);
+    return placeholder && placeholder->addItems(items);
+}
+
+bool MainWindow::addUniqueToTab(const QString &name, const QVariantMap &data, ClipboardMode mode)
+{
+    auto placeholder = createTab(name, MatchSimilarTabName);
+    return placeholder && placeholder->addUnique(data, mode);
+}
+
 bool MainWindow::hasRunningAction() const
 {
     return m_actionHandler->runningActionCount() > 0;
@@ -2347,6 +2631,7 @@ void MainWindow::loadSettings()
     m_sharedData->saveOnReturnKey = !appConfig.option<Config::edit_ctrl_return>();
     m_sharedData->moveItemOnReturnKey = appConfig.option<Config::move>();
     m_sharedData->showSimpleItems = appConfig.option<Config::show_simple_items>();
+    m_sharedData->paintItemsFromSnapshots = appConfig.option<Config::paint_items_from_snapshots>();
     m_sharedData->minutesToExpire = appConfig.option<Config::expire_tab>();
 
     // create tabs
@@ -2801,7 +3086,7 @@ bool MainWindow::setMenuItemEnabled(int actionId, int currentRun, int menuItemMa
     if (actionId != m_trayMenuMatchCommands.actionId && actionId != m_itemMenuMatchCommands.actionId)
         return false;
 
-    const auto &menuMatchCommands = actionId == m_trayMenuMatchCommands.actionId
+    auto &menuMatchCommands = actionId == m_trayMenuMatchCommands.actionId
             ? m_trayMenuMatchCommands
             : m_itemMenuMatchCommands;
 
@@ -2811,22 +3096,31 @@ bool MainWindow::setMenuItemEnabled(int actionId, int currentRun, int menuItemMa
     if (menuMatchCommands.actions.size() <= menuItemMatchCommandIndex)
         return false;
 
+    menuMatchCommands.filterResults.insert(
+        menuMatchCommands.matchCommands[menuItemMatchCommandIndex], enabled);
+
     auto action = menuMatchCommands.actions[menuItemMatchCommandIndex];
     if (!action)
         return true;
 
+    const bool removeIfDisabled = actionId == m_trayMenuMatchCommands.actionId || !m_menuItem->isVisible();
+    setMenuActionEnabled(action, enabled, removeIfDisabled);
+
+    return true;
+}
+
+void MainWindow::setMenuActionEnabled(QAction *action, bool enabled, bool removeIfDisabled)
+{
     action->setEnabled(enabled);
     action->setProperty(propertyActionFilterCommandFailed, !enabled);
 
     const auto shortcuts = action->shortcuts();
 
-    if ( !enabled && (actionId == m_trayMenuMatchCommands.actionId || !m_menuItem->isVisible()) )
+    if (!enabled && removeIfDisabled)
         action->deleteLater();
 
     if ( !shortcuts.isEmpty() )
         updateActionShortcuts();
-
-    return true;
 }
 
 QVariantMap MainWindow::setDisplayData(int actionId, const QVariantMap &data)
@@ -2846,6 +3140,75 @@ QVariantMap MainWindow::setDisplayData(int actionId, const QVariantMap &data)
     return m_currentDisplayItem.data();
 }
 
+void MainWindow::runCallback(const QString &script, const QVariantMap &data)
+{
+    m_callbacks.append({script, data});
+
+    // Don't let slow callbacks delay handling of new clipboard content indefinitely.
+    // Start the oldest callbacks first so callbacks still start in the order they were queued.
+    while (m_callbacks.size() > maxPendingCallbackCount) {
+        const Callback callback = m_callbacks.takeFirst();
+        COPYQ_LOG( QString("All callback workers are busy, running in new process: %1").arg(callback.script) );
+        runScript(callback.script, callback.data);
+    }
+
+    m_timerStopIdleCallbackWorkers.start();
+    wakeUpCallbackWorker();
+}
+
+void MainWindow::wakeUpCallbackWorker()
+{
+    while ( !m_idleCallbackActionIds.isEmpty() ) {
+        const int actionId = m_idleCallbackActionIds.takeLast();
+        if ( isInternalActionId(actionId) ) {
+            emit sendActionData(actionId, QByteArray());
+            return;
+        }
+        m_callbackActionIds.removeOne(actionId);
+    }
+
+    for (int i = m_callbackActionIds.size() - 1; i >= 0; --i) {
+        if ( !isInternalActionId(m_callbackActionIds[i]) )
+            m_callbackActionIds.removeAt(i);
+    }
+
+    // If all workers are busy, the callback will be picked up by the first one to finish.
+    if (m_callbackActionIds.size() < maxCallbackWorkerCount) {
+        const auto action = runScript("runCallbacks()");
+        const int actionId = action->id();
+        m_callbackActionIds.append(actionId);
+
+        // Worker can exit or be killed; pass pending callbacks to other workers.
+        connect( action, &Action::actionFinished, this, [this, actionId]() {
+            m_callbackActionIds.removeOne(actionId);
+            m_idleCallbackActionIds.removeOne(actionId);
+            if ( !m_callbacks.isEmpty() )
+                wakeUpCallbackWorker();
+        });
+    }
+}
+
+QByteArray MainWindow::takeCallback(int actionId)
+{
+    if ( !m_callbackActionIds.contains(actionId) )
+        return "ABORT";
+
+    if ( m_callbacks.isEmpty() ) {
+        if ( !m_idleCallbackActionIds.contains(actionId) )
+            m_idleCallbackActionIds.append(actionId);
+        return QByteArray();
+    }
+
+    const Callback callback = m_callbacks.takeFirst();
+    m_actionHandler->setActionData(actionId, callback.data);
+
+    QByteArray bytes;
+    QDataStream out(&bytes, QIODevice::WriteOnly);
+    out << callback.script;
+    serializeData(&out, callback.data);
+    return bytes;
+}
+
 void MainWindow::snip()
 {
     m_forceIconSnip = true;
@@ -2950,7 +3313,7 @@ void MainWindow::disableClipboardStoring(bool disable)
     updateIconSnip();
 
     if (m_clipboardStoringDisabled)
-        runScript("setTitle(); showDataNotification()");
+        runCallback("setTitle(); showDataNotification()", QVariantMap());
 
     COPYQ_LOG( QString("Clipboard monitoring %1.")
                .arg(m_clipboardStoringDisabled ? "disabled" : "enabled") );
@@ -3383,7 +3746,8 @@ bool MainWindow::exportData()
     const bool exportConfiguration = exportDialog.isConfigurationEnabled();
     const bool exportCommands = exportDialog.isCommandsEnabled();
 
-    if ( !exportDataFrom(fileName, tabs, exportConfiguration, exportCommands) ) {
+    const bool showProgress = true;
+    if ( !exportDataFrom(fileName, tabs, exportConfiguration, exportCommands, showProgress) ) {
         QMessageBox::critical(
                     this, tr("CopyQ Export Error"),
                     tr("Failed to export file %1!")
@@ -3441,6 +3805,21 @@ bool MainWindow::loadTab(const QString &fileName)
 }
 
 bool MainWindow::importDataFrom(const QString &fileName, ImportOptions options)
+{
+    // Omit importing while other import or export waits for items to be processed.
+    if (m_importingOrExporting) {
+        log("Cannot import while other import or export is in progress", LogError);
+        return false;
+    }
+
+    m_importingOrExporting = true;
+    const bool imported = importDataFromHelper(fileName, options);
+    m_importingOrExporting = false;
+
+    return imported;
+}
+
+bool MainWindow::importDataFromHelper(const QString &fileName, ImportOptions options)
 {
     // Compatibility with v2.9.0 and earlier.
     if ( loadTab(fileName) )
@@ -3453,6 +3832,15 @@ bool MainWindow::importDataFrom(const QString &fileName, ImportOptions options)
     QDataStream in(&file);
     in.setVersion(QDataStream::Qt_4_7);
 
+    QByteArray header;
+    in >> header;
+    if ( header.startsWith(exportHeaderV4) )
+        return importDataV4(&in, fileName, options);
+
+    // Compatibility with v3.9.3 and earlier.
+    if ( !file.seek(0) )
+        return false;
+    in.resetStatus();
     return importDataV3(&in, options);
 }
 
@@ -3461,8 +3849,9 @@ bool MainWindow::exportAllData(const QString &fileName)
     const auto tabs = ui->tabWidget->tabs();
     const bool exportConfiguration = true;
     const bool exportCommands = true;
+    const bool showProgress = false;
 
-    return exportDataFrom(fileName, tabs, exportConfiguration, exportCommands);
+    return exportDataFrom(fileName, tabs, exportConfiguration, exportCommands, showProgress);
 }
 
 bool MainWindow::importData()
@@ -22,6 +22,7 @@
 
 #include "common/clipboardmode.h"
 #include "common/command.h"
+#include "common/commandmatcher.h"
 #include "gui/clipboardbrowsershared.h"
 #include "gui/menuitems.h"
 #include "item/persistentdisplayitem.h"
@@ -175,6 +176,17 @@ public:
             const QString &name //!< Name of the new tab.
             );
 
+    /**
+     * Add items to tab with given name (or current tab if the name is empty).
+     *
+     * Tab is created if it doesn't exist. Items are only stored if the tab is
+     * not loaded (see ClipboardBrowserPlaceholder::addItems()).
+     */
+    bool addToTab(const QString &name, const QVector<QVariantMap> &items);
+
+    /** Add new clipboard content to tab (see ClipboardBrowser::addUnique()). */
+    bool addUniqueToTab(const QString &name, const QVariantMap &data, ClipboardMode mode);
+
     /**
      * Show/hide tray menu. Return true only if menu is shown.
      */
@@ -278,6 +290,16 @@ public:
 
     QVariantMap setDisplayData(int actionId, const QVariantMap &data);
 
+    /** Run callback script with given data in a long-lived script worker process. */
+    void runCallback(const QString &script, const QVariantMap &data);
+
+    /**
+     * Return next serialized callback for script worker with given action ID.
+     *
+     * Returns empty data if there are no pending callbacks or "ABORT" if the worker should exit.
+     */
+    QByteArray takeCallback(int actionId);
+
     QVector<Command> automaticCommands() const { return m_automaticCommands; }
     QVector<Command> displayCommands() const { return m_displayCommands; }
     QVector<Command> scriptCommands() const { return m_scriptCommands; }
@@ -532,12 +554,30 @@ private:
         QStringList matchCommands;
         QVector< QPointer<QAction> > actions;
         QMenu *menu = nullptr;
+        /// Hash of data for which filter results are cached (see menuFilterDataHash()).
+        quint64 dataHash = 0;
+        /// Cached filter results, dropped when selected items or their data change.
+        QHash<QString, bool> filterResults;
+    };
+
+    struct Callback {
+        QString script;
+        QVariantMap data;
     };
 
     void runDisplayCommands();
 
     void clearHiddenDisplayData();
 
+    /** Pass pending callback to an idle script worker or start a new worker. */
+    void wakeUpCallbackWorker();
+
+    /** Let script workers exit after finishing current callbacks. */
+    void stopCallbackWorkers();
+
+    /** Let script workers exit if these are not processing any callbacks. */
+    void stopIdleCallbackWorkers();
+
     void reloadBrowsers();
 
     ClipboardBrowserPlaceholder *createTab(const QString &name, TabNameMatching nameMatch);
@@ -594,13 +634,14 @@ private:
     template <typename Receiver, typename ReturnType>
     QAction *addItemAction(int id, Receiver *receiver, ReturnType (Receiver::* slot)());
 
-    QVector<Command> commandsForMenu(const QVariantMap &data, const QString &tabName, const QVector<Command> &allCommands);
+    QVector<Command> commandsForMenu(const QVariantMap &data, const QString &tabName, const CommandMatcher &matcher);
     void addCommandsToItemMenu(ClipboardBrowser *c);
     void addCommandsToTrayMenu(const QVariantMap &clipboardData);
     void addMenuMatchCommand(MenuMatchCommands *menuMatchCommands, const QString &matchCommand, QAction *act);
     void runMenuCommandFilters(MenuMatchCommands *menuMatchCommands, const QVariantMap &data);
     void interruptMenuCommandFilters(MenuMatchCommands *menuMatchCommands);
     void stopMenuCommandFilters(MenuMatchCommands *menuMatchCommands);
+    void setMenuActionEnabled(QAction *action, bool enabled, bool removeIfDisabled);
 
     void terminateAction(int *actionId);
 
@@ -625,9 +666,21 @@ private:
     bool toggleMenu(TrayMenu *menu, QPoint pos);
     bool toggleMenu(TrayMenu *menu);
 
-    bool exportDataFrom(const QString &fileName, const QStringList &tabs, bool exportConfiguration, bool exportCommands);
-    bool exportDataV3(QDataStream *out, const QStringList &tabs, bool exportConfiguration, bool exportCommands);
+    bool exportDataFrom(
+            const QString &fileName, const QStringList &tabs, bool exportConfiguration, bool exportCommands,
+            bool showProgress);
+    bool exportDataFromHelper(
+            const QString &fileName, const QStringList &tabs, bool exportConfiguration, bool exportCommands,
+            bool showProgress);
+    bool importDataFromHelper(const QString &fileName, ImportOptions options);
     bool importDataV3(QDataStream *in, ImportOptions options);
+    bool importDataV4(QDataStream *in, const QString &fileName, ImportOptions options);
+
+    /** Let user select what to import; returns false if cancelled. */
+    bool selectDataToImport(QStringList *tabs, bool *importConfiguration, bool *importCommands,
+                            bool hasConfiguration, bool hasCommands);
+    bool importSettings(const QVariantMap &settingsMap);
+    bool importCommandList(const QVariantList &commandsList);
 
     const Theme &theme() const;
 
@@ -652,8 +705,8 @@ private:
 
     QVector<Command> m_automaticCommands;
     QVector<Command> m_displayCommands;
-    QVector<Command> m_menuCommands;
-    QVector<Command> m_trayMenuCommands;
+    CommandMatcher m_menuCommands;
+    CommandMatcher m_trayMenuCommands;
     QVector<Command> m_scriptCommands;
 
     PlatformWindowPtr m_lastWindow;
@@ -667,6 +720,7 @@ private:
     QTimer m_timerSaveTabPositions;
     QTimer m_timerHideWindowIfNotActive;
     QTimer m_timerRaiseLastWindowAfterMenuClosed;
+    QTimer m_timerStopIdleCallbackWorkers;
 
     NotificationDaemon *m_notifications;
 
@@ -689,6 +743,8 @@ private:
 
     bool m_activatingItem = false;
 
+    bool m_importingOrExporting = false;
+
     QVector< QPointer<QAction> > m_actions;
     QPointer<QAction> m_showHideAction;
     MenuItems m_menuItems;
@@ -697,6 +753,10 @@ private:
     PersistentDisplayItem m_currentDisplayItem;
     int m_displayActionId = -1;
 
+    QList<Callback> m_callbacks;
+    QVector<int> m_callbackActionIds;
+    QVector<int> m_idleCallbackActionIds;
+
     MenuMatchCommands m_trayMenuMatchCommands;
     MenuMatchCommands m_itemMenuMatchCommands;
 
@@ -38,8 +38,34 @@ namespace {
 const char propertyCustomAction[] = "CopyQ_tray_menu_custom_action";
 const char propertyClipboardItemAction[] = "CopyQ_tray_menu_clipboard_item";
 
+/// Cached clipboard item action data are dropped after menu is updated this many times without the item.
+const int maxClipboardItemCacheAge = 4;
+
 const QIcon iconClipboard() { return getIcon("clipboard", IconPaste); }
 
+QPixmap imageIcon(const QVariantMap &data)
+{
+    const QStringList formats = data.keys();
+    const int imageIndex = formats.indexOf( QRegExp("^image/.*") );
+    if (imageIndex == -1)
+        return QPixmap();
+
+    const auto &mime = formats[imageIndex];
+    QPixmap pix;
+    pix.loadFromData( data.value(mime).toByteArray(), mime.toLatin1().data() );
+    const int iconSize = smallIconSize();
+    int x = 0;
+    int y = 0;
+    if (pix.width() > pix.height()) {
+        pix = pix.scaledToHeight(iconSize);
+        x = (pix.width() - iconSize) / 2;
+    } else {
+        pix = pix.scaledToWidth(iconSize);
+        y = (pix.height() - iconSize) / 2;
+    }
+    return pix.copy(x, y, iconSize, iconSize);
+}
+
 bool canActivate(const QAction &action)
 {
     return !action.isSeparator() && action.isEnabled();
@@ -90,11 +116,17 @@ void TrayMenu::addClipboardItemAction(const QModelIndex &index, bool showImages)
     if ( m_clipboardItemActionCount == 0 && m_searchText.isEmpty() )
         setSearchMenuItem( m_viMode ? tr("Press '/' to search") : tr("Type to search") );
 
-    const QVariantMap data = index.data(contentType::data).toMap();
+    // Avoid copying item data, rendering label and image again if item didn't change.
+    const auto itemHash = index.data(contentType::hash).toULongLong();
+    auto &item = m_clipboardItemCache[itemHash];
+    if ( !item.data.isValid() )
+        item.data = index.data(contentType::data);
+    item.generation = m_clipboardItemCacheGeneration;
+
     QAction *act = addAction(QString());
     act->setProperty(propertyClipboardItemAction, true);
 
-    act->setData(index.data(contentType::data));
+    act->setData(item.data);
 
     insertAction(m_clipboardItemActionsSeparator, act);
 
@@ -109,30 +141,23 @@ void TrayMenu::addClipboardItemAction(const QModelIndex &index, bool showImages)
 
     m_clipboardItemActionCount++;
 
-    const QString label = textLabelForData( data, act->font(), format, true );
-    act->setText(label);
+    const QFont font = act->font();
+    if ( !item.labelRendered || item.labelFormat != format || item.labelFont != font ) {
+        item.label = textLabelForData( item.data.toMap(), font, format, true );
+        item.labelFormat = format;
+        item.labelFont = font;
+        item.labelRendered = true;
+    }
+    act->setText(item.label);
 
     // Menu item icon from image.
     if (showImages) {
-        const QStringList formats = data.keys();
-        const int imageIndex = formats.indexOf( QRegExp("^image/.*") );
-        if (imageIndex != -1) {
-            const auto &mime = formats[imageIndex];
-            QPixmap pix;
-            pix.loadFromData( data.value(mime).toByteArray(), mime.toLatin1().data() );
-            const int iconSize = smallIconSize();
-            int x = 0;
-            int y = 0;
-            if (pix.width() > pix.height()) {
-                pix = pix.scaledToHeight(iconSize);
-                x = (pix.width() - iconSize) / 2;
-            } else {
-                pix = pix.scaledToWidth(iconSize);
-                y = (pix.height() - iconSize) / 2;
-            }
-            pix = pix.copy(x, y, iconSize, iconSize);
-            act->setIcon(pix);
+        if (!item.iconLoaded) {
+            item.icon = imageIcon( item.data.toMap() );
+            item.iconLoaded = true;
         }
+        if ( !item.icon.isNull() )
+            act->setIcon(item.icon);
     }
 
     connect(act, &QAction::triggered, this, &TrayMenu::onClipboardItemActionTriggered);
@@ -146,6 +171,14 @@ void TrayMenu::clearClipboardItems()
 
     m_clipboardItemActionCount = 0;
 
+    ++m_clipboardItemCacheGeneration;
+    for (auto it = m_clipboardItemCache.begin(); it != m_clipboardItemCache.end(); ) {
+        if (m_clipboardItemCacheGeneration - it->generation > maxClipboardItemCacheAge)
+            it = m_clipboardItemCache.erase(it);
+        else
+            ++it;
+    }
+
     // Show search text at top of the menu.
     if ( !m_searchText.isEmpty() )
         setSearchMenuItem(m_searchText);
@@ -20,9 +20,13 @@
 #ifndef TRAYMENU_H
 #define TRAYMENU_H
 
+#include <QFont>
+#include <QHash>
 #include <QMenu>
+#include <QPixmap>
 #include <QPointer>
 #include <QTimer>
+#include <QVariant>
 
 class QAction;
 class QModelIndex;
@@ -78,6 +82,18 @@ protected:
     void leaveEvent(QEvent *event) override;
 
 private:
+    /// Cached data for clipboard item action so it's not recreated on each menu update.
+    struct ClipboardItemActionData {
+        QVariant data;
+        QString label;
+        QString labelFormat;
+        QFont labelFont;
+        bool labelRendered = false;
+        QPixmap icon;
+        bool iconLoaded = false;
+        int generation = 0;
+    };
+
     void clearActionsWithProperty(const char *property);
 
     void onClipboardItemActionTriggered();
@@ -99,6 +115,10 @@ private:
     QString m_searchText;
 
     QTimer m_timerUpdateActiveAction;
+
+    /// Clipboard item action data by item hash.
+    QHash<quint64, ClipboardItemActionData> m_clipboardItemCache;
+    int m_clipboardItemCacheGeneration = 0;
 };
 
 #endif // TRAYMENU_H
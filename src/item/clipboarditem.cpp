@@ -26,22 +26,184 @@
 
 #include <QBrush>
 #include <QByteArray>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSet>
 #include <QString>
 #include <QStringList>
 #include <QVariant>
+#include <QVector>
 
 namespace {
 
 void clearDataExceptInternal(QVariantMap *data)
 {
     for ( const auto &format : data->keys() ) {
-        if ( !format.startsWith(COPYQ_MIME_PREFIX) )
+        if ( !isInternalFormat(format) )
             data->remove(format);
     }
 }
 
+bool isSearchedFormat(const QString &format)
+{
+    return format.startsWith(QLatin1String("text/")) || isInternalFormat(format);
+}
+
+ItemDataMappingPtr findMapping(const QVariantMap &data)
+{
+    for (const auto &value : data) {
+        if (value.type() != QVariant::ByteArray)
+            continue;
+
+        auto mapping = ItemDataMapping::find( value.toByteArray() );
+        if (mapping)
+            return mapping;
+    }
+
+    return nullptr;
+}
+
+/// Unused data are kept in pool until pool size exceeds this.
+const qint64 minPoolDataSize = 16 * 1024 * 1024;
+
+/// Smaller data are not shared between items.
+const int minSharedDataSize = 1024;
+
+/**
+ * Keeps single copy of equal item data.
+ *
+ * Items in all tabs get implicitly shared copy of the data if it's already
+ * in the pool. Data not used by any item are removed once pool grows enough
+ * or after items are removed.
+ */
+class ItemDataPool final {
+public:
+    QByteArray share(const QByteArray &bytes)
+    {
+        QMutexLocker lock(&m_mutex);
+
+        const auto it = m_pool.constFind(bytes);
+        if ( it != m_pool.constEnd() )
+            return *it;
+
+        if (m_dataSize > m_maxDataSize)
+            removeUnusedData();
+
+        m_pool.insert(bytes);
+        m_dataSize += bytes.size();
+        return bytes;
+    }
+
+    void releaseUnusedData()
+    {
+        QMutexLocker lock(&m_mutex);
+        removeUnusedData();
+    }
+
+    void releaseUnusedData(QVector<QByteArray> *dataList)
+    {
+        QMutexLocker lock(&m_mutex);
+
+        QVector<QSet<QByteArray>::iterator> candidates;
+        QSet<const QByteArray*> found;
+        for (const auto &bytes : *dataList) {
+            const auto it = m_pool.find(bytes);
+            if ( it != m_pool.end() && it->isSharedWith(bytes) && !found.contains(&*it) ) {
+                found.insert(&*it);
+                candidates.append(it);
+            }
+        }
+
+        // Drop references from the list so only references from items are left.
+        dataList->clear();
+
+        for (const auto &it : candidates) {
+            if ( it->isDetached() ) {
+                m_dataSize -= it->size();
+                m_pool.erase(it);
+            }
+        }
+    }
+
+private:
+    void removeUnusedData()
+    {
+        for (auto it = m_pool.begin(); it != m_pool.end(); ) {
+            // Data are not shared with any item.
+            if ( it->isDetached() ) {
+                m_dataSize -= it->size();
+                it = m_pool.erase(it);
+            } else {
+                ++it;
+            }
+        }
+
+        m_maxDataSize = qMax(minPoolDataSize, 2 * m_dataSize);
+    }
+
+    QMutex m_mutex;
+    QSet<QByteArray> m_pool;
+    qint64 m_dataSize = 0;
+    qint64 m_maxDataSize = minPoolDataSize;
+};
+
+ItemDataPool &itemDataPool()
+{
+    static ItemDataPool pool;
+    return pool;
+}
+
+QVariant sharedValue(const QVariant &value)
+{
+    if (value.type() != QVariant::ByteArray)
+        return value;
+
+    const QByteArray bytes = value.toByteArray();
+    if (bytes.size() < minSharedDataSize)
+        return value;
+
+    return itemDataPool().share(bytes);
+}
+
+void shareData(QVariantMap *data, const ItemDataMappingPtr &mapping)
+{
+    for (auto it = data->begin(); it != data->end(); ++it) {
+        // Mapped data are not held in memory.
+        if ( mapping && mapping->contains(it.value().toByteArray()) )
+            continue;
+
+        it.value() = sharedValue( it.value() );
+    }
+}
+
 } // namespace
 
+QString searchText(const QVariantMap &data)
+{
+    QString text;
+    for (auto it = data.constBegin(); it != data.constEnd(); ++it) {
+        const auto &format = it.key();
+        text.append(format);
+        text.append('\n');
+        if ( isSearchedFormat(format) ) {
+            text.append( getTextData(it.value().toByteArray()) );
+            text.append('\n');
+        }
+    }
+    return text;
+}
+
+void releaseUnusedItemData()
+{
+    itemDataPool().releaseUnusedData();
+}
+
+void releaseUnusedItemData(QVector<QByteArray> *dataList)
+{
+    if ( !dataList->isEmpty() )
+        itemDataPool().releaseUnusedData(dataList);
+}
+
 ClipboardItem::ClipboardItem()
     : m_data()
     , m_hash(0)
@@ -51,7 +213,9 @@ ClipboardItem::ClipboardItem()
 ClipboardItem::ClipboardItem(const QVariantMap &data)
     : m_data(data)
     , m_hash(0)
+    , m_mapping(findMapping(data))
 {
+    shareData(&m_data, m_mapping);
 }
 
 bool ClipboardItem::operator ==(const ClipboardItem &item) const
@@ -62,7 +226,7 @@ bool ClipboardItem::operator ==(const ClipboardItem &item) const
 void ClipboardItem::setText(const QString &text)
 {
     for ( const auto &format : m_data.keys() ) {
-        if ( format.startsWith("text/") )
+        if ( format.startsWith(QLatin1String("text/")) )
             m_data.remove(format);
     }
 
@@ -77,6 +241,8 @@ bool ClipboardItem::setData(const QVariantMap &data)
         return false;
 
     m_data = data;
+    m_mapping = findMapping(m_data);
+    shareData(&m_data, m_mapping);
     invalidateDataHash();
     return true;
 }
@@ -86,7 +252,7 @@ bool ClipboardItem::updateData(const QVariantMap &data)
     const int oldSize = m_data.size();
     for (auto it = data.constBegin(); it != data.constEnd(); ++it) {
         const auto &format = it.key();
-        if ( !format.startsWith(COPYQ_MIME_PREFIX) ) {
+        if ( !isInternalFormat(format) ) {
             clearDataExceptInternal(&m_data);
             break;
         }
@@ -101,7 +267,7 @@ bool ClipboardItem::updateData(const QVariantMap &data)
             m_data.remove(format);
             changed = true;
         } else if ( m_data.value(format) != value ) {
-            m_data.insert(format, value);
+            m_data.insert( format, sharedValue(value) );
             changed = true;
         }
     }
@@ -136,7 +302,7 @@ bool ClipboardItem::removeData(const QStringList &mimeTypeList)
 
 void ClipboardItem::setData(const QString &mimeType, const QByteArray &data)
 {
-    m_data.insert(mimeType, data);
+    m_data.insert( mimeType, sharedValue(data) );
     invalidateDataHash();
 }
 
@@ -152,9 +318,11 @@ QVariant ClipboardItem::data(int role) const
         break;
 
     case contentType::data:
-        return m_data; // copy-on-write, so this should be fast
+        return unmappedData(); // copy-on-write except data in mapped tab file
+    case contentType::mappedData:
+        return m_data;
     case contentType::hash:
-        return dataHash();
+        return static_cast<qulonglong>( dataHash() );
     case contentType::hasText:
         return m_data.contains(mimeText) || m_data.contains(mimeUriList);
     case contentType::hasHtml:
@@ -169,12 +337,24 @@ QVariant ClipboardItem::data(int role) const
         return getTextData(m_data, mimeColor);
     case contentType::isHidden:
         return m_data.contains(mimeHidden);
+    case contentType::searchText:
+        return searchText(m_data);
+    case contentType::searchData:
+        return searchData();
     }
 
     return QVariant();
 }
 
-unsigned int ClipboardItem::dataHash() const
+QByteArray ClipboardItem::data(const QString &format) const
+{
+    const QByteArray bytes = m_data.value(format).toByteArray();
+    if ( m_mapping && m_mapping->contains(bytes) )
+        return QByteArray( bytes.constData(), bytes.size() );
+    return bytes;
+}
+
+quint64 ClipboardItem::dataHash() const
 {
     if (m_hash == 0)
         m_hash = hash(m_data);
@@ -186,3 +366,52 @@ void ClipboardItem::invalidateDataHash()
 {
     m_hash = 0;
 }
+
+QVariantMap ClipboardItem::searchData() const
+{
+    if (!m_mapping)
+        return m_data;
+
+    // Omit large mapped data not needed for search text.
+    QVariantMap data = m_data;
+    for (auto it = data.begin(); it != data.end(); ++it) {
+        const QByteArray bytes = it.value().toByteArray();
+        if ( m_mapping->contains(bytes) ) {
+            it.value() = isSearchedFormat(it.key())
+                    ? QByteArray( bytes.constData(), bytes.size() )
+                    : QByteArray();
+        }
+    }
+
+    return data;
+}
+
+void ClipboardItem::clearData(QVector<QByteArray> *sharedData)
+{
+    for (const auto &value : m_data) {
+        if (value.type() != QVariant::ByteArray)
+            continue;
+
+        const QByteArray bytes = value.toByteArray();
+        if ( bytes.size() >= minSharedDataSize && !(m_mapping && m_mapping->contains(bytes)) )
+            sharedData->append(bytes);
+    }
+
+    *this = ClipboardItem();
+}
+
+QVariantMap ClipboardItem::unmappedData() const
+{
+    if (!m_mapping)
+        return m_data;
+
+    // Returned data can outlive the mapped file.
+    QVariantMap data = m_data;
+    for (auto it = data.begin(); it != data.end(); ++it) {
+        const QByteArray bytes = it.value().toByteArray();
+        if ( m_mapping->contains(bytes) )
+            it.value() = QByteArray( bytes.constData(), bytes.size() );
+    }
+
+    return data;
+}
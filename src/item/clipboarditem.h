@@ -20,7 +20,10 @@
 #ifndef CLIPBOARDITEM_H
 #define CLIPBOARDITEM_H
 
+#include "item/itemdatamapping.h"
+
 #include <QVariant>
+#include <QVector>
 
 class QByteArray;
 class QString;
@@ -72,16 +75,55 @@ public:
     QVariant data(int role) const;
 
     /** Return data for format. */
-    QByteArray data(const QString &format) const { return m_data.value(format).toByteArray(); }
+    QByteArray data(const QString &format) const;
 
-    /** Return hash for item's data. */
-    unsigned int dataHash() const;
+    /** Return hash for item's data (computed lazily and cached). */
+    quint64 dataHash() const;
+
+    /**
+     * Remove all data.
+     *
+     * Data which can be shared with other items are appended to @a sharedData
+     * (see releaseUnusedItemData()).
+     */
+    void clearData(QVector<QByteArray> *sharedData);
 
 private:
     void invalidateDataHash();
 
+    /** Return data for search text not referencing mapped tab file. */
+    QVariantMap searchData() const;
+
+    /** Return data not referencing mapped tab file. */
+    QVariantMap unmappedData() const;
+
     QVariantMap m_data;
-    mutable unsigned int m_hash;
+    mutable quint64 m_hash;
+
+    /** Tab file which large data can reference (see ItemDataMapping). */
+    ItemDataMappingPtr m_mapping;
 };
 
+/**
+ * Return text from text and internal formats including format names.
+ *
+ * @see contentType::searchText
+ */
+QString searchText(const QVariantMap &data);
+
+/**
+ * Free memory of shared item data not used by any item anymore.
+ *
+ * Should be called after items are removed.
+ */
+void releaseUnusedItemData();
+
+/**
+ * Free memory of shared item data from @a dataList not used by any item anymore.
+ *
+ * Unlike releaseUnusedItemData(), this checks only the given data.
+ * The list is cleared so it doesn't hold the data.
+ */
+void releaseUnusedItemData(QVector<QByteArray> *dataList);
+
 #endif // CLIPBOARDITEM_H
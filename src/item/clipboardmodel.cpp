@@ -26,6 +26,7 @@
 
 #include <algorithm>
 #include <functional>
+#include <vector>
 
 namespace {
 
@@ -62,17 +63,35 @@ void ClipboardItemList::move(int from, int count, int to)
         count = to - from - count;
     }
 
-    const auto start1 = std::begin(m_items) + from;
+    const auto start1 = iteratorAt(from);
     const auto start2 = start1 + count;
-    const auto end2 = std::begin(m_items) + to;
+    const auto end2 = iteratorAt(to);
     std::rotate(start1, start2, end2);
 }
 
+void ClipboardItemList::insert(int row, const QVector<QVariantMap> &dataList)
+{
+    std::vector<ClipboardItem> items;
+    items.reserve( static_cast<size_t>(dataList.size()) );
+    for (const auto &data : dataList)
+        items.emplace_back(data);
+
+    m_items.insert( iteratorAt(row), items.begin(), items.end() );
+}
+
 ClipboardModel::ClipboardModel(QObject *parent)
     : QAbstractListModel(parent)
 {
 }
 
+ClipboardModel::~ClipboardModel()
+{
+    QVector<QByteArray> removedData;
+    for (int row = 0; row < m_clipboardList.size(); ++row)
+        m_clipboardList[row].clearData(&removedData);
+    releaseUnusedItemData(&removedData);
+}
+
 int ClipboardModel::rowCount(const QModelIndex&) const
 {
     return m_clipboardList.size();
@@ -100,6 +119,7 @@ bool ClipboardModel::setData(const QModelIndex &index, const QVariant &value, in
         return false;
 
     int row = index.row();
+    const quint64 oldHash = m_hashIndexValid ? m_clipboardList[row].dataHash() : 0;
 
     if (role == Qt::EditRole) {
         m_clipboardList[row].setText(value.toString());
@@ -123,6 +143,11 @@ bool ClipboardModel::setData(const QModelIndex &index, const QVariant &value, in
         return false;
     }
 
+    if (m_hashIndexValid) {
+        removeFromHashIndex(oldHash);
+        addToHashIndex(row, row);
+    }
+
     emit dataChanged(index, index);
 
     return true;
@@ -136,28 +161,35 @@ void ClipboardModel::insertItem(const QVariantMap &data, int row)
     beginInsertRows(QModelIndex(), row, row);
 
     m_clipboardList.insert(row, item);
+    hashIndexRowsInserted(row, row);
 
     endInsertRows();
 }
 
-void ClipboardModel::insertItems(const QList<QVariantMap> &dataList, int row)
+void ClipboardModel::insertItems(const QVector<QVariantMap> &dataList, int row)
 {
     if ( dataList.isEmpty() )
         return;
 
-    int targetRow = row;
-    m_clipboardList.reserve( m_clipboardList.size() + dataList.size() );
+    const int lastRow = row + dataList.size() - 1;
+    beginInsertRows(QModelIndex(), row, lastRow);
 
-    beginInsertRows(QModelIndex(), row, row + dataList.size() - 1);
+    m_clipboardList.insert(row, dataList);
 
-    for ( auto it = std::begin(dataList); it != std::end(dataList); ++it ) {
-        m_clipboardList.insert(targetRow, ClipboardItem(*it));
-        ++targetRow;
-    }
+    hashIndexRowsInserted(row, lastRow);
 
     endInsertRows();
 }
 
+QList<ClipboardItem> ClipboardModel::items() const
+{
+    QList<ClipboardItem> items;
+    items.reserve( m_clipboardList.size() );
+    for (int i = 0; i < m_clipboardList.size(); ++i)
+        items.append( m_clipboardList[i] );
+    return items;
+}
+
 bool ClipboardModel::insertRows(int position, int rows, const QModelIndex&)
 {
     if ( rows <= 0 || position < 0 )
@@ -165,8 +197,9 @@ bool ClipboardModel::insertRows(int position, int rows, const QModelIndex&)
 
     beginInsertRows(QModelIndex(), position, position + rows - 1);
 
-    for (int row = 0; row < rows; ++row)
-        m_clipboardList.insert(position, ClipboardItem());
+    m_clipboardList.insert(position, rows);
+
+    hashIndexRowsInserted(position, position + rows - 1);
 
     endInsertRows();
 
@@ -182,10 +215,20 @@ bool ClipboardModel::removeRows(int position, int rows, const QModelIndex&)
 
     beginRemoveRows(QModelIndex(), position, last);
 
+    removeFromHashIndex(position, last);
+
+    // Check only data of removed items instead of all shared data.
+    QVector<QByteArray> removedData;
+    for (int row = position; row <= last; ++row)
+        m_clipboardList[row].clearData(&removedData);
+
     m_clipboardList.remove(position, last - position + 1);
+    hashIndexRowsRemoved(position, last);
 
     endRemoveRows();
 
+    releaseUnusedItemData(&removedData);
+
     return true;
 }
 
@@ -208,6 +251,10 @@ bool ClipboardModel::moveRows(
 
     beginMoveRows(sourceParent, sourceRow, last, destinationParent, destinationRow);
     m_clipboardList.move(sourceRow, rows, destinationRow);
+    if (destinationRow < sourceRow)
+        updateHashIndex(destinationRow, last);
+    else
+        updateHashIndex(sourceRow, destinationRow - 1);
     endMoveRows();
 
     return true;
@@ -227,6 +274,7 @@ void ClipboardModel::sortItems(const QModelIndexList &indexList, CompareItems *c
             if (targetRow != sourceRow) {
                 beginMoveRows(QModelIndex(), sourceRow, sourceRow, QModelIndex(), targetRow);
                 m_clipboardList.move(sourceRow, targetRow);
+                updateHashIndex( qMin(sourceRow, targetRow), qMax(sourceRow, targetRow) );
                 endMoveRows();
 
                 // If the moved item was removed or moved further (as reaction on moving the item),
@@ -240,12 +288,143 @@ void ClipboardModel::sortItems(const QModelIndexList &indexList, CompareItems *c
     }
 }
 
-int ClipboardModel::findItem(uint itemHash) const
+int ClipboardModel::findItem(quint64 itemHash) const
+{
+    if (!m_hashIndexValid)
+        rebuildHashIndex();
+
+    auto it = m_hashIndex.find(itemHash);
+    if ( it == m_hashIndex.end() )
+        return -1;
+
+    int row = rowFromHashIndexPosition(it->position);
+    if ( row < 0 || row >= m_clipboardList.size() || m_clipboardList[row].dataHash() != itemHash ) {
+        // Top-most of equal items was removed.
+        rebuildHashIndex();
+        it = m_hashIndex.find(itemHash);
+        if ( it == m_hashIndex.end() )
+            return -1;
+
+        return rowFromHashIndexPosition(it->position);
+    }
+
+    // Indexed item can be a lower one of equal items, return the top-most one.
+    if (it->count > 1) {
+        for (int aboveRow = row - 1; aboveRow >= 0; --aboveRow) {
+            if ( m_clipboardList[aboveRow].dataHash() == itemHash )
+                row = aboveRow;
+        }
+        it->position = hashIndexPosition(row);
+    }
+
+    return row;
+}
+
+int ClipboardModel::hashIndexPosition(int row) const
+{
+    return m_clipboardList.size() - row + m_hashIndexBottomOffset;
+}
+
+int ClipboardModel::rowFromHashIndexPosition(int position) const
+{
+    return m_clipboardList.size() - position + m_hashIndexBottomOffset;
+}
+
+void ClipboardModel::rebuildHashIndex() const
+{
+    m_hashIndex.clear();
+    m_hashIndex.reserve( m_clipboardList.size() );
+    m_hashIndexBottomOffset = 0;
+
+    // Iterate from the bottom so the top-most row is remembered for equal items.
+    for (int row = m_clipboardList.size() - 1; row >= 0; --row) {
+        HashIndexEntry &entry = m_hashIndex[ m_clipboardList[row].dataHash() ];
+        ++entry.count;
+        entry.position = hashIndexPosition(row);
+    }
+
+    m_hashIndexValid = true;
+}
+
+void ClipboardModel::updateHashIndex(int first, int last) const
+{
+    if (!m_hashIndexValid)
+        return;
+
+    for (int row = last; row >= first; --row) {
+        const quint64 itemHash = m_clipboardList[row].dataHash();
+        HashIndexEntry &entry = m_hashIndex[itemHash];
+
+        // Keep equal item above updated rows.
+        if (entry.count > 1) {
+            const int indexedRow = rowFromHashIndexPosition(entry.position);
+            if ( indexedRow >= 0 && indexedRow < first
+                 && m_clipboardList[indexedRow].dataHash() == itemHash )
+            {
+                continue;
+            }
+        }
+
+        entry.position = hashIndexPosition(row);
+    }
+}
+
+void ClipboardModel::addToHashIndex(int first, int last)
+{
+    if (!m_hashIndexValid)
+        return;
+
+    for (int row = first; row <= last; ++row)
+        ++m_hashIndex[ m_clipboardList[row].dataHash() ].count;
+
+    updateHashIndex(first, last);
+}
+
+void ClipboardModel::removeFromHashIndex(int first, int last)
+{
+    if (!m_hashIndexValid)
+        return;
+
+    for (int row = first; row <= last; ++row)
+        removeFromHashIndex( m_clipboardList[row].dataHash() );
+}
+
+void ClipboardModel::removeFromHashIndex(quint64 itemHash)
 {
-    for (int i = 0; i < m_clipboardList.size(); ++i) {
-        if ( m_clipboardList[i].dataHash() == itemHash )
-            return i;
+    const auto it = m_hashIndex.find(itemHash);
+    if ( it == m_hashIndex.end() )
+        return;
+
+    if (--it->count == 0)
+        m_hashIndex.erase(it);
+}
+
+void ClipboardModel::hashIndexRowsInserted(int first, int last)
+{
+    if (!m_hashIndexValid)
+        return;
+
+    // Positions of rows above inserted ones changed.
+    if ( first > 0 ) {
+        if ( last == m_clipboardList.size() - 1 )
+            m_hashIndexBottomOffset -= last - first + 1;
+        else
+            updateHashIndex(0, first - 1);
     }
 
-    return -1;
+    addToHashIndex(first, last);
+}
+
+void ClipboardModel::hashIndexRowsRemoved(int first, int last)
+{
+    if (!m_hashIndexValid)
+        return;
+
+    // Positions of rows above removed ones changed.
+    if ( first > 0 ) {
+        if ( first == m_clipboardList.size() )
+            m_hashIndexBottomOffset += last - first + 1;
+        else
+            updateHashIndex(0, first - 1);
+    }
 }
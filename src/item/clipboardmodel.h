@@ -23,67 +23,79 @@
 #include "item/clipboarditem.h"
 
 #include <QAbstractListModel>
+#include <QHash>
 #include <QList>
+#include <QVector>
+
+#include <deque>
 
 /**
  * Container with clipboard items.
  *
- * Item prepending is optimized.
+ * Items are stored by value in contiguous blocks (no allocation per item) and
+ * adding or removing items at both ends is O(1) so item prepending is
+ * optimized.
+ *
+ * Inserting or removing items invalidates references to all items so these
+ * must not be kept across such calls.
  */
 class ClipboardItemList final {
 public:
     ClipboardItem &operator [](int i)
     {
-        return m_items[i];
+        return m_items[static_cast<size_t>(i)];
     }
 
     const ClipboardItem &operator [](int i) const
     {
-        return m_items[i];
+        return m_items[static_cast<size_t>(i)];
     }
 
     void insert(int row, const ClipboardItem &item)
     {
-        m_items.insert(row, item);
+        m_items.insert(iteratorAt(row), item);
+    }
+
+    /// Insert @a count empty items at @a row.
+    void insert(int row, int count)
+    {
+        m_items.insert( iteratorAt(row), static_cast<size_t>(count), ClipboardItem() );
     }
 
+    /// Insert new items with given data at @a row.
+    void insert(int row, const QVector<QVariantMap> &dataList);
+
     void remove(int row, int count)
     {
-        const QList<ClipboardItem>::iterator from = m_items.begin() + row;
-        const QList<ClipboardItem>::iterator to = from + count;
-        m_items.erase(from, to);
+        const auto from = iteratorAt(row);
+        m_items.erase(from, from + count);
     }
 
     int size() const
     {
-        return m_items.size();
+        return static_cast<int>( m_items.size() );
     }
 
     void move(int from, int to)
     {
-        const ClipboardItem item = m_items[from];
-        m_items.removeAt(from);
-        m_items.insert(to, item);
+        if (from == to)
+            return;
+
+        if (from < to)
+            move(from, 1, to + 1);
+        else
+            move(from, 1, to);
     }
 
     void move(int from, int count, int to);
 
-    void reserve(int maxItems)
-    {
-        m_items.reserve(maxItems);
-    }
-
-    void resize(int size)
+private:
+    std::deque<ClipboardItem>::iterator iteratorAt(int row)
     {
-        if (size < this->size())
-            remove(size, this->size());
-
-        while (size > this->size())
-            m_items.append(ClipboardItem());
+        return m_items.begin() + row;
     }
 
-private:
-    QList<ClipboardItem> m_items;
+    std::deque<ClipboardItem> m_items;
 };
 
 /**
@@ -102,6 +114,8 @@ public:
 
     explicit ClipboardModel(QObject *parent = nullptr);
 
+    ~ClipboardModel();
+
     /** Return number of items in model. */
     int rowCount(const QModelIndex &parent = QModelIndex()) const override;
 
@@ -123,7 +137,15 @@ public:
     /** insert new item to model. */
     void insertItem(const QVariantMap &data, int row);
 
-    void insertItems(const QList<QVariantMap> &dataList, int row);
+    /** Insert new items to model (emits single rowsInserted() signal). */
+    void insertItems(const QVector<QVariantMap> &dataList, int row);
+
+    /**
+     * Return copies of all items.
+     *
+     * This is cheap since item data are implicitly shared.
+     */
+    QList<ClipboardItem> items() const;
 
     /**
      * Sort items in ascending order.
@@ -132,12 +154,42 @@ public:
 
     /**
      * Find item with given @a hash.
+     *
+     * Uses index of item hashes which is built on first call and kept
+     * up to date afterwards.
+     *
      * @return Row number with found item or -1 if no item was found.
      */
-    int findItem(uint itemHash) const;
+    int findItem(quint64 itemHash) const;
 
 private:
+    struct HashIndexEntry {
+        /// Number of items with the hash.
+        int count = 0;
+        /**
+         * Top-most row of an item with the hash, counted from the bottom
+         * so that prepending items doesn't change it (see hashIndexPosition()).
+         */
+        int position = 0;
+    };
+
+    int hashIndexPosition(int row) const;
+    int rowFromHashIndexPosition(int position) const;
+
+    void rebuildHashIndex() const;
+    void updateHashIndex(int first, int last) const;
+    void addToHashIndex(int first, int last);
+    void removeFromHashIndex(int first, int last);
+    void removeFromHashIndex(quint64 itemHash);
+    void hashIndexRowsInserted(int first, int last);
+    void hashIndexRowsRemoved(int first, int last);
+
     ClipboardItemList m_clipboardList;
+
+    mutable QHash<quint64, HashIndexEntry> m_hashIndex;
+    mutable bool m_hashIndexValid = false;
+    /// Changed when removing or appending items at the bottom.
+    mutable int m_hashIndexBottomOffset = 0;
 };
 
 #endif // CLIPBOARDMODEL_H
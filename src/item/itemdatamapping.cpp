@@ -0,0 +1,104 @@
+/*
+    Copyright (c) 2019, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "itemdatamapping.h"
+
+#include "common/log.h"
+
+#include <QMutex>
+#include <QMutexLocker>
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+namespace {
+
+/// Mappings can be created and looked up from multiple threads.
+QMutex mappingsMutex;
+
+std::vector<std::weak_ptr<ItemDataMapping>> &mappings()
+{
+    static std::vector<std::weak_ptr<ItemDataMapping>> mappings;
+    return mappings;
+}
+
+} // namespace
+
+ItemDataMappingPtr ItemDataMapping::map(const QString &fileName)
+{
+    ItemDataMappingPtr mapping( new ItemDataMapping(fileName) );
+    if ( mapping->m_bytes.isEmpty() )
+        return nullptr;
+
+    QMutexLocker lock(&mappingsMutex);
+    auto &allMappings = mappings();
+    allMappings.erase(
+        std::remove_if( std::begin(allMappings), std::end(allMappings),
+            [](const std::weak_ptr<ItemDataMapping> &m) { return m.expired(); } ),
+        std::end(allMappings) );
+    allMappings.push_back(mapping);
+
+    return mapping;
+}
+
+ItemDataMappingPtr ItemDataMapping::find(const QByteArray &bytes)
+{
+    if ( bytes.isEmpty() )
+        return nullptr;
+
+    QMutexLocker lock(&mappingsMutex);
+    for (const auto &m : mappings()) {
+        auto mapping = m.lock();
+        if ( mapping && mapping->contains(bytes) )
+            return mapping;
+    }
+
+    return nullptr;
+}
+
+bool ItemDataMapping::contains(const QByteArray &bytes) const
+{
+    const char *begin = m_bytes.constData();
+    const char *end = begin + m_bytes.size();
+    return begin <= bytes.constData() && bytes.constData() < end;
+}
+
+ItemDataMapping::ItemDataMapping(const QString &fileName)
+    : m_file(fileName)
+{
+    if ( !m_file.open(QIODevice::ReadOnly) ) {
+        log( QString("Failed to open file for mapping \"%1\": %2")
+             .arg(fileName, m_file.errorString()), LogWarning );
+        return;
+    }
+
+    const qint64 size = m_file.size();
+    if ( size <= 0 || size > std::numeric_limits<int>::max() )
+        return;
+
+    const uchar *data = m_file.map(0, size);
+    if (!data) {
+        log( QString("Failed to map file \"%1\": %2")
+             .arg(fileName, m_file.errorString()), LogWarning );
+        return;
+    }
+
+    m_bytes = QByteArray::fromRawData( reinterpret_cast<const char*>(data), static_cast<int>(size) );
+}
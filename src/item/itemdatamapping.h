@@ -0,0 +1,61 @@
+/*
+    Copyright (c) 2019, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef ITEMDATAMAPPING_H
+#define ITEMDATAMAPPING_H
+
+#include <QByteArray>
+#include <QFile>
+
+#include <memory>
+
+class ItemDataMapping;
+using ItemDataMappingPtr = std::shared_ptr<ItemDataMapping>;
+
+/**
+ * Tab file mapped to memory.
+ *
+ * Item data can reference bytes in the mapped file instead of keeping a copy
+ * (see QByteArray::fromRawData()). Such data must not outlive the mapping.
+ */
+class ItemDataMapping final
+{
+public:
+    /// Maps whole file to memory; returns nullptr on failure.
+    static ItemDataMappingPtr map(const QString &fileName);
+
+    /// Returns mapping containing the bytes (nullptr if bytes are not mapped).
+    static ItemDataMappingPtr find(const QByteArray &bytes);
+
+    /// Returns mapped file content (not copied).
+    const QByteArray &bytes() const { return m_bytes; }
+
+    /// Returns true only if bytes reference mapped memory.
+    bool contains(const QByteArray &bytes) const;
+
+    ItemDataMapping(const ItemDataMapping &) = delete;
+    ItemDataMapping &operator=(const ItemDataMapping &) = delete;
+
+private:
+    explicit ItemDataMapping(const QString &fileName);
+
+    QFile m_file;
+    QByteArray m_bytes;
+};
+
+#endif // ITEMDATAMAPPING_H
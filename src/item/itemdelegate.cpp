@@ -21,6 +21,7 @@
 
 #include "common/client_server.h"
 #include "common/contenttype.h"
+#include "common/log.h"
 #include "common/mimetypes.h"
 #include "common/sanitize_text_document.h"
 #include "common/textdata.h"
@@ -41,6 +42,17 @@ namespace {
 
 const char propertySelectedItem[] = "CopyQ_selected";
 
+/// Memory limit for all item snapshots.
+const qint64 maxSnapshotBytes = 32 * 1024 * 1024;
+
+/// Large items are not snapshotted (widget is re-created if needed).
+const qint64 maxItemSnapshotBytes = maxSnapshotBytes / 8;
+
+qint64 pixmapBytes(const QPixmap &pixmap)
+{
+    return static_cast<qint64>(pixmap.width()) * pixmap.height() * pixmap.depth() / 8;
+}
+
 } // namespace
 
 ItemDelegate::ItemDelegate(ClipboardBrowser *view, const ClipboardBrowserSharedPtr &sharedData, QWidget *parent)
@@ -60,13 +72,13 @@ QSize ItemDelegate::sizeHint(const QModelIndex &index) const
 {
     const int row = index.row();
     if ( static_cast<size_t>(row) < m_cache.size() ) {
-        const ItemWidget *w = cacheOrNull(row);
-        if (w != nullptr) {
-            QWidget *ww = w->widget();
+        const Item &item = m_cache[static_cast<size_t>(row)];
+        const QSize size = item.widget ? item.widget->widget()->size() : item.size;
+        if ( size.isValid() ) {
             const auto margins = m_sharedData->theme.margins();
             const auto rowNumberSize = m_sharedData->theme.rowNumberSize();
-            return QSize( ww->width() + 2 * margins.width() + rowNumberSize.width(),
-                          qMax(ww->height() + 2 * margins.height(), rowNumberSize.height()) );
+            return QSize( size.width() + 2 * margins.width() + rowNumberSize.width(),
+                          qMax(size.height() + 2 * margins.height(), rowNumberSize.height()) );
         }
     }
     return QSize(0, 100);
@@ -97,8 +109,9 @@ void ItemDelegate::dataChanged(const QModelIndex &a, const QModelIndex &b)
 {
     for ( int row = a.row(); row <= b.row(); ++row ) {
         auto item = &m_cache[row];
-        if (*item) {
-            item->reset();
+        clearSnapshot(item);
+        if (item->widget) {
+            item->widget.reset();
             cache( m_view->index(row) );
         }
     }
@@ -106,6 +119,9 @@ void ItemDelegate::dataChanged(const QModelIndex &a, const QModelIndex &b)
 
 void ItemDelegate::rowsRemoved(const QModelIndex &, int start, int end)
 {
+    for (int row = start; row <= end; ++row)
+        clearSnapshot(&m_cache[row]);
+
     m_cache.erase(std::begin(m_cache) + start, std::begin(m_cache) + end + 1);
 }
 
@@ -130,6 +146,12 @@ void ItemDelegate::rowsMoved(const QModelIndex &, int sourceStart, int sourceEnd
 
 bool ItemDelegate::showAt(const QModelIndex &index, QPoint pos)
 {
+    const int row = index.row();
+    if ( canPaintSnapshot(row) ) {
+        m_cache[row].snapshotUsed = ++m_snapshotCounter;
+        return false;
+    }
+
     auto w = cache(index);
     auto ww = w->widget();
     ww->move(pos);
@@ -178,6 +200,7 @@ ItemWidget *ItemDelegate::cache(const QModelIndex &index)
     if (w == nullptr) {
         auto data = m_view->itemData(index);
         data.insert(mimeCurrentTab, m_view->tabName());
+        data.insert(mimeItemHash, index.data(contentType::hash));
         w = updateCache(index, data);
         emit itemWidgetCreated(PersistentDisplayItem(this, data, w->widget()));
     }
@@ -191,13 +214,17 @@ void ItemDelegate::updateCache(QObject *widget, const QVariantMap &data)
     if (row == -1)
         return;
 
+    // Data from display commands can differ from item data.
+    QVariantMap displayData = data;
+    displayData.remove(mimeItemHash);
+
     const auto index = m_view->index(row);
-    updateCache(index, data);
+    updateCache(index, displayData);
 }
 
 ItemWidget *ItemDelegate::cacheOrNull(int row) const
 {
-    return m_cache[static_cast<size_t>(row)].get();
+    return m_cache[static_cast<size_t>(row)].widget.get();
 }
 
 void ItemDelegate::setItemSizes(QSize size, int idealWidth)
@@ -205,13 +232,18 @@ void ItemDelegate::setItemSizes(QSize size, int idealWidth)
     const auto margins = m_sharedData->theme.margins();
     const auto rowNumberSize = m_sharedData->theme.rowNumberSize();
     const int margin = 2 * margins.width() + rowNumberSize.width() + m_view->spacing();
+    const int oldMaxWidth = m_maxSize.width();
+    const int oldIdealWidth = m_idealWidth;
     m_maxSize.setWidth(size.width() - margin);
     m_idealWidth = idealWidth - margin;
 
+    if (oldMaxWidth != m_maxSize.width() || oldIdealWidth != m_idealWidth)
+        clearSnapshots();
+
     if (m_idealWidth > 0) {
-        for (auto &w : m_cache) {
-            if (w != nullptr)
-                w->updateSize(m_maxSize, m_idealWidth);
+        for (auto &item : m_cache) {
+            if (item.widget != nullptr)
+                item.widget->updateSize(m_maxSize, m_idealWidth);
         }
     }
 }
@@ -314,6 +346,8 @@ void ItemDelegate::setItemWidgetCurrent(const QModelIndex &index, bool isCurrent
 void ItemDelegate::setItemWidgetSelected(const QModelIndex &index, bool isSelected)
 {
     const int row = index.row();
+    clearSnapshot(&m_cache[row]);
+
     auto w = cacheOrNull(row);
     if (!w)
         return;
@@ -327,10 +361,15 @@ void ItemDelegate::setIndexWidget(const QModelIndex &index, ItemWidget *w)
     const QSize oldSize = sizeHint(index);
 
     const int row = index.row();
-    m_cache[row].reset(w);
+    Item &item = m_cache[row];
+    if (item.widget)
+        item.size = item.widget->widget()->size();
+    item.widget.reset(w);
     if (w == nullptr)
         return;
 
+    clearSnapshot(&item);
+
     QWidget *ww = w->widget();
 
     // Make background transparent.
@@ -404,9 +443,94 @@ bool ItemDelegate::invalidateHidden(QWidget *widget)
 
 void ItemDelegate::setSearch(const QRegExp &re)
 {
+    if (m_re != re)
+        clearSnapshots();
+
     m_re = re;
 }
 
+void ItemDelegate::hideItemWidget(int row)
+{
+    Item &item = m_cache[row];
+    if (!item.widget)
+        return;
+
+    QWidget *ww = item.widget->widget();
+    ww->hide();
+
+    if ( !m_sharedData->paintItemsFromSnapshots || m_view->currentIndex().row() == row )
+        return;
+
+    takeSnapshot(&item);
+    if ( !item.snapshot.isNull() )
+        COPYQ_LOG( QString("Item %1: Painting from snapshot").arg(row) );
+
+    setIndexWidget( m_view->index(row), nullptr );
+}
+
+bool ItemDelegate::canPaintSnapshot(int row) const
+{
+    const Item &item = m_cache[static_cast<size_t>(row)];
+    return m_sharedData->paintItemsFromSnapshots
+        && !item.widget
+        && !item.snapshot.isNull()
+        && m_view->currentIndex().row() != row;
+}
+
+void ItemDelegate::takeSnapshot(Item *item)
+{
+    clearSnapshot(item);
+
+    const QPixmap snapshot = item->widget->widget()->grab();
+    const qint64 bytes = pixmapBytes(snapshot);
+    if (bytes > maxItemSnapshotBytes)
+        return;
+
+    item->snapshot = snapshot;
+    item->snapshotUsed = ++m_snapshotCounter;
+    m_snapshotBytes += bytes;
+
+    releaseSnapshots();
+}
+
+void ItemDelegate::clearSnapshot(Item *item)
+{
+    if ( item->snapshot.isNull() )
+        return;
+
+    m_snapshotBytes -= pixmapBytes(item->snapshot);
+    item->snapshot = QPixmap();
+}
+
+void ItemDelegate::clearSnapshots()
+{
+    for (auto &item : m_cache)
+        clearSnapshot(&item);
+}
+
+void ItemDelegate::releaseSnapshots()
+{
+    if (m_snapshotBytes <= maxSnapshotBytes)
+        return;
+
+    std::vector<Item*> items;
+    for (auto &item : m_cache) {
+        if ( !item.snapshot.isNull() )
+            items.push_back(&item);
+    }
+
+    std::sort( std::begin(items), std::end(items), [](const Item *lhs, const Item *rhs) {
+        return lhs->snapshotUsed < rhs->snapshotUsed;
+    });
+
+    // Release more than needed so this doesn't happen with each new snapshot.
+    for (auto item : items) {
+        if (m_snapshotBytes <= maxSnapshotBytes * 3 / 4)
+            break;
+        clearSnapshot(item);
+    }
+}
+
 void ItemDelegate::paint(QPainter *painter, const QStyleOptionViewItem &option,
                          const QModelIndex &index) const
 {
@@ -420,7 +544,8 @@ void ItemDelegate::paint(QPainter *painter, const QStyleOptionViewItem &option,
 
     const int row = index.row();
     auto w = cacheOrNull(row);
-    if (w == nullptr)
+    const QPixmap &snapshot = m_cache[static_cast<size_t>(row)].snapshot;
+    if ( w == nullptr && (snapshot.isNull() || !m_sharedData->paintItemsFromSnapshots) )
         return;
 
     // Colorize item.
@@ -450,4 +575,12 @@ void ItemDelegate::paint(QPainter *painter, const QStyleOptionViewItem &option,
                             role);
         painter->restore();
     }
+
+    // Render item snapshot instead of widget.
+    if (w == nullptr) {
+        const int s = m_view->spacing();
+        const auto rowNumberSize = m_sharedData->theme.rowNumberSize();
+        const auto padding = QPoint(rowNumberSize.width() + margins.width() - s, margins.height() - s);
+        painter->drawPixmap(rect.topLeft() + padding, snapshot);
+    }
 }
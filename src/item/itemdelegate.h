@@ -23,6 +23,7 @@
 #include "gui/clipboardbrowsershared.h"
 
 #include <QItemDelegate>
+#include <QPixmap>
 #include <QRegExp>
 
 #include <memory>
@@ -45,6 +46,12 @@ class PersistentDisplayItem;
  *
  * Before calling paint() for an index item on given index must be cached
  * using cache().
+ *
+ * If enabled (ClipboardBrowserShared::paintItemsFromSnapshots), item widgets
+ * scrolled out of view are rendered to pixmap snapshots and released. Items
+ * with a snapshot are painted by the delegate and a widget is created only
+ * for current item. This keeps number of widgets limited to visible items
+ * and memory used by snapshots is limited too.
  */
 class ItemDelegate final : public QItemDelegate
 {
@@ -65,6 +72,13 @@ class ItemDelegate final : public QItemDelegate
         /** Remove item widget if not currently visible and return true if removed. */
         bool invalidateHidden(QWidget *widget);
 
+        /**
+         * Hide item widget scrolled out of view.
+         *
+         * If painting items from snapshots, the widget is replaced with snapshot.
+         */
+        void hideItemWidget(int row);
+
         /** Set regular expression for highlighting. */
         void setSearch(const QRegExp &re);
 
@@ -128,8 +142,28 @@ class ItemDelegate final : public QItemDelegate
                    const QModelIndex &index) const override;
 
     private:
+        struct Item {
+            std::shared_ptr<ItemWidget> widget;
+            /// Rendered item widget to paint if the widget was released.
+            QPixmap snapshot;
+            /// Last known size of item widget.
+            QSize size;
+            /// Value of m_snapshotCounter when snapshot was last used.
+            qint64 snapshotUsed = 0;
+        };
+
         void setIndexWidget(const QModelIndex &index, ItemWidget *w);
 
+        /** Return true if item can be painted from snapshot without creating widget. */
+        bool canPaintSnapshot(int row) const;
+
+        void takeSnapshot(Item *item);
+        void clearSnapshot(Item *item);
+        void clearSnapshots();
+
+        /** Remove least recently used snapshots if these take too much memory. */
+        void releaseSnapshots();
+
         void setWidgetCurrent(QWidget *ww, bool isCurrent);
 
         /// Updates style for selected/unselected widgets.
@@ -145,7 +179,10 @@ class ItemDelegate final : public QItemDelegate
         QSize m_maxSize;
         int m_idealWidth;
 
-        std::vector<std::shared_ptr<ItemWidget>> m_cache;
+        std::vector<Item> m_cache;
+
+        qint64 m_snapshotBytes = 0;
+        qint64 m_snapshotCounter = 0;
 };
 
 #endif // ITEMDELEGATE_H
@@ -26,13 +26,17 @@
 #include "common/log.h"
 #include "common/mimetypes.h"
 #include "common/textdata.h"
+#include "item/itemdatamapping.h"
 #include "item/itemstore.h"
 #include "item/itemwidget.h"
 #include "item/serialize.h"
 #include "platform/platformnativeinterface.h"
 
+#include <QAbstractItemModel>
 #include <QCoreApplication>
+#include <QDataStream>
 #include <QDir>
+#include <QFile>
 #include <QIODevice>
 #include <QLabel>
 #include <QMetaObject>
@@ -162,15 +166,78 @@ private:
     QString m_imageFormat;
 };
 
-class DummySaver final : public ItemSaverInterface
+class DummySaver final : public QObject, public ItemSaverInterface
 {
 public:
+    explicit DummySaver(QAbstractItemModel *model)
+    {
+        connect( model, &QAbstractItemModel::rowsInserted, this,
+                 [this, model](const QModelIndex &, int first, int last) {
+                     serializeItemsInserted(*model, first, last, &changesStream());
+                 } );
+        connect( model, &QAbstractItemModel::rowsRemoved, this,
+                 [this](const QModelIndex &, int first, int last) {
+                     serializeItemsRemoved(first, last, &changesStream());
+                 } );
+        connect( model, &QAbstractItemModel::rowsMoved, this,
+                 [this](const QModelIndex &, int first, int last, const QModelIndex &, int destinationRow) {
+                     serializeItemsMoved(first, last, destinationRow, &changesStream());
+                 } );
+        connect( model, &QAbstractItemModel::dataChanged, this,
+                 [this, model](const QModelIndex &topLeft, const QModelIndex &bottomRight) {
+                     serializeItemsChanged(*model, topLeft.row(), bottomRight.row(), &changesStream());
+                 } );
+        connect( model, &QAbstractItemModel::layoutChanged, this, [this]() { m_changesValid = false; } );
+        connect( model, &QAbstractItemModel::modelReset, this, [this]() { m_changesValid = false; } );
+    }
+
     bool saveItems(const QString & /* tabName */, const QAbstractItemModel &model, QIODevice *file) override
     {
         return serializeData(model, file);
     }
+
+    bool saveChanges(const QString & /* tabName */, const QAbstractItemModel &, QIODevice *journal) override
+    {
+        const bool changesValid = m_changesValid;
+        const QByteArray changes = m_changes;
+        m_changes.clear();
+        m_changesStream.reset();
+        m_changesValid = true;
+
+        return changesValid && journal->write(changes) == changes.size();
+    }
+
+private:
+    QDataStream &changesStream()
+    {
+        if (!m_changesStream) {
+            m_changesStream.reset( new QDataStream(&m_changes, QIODevice::Append) );
+            m_changesStream->setVersion(QDataStream::Qt_4_7);
+        }
+        return *m_changesStream;
+    }
+
+    QByteArray m_changes;
+    std::unique_ptr<QDataStream> m_changesStream;
+    bool m_changesValid = true;
 };
 
+bool deserializeItems(QAbstractItemModel *model, QIODevice *file, int maxItems)
+{
+    // Mapped file cannot be removed on Windows (tab file is replaced on save).
+#ifndef Q_OS_WIN
+    // Items keep the mapping alive while they reference its data.
+    const auto tabFile = qobject_cast<QFile*>(file);
+    if (tabFile) {
+        const auto mapping = ItemDataMapping::map( tabFile->fileName() );
+        if (mapping)
+            return deserializeMappedData(model, mapping->bytes(), maxItems);
+    }
+#endif
+
+    return deserializeData(model, file, maxItems);
+}
+
 class DummyLoader final : public ItemLoaderInterface
 {
 public:
@@ -191,18 +258,18 @@ public:
     ItemSaverPtr loadItems(const QString &, QAbstractItemModel *model, QIODevice *file, int maxItems) override
     {
         if ( file->size() > 0 ) {
-            if ( !deserializeData(model, file, maxItems) ) {
+            if ( !deserializeItems(model, file, maxItems) ) {
                 model->removeRows(0, model->rowCount());
                 return nullptr;
             }
         }
 
-        return std::make_shared<DummySaver>();
+        return std::make_shared<DummySaver>(model);
     }
 
-    ItemSaverPtr initializeTab(const QString &, QAbstractItemModel *, int) override
+    ItemSaverPtr initializeTab(const QString &, QAbstractItemModel *model, int) override
     {
-        return std::make_shared<DummySaver>();
+        return std::make_shared<DummySaver>(model);
     }
 
     bool matches(const QModelIndex &index, const QRegExp &re) const override
@@ -406,6 +473,16 @@ ItemSaverPtr ItemFactory::initializeTab(const QString &tabName, QAbstractItemMod
     return nullptr;
 }
 
+bool ItemFactory::canSaveItems(const QString &tabName) const
+{
+    for ( const auto &loader : m_loaders ) {
+        if ( isLoaderEnabled(loader) && loader->canSaveItems(tabName) )
+            return true;
+    }
+
+    return false;
+}
+
 bool ItemFactory::matches(const QModelIndex &index, const QRegExp &re) const
 {
     // Match formats if the filter expression contains single '/'.
@@ -120,6 +120,12 @@ public:
      */
     ItemSaverPtr initializeTab(const QString &tabName, QAbstractItemModel *model, int maxItems);
 
+    /**
+     * Return true only if any enabled plugin saves items in the tab
+     * (ItemLoaderInterface::canSaveItems() returns true).
+     */
+    bool canSaveItems(const QString &tabName) const;
+
     /**
      * Return true only if any plugin (ItemLoaderInterface::matches()) returns true;
      */
@@ -0,0 +1,303 @@
+/*
+    Copyright (c) 2019, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "itemsearchindex.h"
+
+#include "common/contenttype.h"
+
+#include <QAbstractItemModel>
+#include <QRegExp>
+#include <QSet>
+#include <QStringList>
+
+#include <algorithm>
+#include <iterator>
+
+namespace {
+
+/// Longer text is not indexed (such items always need to be checked).
+const int maxIndexedTextLength = 64 * 1024;
+
+/// Index is rebuilt if there are more removed than indexed items.
+const int minRemovedCountToRebuild = 1000;
+
+/// Folds case same way as QRegExp with Qt::CaseInsensitive.
+QString foldCase(const QString &text)
+{
+    QString result = text;
+    for (auto &c : result)
+        c = c.toLower();
+    return result;
+}
+
+quint64 trigram(const QString &text, int i)
+{
+    return (static_cast<quint64>(text[i].unicode()) << 32)
+         | (static_cast<quint64>(text[i + 1].unicode()) << 16)
+         | static_cast<quint64>(text[i + 2].unicode());
+}
+
+/**
+ * Find text which must be in any match.
+ *
+ * Only simple expressions are supported (e.g. words separated with ".*").
+ *
+ * @return false if expression is not supported
+ */
+bool requiredFragments(const QRegExp &re, QStringList *fragments)
+{
+    const QString pattern = re.pattern();
+    const auto syntax = re.patternSyntax();
+    if (syntax == QRegExp::FixedString) {
+        fragments->append(pattern);
+        return pattern.size() >= 3;
+    }
+
+    if (syntax != QRegExp::RegExp && syntax != QRegExp::RegExp2)
+        return false;
+
+    QString fragment;
+    const auto endFragment = [&]() {
+        if (fragment.size() >= 3)
+            fragments->append(fragment);
+        fragment.clear();
+    };
+
+    for (int i = 0; i < pattern.size(); ++i) {
+        const QChar c = pattern[i];
+        if (c == '\\') {
+            ++i;
+            // Character classes, back-references and character codes are not supported.
+            if ( i == pattern.size() || pattern[i].isLetterOrNumber() )
+                return false;
+            fragment.append(pattern[i]);
+        } else if (c == '*' || c == '?') {
+            // Previous character is optional.
+            fragment.chop(1);
+            endFragment();
+        } else if (c == '.' || c == '+' || c == '^' || c == '$') {
+            endFragment();
+        } else if ( QString("()[]{}|").contains(c) ) {
+            return false;
+        } else {
+            fragment.append(c);
+        }
+    }
+
+    endFragment();
+
+    return !fragments->isEmpty();
+}
+
+} // namespace
+
+ItemSearchIndex::ItemSearchIndex(QAbstractItemModel *model)
+    : m_model(model)
+{
+    connect( model, &QAbstractItemModel::rowsInserted, this,
+             [this](const QModelIndex &, int first, int last) { insertRows(first, last); } );
+    connect( model, &QAbstractItemModel::rowsRemoved, this,
+             [this](const QModelIndex &, int first, int last) { removeRows(first, last); } );
+    connect( model, &QAbstractItemModel::rowsMoved, this,
+             [this](const QModelIndex &, int first, int last, const QModelIndex &, int destinationRow) {
+                 moveRows(first, last, destinationRow);
+             } );
+    connect( model, &QAbstractItemModel::dataChanged, this,
+             [this](const QModelIndex &topLeft, const QModelIndex &bottomRight) {
+                 updateRows(topLeft.row(), bottomRight.row());
+             } );
+    connect( model, &QAbstractItemModel::layoutChanged, this, [this]() { invalidate(); } );
+    connect( model, &QAbstractItemModel::modelReset, this, [this]() { invalidate(); } );
+}
+
+void ItemSearchIndex::invalidate()
+{
+    m_valid = false;
+    m_rowIds.clear();
+    m_removedIds.clear();
+    m_removedCount = 0;
+    m_unindexedIds.clear();
+    m_trigramIds.clear();
+}
+
+bool ItemSearchIndex::findCandidates(const QRegExp &re, QVector<bool> *candidateRows)
+{
+    QStringList fragments;
+    if ( !requiredFragments(re, &fragments) )
+        return false;
+
+    if ( !m_valid || m_rowIds.size() != m_model->rowCount() )
+        build();
+
+    // Items containing all trigrams from all fragments.
+    QVector<const QVector<int>*> idLists;
+    bool missingTrigram = false;
+    for (const auto &fragment : fragments) {
+        const QString text = foldCase(fragment);
+        for (int i = 0; i + 2 < text.size(); ++i) {
+            const auto it = m_trigramIds.constFind( trigram(text, i) );
+            if ( it == m_trigramIds.constEnd() ) {
+                missingTrigram = true;
+                break;
+            }
+            idLists.append( &it.value() );
+        }
+    }
+
+    QVector<int> ids;
+    if (!missingTrigram) {
+        std::sort( std::begin(idLists), std::end(idLists),
+                   [](const QVector<int> *lhs, const QVector<int> *rhs) {
+                       return lhs->size() < rhs->size();
+                   } );
+
+        ids = *idLists.first();
+        for (int i = 1; i < idLists.size() && !ids.isEmpty(); ++i) {
+            const auto &otherIds = *idLists[i];
+            QVector<int> commonIds;
+            std::set_intersection(
+                        std::begin(ids), std::end(ids),
+                        std::begin(otherIds), std::end(otherIds),
+                        std::back_inserter(commonIds) );
+            ids.swap(commonIds);
+        }
+    }
+
+    QVector<bool> isCandidate(m_removedIds.size(), false);
+    for (const int id : ids)
+        isCandidate[id] = true;
+    for (const int id : m_unindexedIds)
+        isCandidate[id] = true;
+
+    candidateRows->resize( m_rowIds.size() );
+    for (int row = 0; row < m_rowIds.size(); ++row)
+        (*candidateRows)[row] = isCandidate[ m_rowIds[row] ];
+
+    return true;
+}
+
+void ItemSearchIndex::build()
+{
+    invalidate();
+
+    const int rowCount = m_model->rowCount();
+    m_rowIds.reserve(rowCount);
+    for (int row = 0; row < rowCount; ++row)
+        m_rowIds.append( addItem(row) );
+
+    m_valid = true;
+}
+
+void ItemSearchIndex::insertRows(int first, int last)
+{
+    if (!m_valid)
+        return;
+
+    if ( first > m_rowIds.size() ) {
+        invalidate();
+        return;
+    }
+
+    for (int row = first; row <= last; ++row)
+        m_rowIds.insert( row, addItem(row) );
+}
+
+void ItemSearchIndex::removeRows(int first, int last)
+{
+    if (!m_valid)
+        return;
+
+    if ( last >= m_rowIds.size() ) {
+        invalidate();
+        return;
+    }
+
+    for (int row = first; row <= last; ++row)
+        removeItem( m_rowIds[row] );
+    m_rowIds.remove(first, last - first + 1);
+
+    if ( m_removedCount > qMax(minRemovedCountToRebuild, m_rowIds.size()) )
+        invalidate();
+}
+
+void ItemSearchIndex::moveRows(int first, int last, int destinationRow)
+{
+    if (!m_valid)
+        return;
+
+    if ( last >= m_rowIds.size() ) {
+        invalidate();
+        return;
+    }
+
+    const int count = last - first + 1;
+    const QVector<int> ids = m_rowIds.mid(first, count);
+    m_rowIds.remove(first, count);
+
+    const int row = destinationRow > last ? destinationRow - count : destinationRow;
+    for (int i = 0; i < count; ++i)
+        m_rowIds.insert(row + i, ids[i]);
+}
+
+void ItemSearchIndex::updateRows(int first, int last)
+{
+    if (!m_valid)
+        return;
+
+    if ( last >= m_rowIds.size() ) {
+        invalidate();
+        return;
+    }
+
+    for (int row = first; row <= last; ++row) {
+        removeItem( m_rowIds[row] );
+        m_rowIds[row] = addItem(row);
+    }
+
+    if ( m_removedCount > qMax(minRemovedCountToRebuild, m_rowIds.size()) )
+        invalidate();
+}
+
+int ItemSearchIndex::addItem(int row)
+{
+    const int id = m_removedIds.size();
+    m_removedIds.append(false);
+
+    const QString text = m_model->index(row, 0).data(contentType::searchText).toString();
+    if (text.size() > maxIndexedTextLength) {
+        m_unindexedIds.append(id);
+        return id;
+    }
+
+    const QString foldedText = foldCase(text);
+    QSet<quint64> trigrams;
+    for (int i = 0; i + 2 < foldedText.size(); ++i)
+        trigrams.insert( trigram(foldedText, i) );
+
+    // IDs are increasing so the lists stay sorted.
+    for (const auto &t : trigrams)
+        m_trigramIds[t].append(id);
+
+    return id;
+}
+
+void ItemSearchIndex::removeItem(int id)
+{
+    m_removedIds[id] = true;
+    ++m_removedCount;
+}
@@ -0,0 +1,76 @@
+/*
+    Copyright (c) 2019, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef ITEMSEARCHINDEX_H
+#define ITEMSEARCHINDEX_H
+
+#include <QHash>
+#include <QObject>
+#include <QVector>
+
+class QAbstractItemModel;
+class QRegExp;
+
+/**
+ * Trigram index of item text for filtering items quickly.
+ *
+ * Index is built on first search and updated when items change.
+ * It contains text from all text and internal formats and format names
+ * (see contentType::searchText).
+ */
+class ItemSearchIndex final : public QObject
+{
+public:
+    explicit ItemSearchIndex(QAbstractItemModel *model);
+
+    /// Drop index (e.g. after model was changed with signals blocked).
+    void invalidate();
+
+    /**
+     * Find rows which can match the expression.
+     *
+     * Other rows surely don't match.
+     *
+     * @return false if index cannot narrow the search (all rows can match)
+     */
+    bool findCandidates(const QRegExp &re, QVector<bool> *candidateRows);
+
+private:
+    void build();
+    void insertRows(int first, int last);
+    void removeRows(int first, int last);
+    void moveRows(int first, int last, int destinationRow);
+    void updateRows(int first, int last);
+    int addItem(int row);
+    void removeItem(int id);
+
+    QAbstractItemModel *m_model;
+    bool m_valid = false;
+
+    /// Item ID for each row.
+    QVector<int> m_rowIds;
+    /// Removed items (index is item ID).
+    QVector<bool> m_removedIds;
+    int m_removedCount = 0;
+    /// Items with text too long to index, these always match.
+    QVector<int> m_unindexedIds;
+    /// Sorted item IDs for each trigram.
+    QHash<quint64, QVector<int>> m_trigramIds;
+};
+
+#endif // ITEMSEARCHINDEX_H
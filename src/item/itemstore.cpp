@@ -23,13 +23,39 @@
 #include "common/log.h"
 #include "common/textdata.h"
 #include "item/itemfactory.h"
+#include "item/serialize.h"
 
 #include <QAbstractItemModel>
+#include <QBuffer>
+#include <QDataStream>
 #include <QDir>
 #include <QFile>
+#include <QFileInfo>
+
+#include <algorithm>
 
 namespace {
 
+const char journalHeader[] = "CopyQ_tab_journal_v1\n";
+
+const char pendingItemsHeader[] = "CopyQ_tab_pending_v1\n";
+
+enum PendingItemType {
+    PendingItemAdd = 0,
+    PendingItemAddUniqueClipboard = 1,
+    PendingItemAddUniqueSelection = 2,
+};
+
+/// Number of items in pending items file (stored after the header).
+struct PendingItemCounts {
+    qint32 items = 0;
+    /// Items added as new clipboard content can replace other items.
+    qint32 uniqueItems = 0;
+};
+
+/// Journal is merged to tab file if it becomes larger than tab file and this size.
+const qint64 minJournalSizeToCompact = 1024 * 1024;
+
 /// @return File name for data file with items.
 QString itemFileName(const QString &id)
 {
@@ -38,6 +64,16 @@ QString itemFileName(const QString &id)
     return getConfigurationFilePath("_tab_") + part + QString(".dat");
 }
 
+QString journalFileName(const QString &tabFileName)
+{
+    return tabFileName + ".journal";
+}
+
+QString pendingItemsFileName(const QString &tabFileName)
+{
+    return tabFileName + ".pending";
+}
+
 bool createItemDirectory()
 {
     QDir settingsDir( settingsDirectoryPath() );
@@ -78,6 +114,302 @@ ItemSaverPtr loadItems(
     return itemFactory->loadItems(tabName, &model, &tabFile, maxItems);
 }
 
+/**
+ * Loads items from a copy of file content.
+ *
+ * Items must not reference data in a file which is overwritten on next save
+ * (mapped data would become invalid, see ItemDataMapping).
+ */
+ItemSaverPtr loadItemsUnmapped(
+        const QString &tabName, const QString &fileName,
+        QAbstractItemModel &model, ItemFactory *itemFactory, int maxItems)
+{
+    COPYQ_LOG( QString("Tab \"%1\": Loading items").arg(tabName) );
+
+    QFile file(fileName);
+    if ( !file.open(QIODevice::ReadOnly) ) {
+        printItemFileError("load tab", tabName, file);
+        return nullptr;
+    }
+
+    QBuffer buffer;
+    buffer.setData( file.readAll() );
+    if ( file.error() != QFileDevice::NoError ) {
+        printItemFileError("load tab (read file)", tabName, file);
+        return nullptr;
+    }
+    file.close();
+
+    buffer.open(QIODevice::ReadOnly);
+    return itemFactory->loadItems(tabName, &model, &buffer, maxItems);
+}
+
+/// Reads changes saved after tab file was written (empty if there are none).
+QByteArray readJournal(const QString &tabName, const QString &tabFileName)
+{
+    QFile journalFile( journalFileName(tabFileName) );
+    if ( !journalFile.exists() )
+        return QByteArray();
+
+    if ( !journalFile.open(QIODevice::ReadOnly) ) {
+        printItemFileError("load tab (open journal)", tabName, journalFile);
+        return QByteArray();
+    }
+
+    const QByteArray header(journalHeader);
+    if ( journalFile.read(header.size()) != header ) {
+        log( QString("Tab \"%1\": Ignoring journal with unknown format").arg(tabName), LogWarning );
+        return QByteArray();
+    }
+
+    return journalFile.readAll();
+}
+
+/// Applies changes from journal to items loaded from tab file.
+void replayJournal(const QString &tabName, const QByteArray &journal, QAbstractItemModel *model)
+{
+    COPYQ_LOG( QString("Tab \"%1\": Applying changes from journal").arg(tabName) );
+
+    // Plugins must not react to replayed changes (e.g. moving pinned items),
+    // these reactions are already recorded in the journal.
+    const bool wasBlocked = model->blockSignals(true);
+    QDataStream stream(journal);
+    stream.setVersion(QDataStream::Qt_4_7);
+    const bool ok = deserializeChanges(model, &stream);
+    model->blockSignals(wasBlocked);
+
+    if (!ok)
+        log( QString("Tab \"%1\": Some changes from journal were not applied").arg(tabName), LogWarning );
+}
+
+/// Starts new journal after all items were saved.
+void createJournal(const QString &tabName, const QString &tabFileName, const QAbstractItemModel &model, const ItemSaverPtr &saver)
+{
+    QFile journalFile( journalFileName(tabFileName) );
+
+    // This also drops changes recorded by saver before the tab file was written.
+    QBuffer changes;
+    changes.open(QIODevice::WriteOnly);
+    if ( !saver->saveChanges(tabName, model, &changes) )
+        return;
+
+    if ( !journalFile.open(QIODevice::WriteOnly)
+         || journalFile.write(journalHeader) == -1
+         || !journalFile.flush() )
+    {
+        printItemFileError("save tab (create journal)", tabName, journalFile);
+        journalFile.remove();
+    }
+}
+
+/// Appends changes to journal instead of saving all items.
+bool saveChanges(const QString &tabName, const QString &tabFileName, const QAbstractItemModel &model, const ItemSaverPtr &saver)
+{
+    const QFileInfo tabFileInfo(tabFileName);
+    if ( !tabFileInfo.exists() )
+        return false;
+
+    QFile journalFile( journalFileName(tabFileName) );
+    if ( !journalFile.exists() )
+        return false;
+
+    if ( journalFile.size() > qMax(tabFileInfo.size(), minJournalSizeToCompact) ) {
+        COPYQ_LOG( QString("Tab \"%1\": Compacting journal").arg(tabName) );
+        return false;
+    }
+
+    QBuffer changes;
+    changes.open(QIODevice::WriteOnly);
+    if ( !saver->saveChanges(tabName, model, &changes) )
+        return false;
+
+    if ( changes.data().isEmpty() )
+        return true;
+
+    if ( !journalFile.open(QIODevice::Append)
+         || journalFile.write(changes.data()) != changes.data().size()
+         || !journalFile.flush() )
+    {
+        printItemFileError("save tab (append to journal)", tabName, journalFile);
+        // Journal may end with incomplete record, so remove it and let caller save all items.
+        journalFile.close();
+        journalFile.remove();
+        return false;
+    }
+
+    return true;
+}
+
+bool saveAllItems(const QString &tabName, const QString &tabFileName, const QAbstractItemModel &model, const ItemSaverPtr &saver)
+{
+    // Plugin replaces tab file itself once items are saved.
+    if ( saver->saveItemsInBackground(tabName, model, tabFileName) ) {
+        // Journal with changes to the old tab file is not updated in background.
+        QFile::remove( journalFileName(tabFileName) );
+        COPYQ_LOG( QString("Tab \"%1\": Saving %2 items in background").arg(tabName).arg(model.rowCount()) );
+        return true;
+    }
+
+    // Save to temp file.
+    QFile tmpFile( tabFileName + ".tmp" );
+    if ( !tmpFile.open(QIODevice::WriteOnly) ) {
+        printItemFileError("save tab (open temporary file)", tabName, tmpFile);
+        return false;
+    }
+
+    COPYQ_LOG( QString("Tab \"%1\": Saving %2 items").arg(tabName).arg(model.rowCount()) );
+
+    if ( !saver->saveItems(tabName, model, &tmpFile) ) {
+        printItemFileError("save tab (save items to temporary file)", tabName, tmpFile);
+        return false;
+    }
+
+    // 1. Safely flush all data to temporary file.
+    if ( !tmpFile.flush() ) {
+        printItemFileError("save tab (flush temporary file)", tabName, tmpFile);
+        return false;
+    }
+
+    // 2. Remove old tab file.
+    {
+        QFile oldTabFile(tabFileName);
+        if (oldTabFile.exists() && !oldTabFile.remove()) {
+            printItemFileError("save tab (remove file)", tabName, oldTabFile);
+            return false;
+        }
+    }
+
+    // 3. Remove journal with changes to the old tab file.
+    {
+        QFile journalFile( journalFileName(tabFileName) );
+        if (journalFile.exists() && !journalFile.remove()) {
+            printItemFileError("save tab (remove journal)", tabName, journalFile);
+            return false;
+        }
+    }
+
+    // 4. Overwrite previous file.
+    if ( !tmpFile.rename(tabFileName) ) {
+        printItemFileError("save tab (overwrite original file)", tabName, tmpFile);
+        return false;
+    }
+
+    // 5. Append further changes to new journal.
+    createJournal(tabName, tabFileName, model, saver);
+
+    COPYQ_LOG( QString("Tab \"%1\": Items saved").arg(tabName) );
+
+    return true;
+}
+
+quint8 pendingItemType(const PendingItem &item)
+{
+    if (!item.unique)
+        return PendingItemAdd;
+
+    return item.mode == ClipboardMode::Clipboard
+            ? PendingItemAddUniqueClipboard
+            : PendingItemAddUniqueSelection;
+}
+
+bool readPendingItemCounts(QIODevice *file, PendingItemCounts *counts)
+{
+    const QByteArray header(pendingItemsHeader);
+    if ( file->read(header.size()) != header )
+        return false;
+
+    QDataStream stream(file);
+    stream.setVersion(QDataStream::Qt_4_7);
+    stream >> counts->items >> counts->uniqueItems;
+    return stream.status() == QDataStream::Ok
+            && counts->items >= 0
+            && counts->uniqueItems >= 0;
+}
+
+bool writePendingItemCounts(QIODevice *file, const PendingItemCounts &counts)
+{
+    if ( !file->seek(0) || file->write(pendingItemsHeader) == -1 )
+        return false;
+
+    QDataStream stream(file);
+    stream.setVersion(QDataStream::Qt_4_7);
+    stream << counts.items << counts.uniqueItems;
+    return stream.status() == QDataStream::Ok;
+}
+
+void writePendingItem(QDataStream *stream, quint8 type, const QByteArray &itemBytes, PendingItemCounts *counts)
+{
+    *stream << type << itemBytes;
+    ++counts->items;
+    if (type != PendingItemAdd)
+        ++counts->uniqueItems;
+}
+
+bool appendPendingItems(QFile *file, const QVector<PendingItem> &items, PendingItemCounts *counts)
+{
+    if ( !file->seek(file->size()) )
+        return false;
+
+    QDataStream stream(file);
+    stream.setVersion(QDataStream::Qt_4_7);
+    for (const auto &item : items)
+        writePendingItem( &stream, pendingItemType(item), serializeItemData(item.data), counts );
+
+    return stream.status() == QDataStream::Ok
+            && writePendingItemCounts(file, *counts)
+            && file->flush();
+}
+
+/// Rewrites pending items file without the oldest items.
+bool dropOldestPendingItems(const QString &tabName, QFile *file, int dropCount, PendingItemCounts *counts)
+{
+    PendingItemCounts oldCounts;
+    if ( !file->seek(0) || !readPendingItemCounts(file, &oldCounts) )
+        return false;
+
+    QFile tmpFile( file->fileName() + ".tmp" );
+    PendingItemCounts newCounts;
+    if ( !tmpFile.open(QIODevice::WriteOnly) || !writePendingItemCounts(&tmpFile, newCounts) ) {
+        printItemFileError("save pending items (open temporary file)", tabName, tmpFile);
+        return false;
+    }
+
+    QDataStream in(file);
+    in.setVersion(QDataStream::Qt_4_7);
+    QDataStream out(&tmpFile);
+    out.setVersion(QDataStream::Qt_4_7);
+
+    for (int i = 0; !in.atEnd(); ++i) {
+        quint8 type;
+        QByteArray itemBytes;
+        in >> type >> itemBytes;
+        if ( in.status() != QDataStream::Ok )
+            break;
+
+        if (i >= dropCount)
+            writePendingItem(&out, type, itemBytes, &newCounts);
+    }
+
+    if ( in.status() != QDataStream::Ok
+         || out.status() != QDataStream::Ok
+         || !writePendingItemCounts(&tmpFile, newCounts)
+         || !tmpFile.flush() )
+    {
+        printItemFileError("save pending items (write temporary file)", tabName, tmpFile);
+        tmpFile.remove();
+        return false;
+    }
+
+    file->close();
+    if ( !file->remove() || !tmpFile.rename(file->fileName()) ) {
+        printItemFileError("save pending items (overwrite original file)", tabName, tmpFile);
+        return false;
+    }
+
+    *counts = newCounts;
+    return true;
+}
+
 ItemSaverPtr createTab(
         const QString &tabName, QAbstractItemModel &model, ItemFactory *itemFactory, int maxItems)
 {
@@ -108,20 +440,29 @@ ItemSaverPtr loadItems(const QString &tabName, QAbstractItemModel &model, ItemFa
 
     // If tab file doesn't exist, try to restore data from temporary file.
     if ( !QFile::exists(tabFileName) ) {
+        // Journal contains changes to the removed tab file (already in temporary file).
+        QFile::remove( journalFileName(tabFileName) );
+
         QFile tmpFile(tabFileName + ".tmp");
         if ( tmpFile.exists() ) {
             log( QString("Tab \"%1\": Restoring items (previous save failed)").arg(tabName), LogWarning );
 
-            saver = loadItems(tabName, tmpFile.fileName(), model, itemFactory, maxItems);
+            // Temporary file is overwritten on next save even if renaming it fails.
+            saver = loadItemsUnmapped(tabName, tmpFile.fileName(), model, itemFactory, maxItems);
             if ( saver && !tmpFile.rename(tabFileName) )
                 printItemFileError("overwrite original file", tabName, tmpFile);
         }
     }
 
+    // Read journal before loading items since a plugin can re-save the tab.
+    QByteArray journal;
     if (!saver) {
-        saver = QFile::exists(tabFileName)
-                ? loadItems(tabName, tabFileName, model, itemFactory, maxItems)
-                : createTab(tabName, model, itemFactory, maxItems);
+        if ( QFile::exists(tabFileName) ) {
+            journal = readJournal(tabName, tabFileName);
+            saver = loadItems(tabName, tabFileName, model, itemFactory, maxItems);
+        } else {
+            saver = createTab(tabName, model, itemFactory, maxItems);
+        }
     }
 
     if (!saver) {
@@ -129,6 +470,12 @@ ItemSaverPtr loadItems(const QString &tabName, QAbstractItemModel &model, ItemFa
         return nullptr;
     }
 
+    if ( !journal.isEmpty() ) {
+        replayJournal(tabName, journal, &model);
+        // Merge journal to tab file.
+        saveAllItems(tabName, tabFileName, model, saver);
+    }
+
     COPYQ_LOG( QString("Tab \"%1\": %2 items loaded").arg(tabName).arg(model.rowCount()) );
 
     return saver;
@@ -141,51 +488,133 @@ bool saveItems(const QString &tabName, const QAbstractItemModel &model, const It
     if ( !createItemDirectory() )
         return false;
 
-    // Save to temp file.
-    QFile tmpFile( tabFileName + ".tmp" );
-    if ( !tmpFile.open(QIODevice::WriteOnly) ) {
-        printItemFileError("save tab (open temporary file)", tabName, tmpFile);
-        return false;
+    if ( saveChanges(tabName, tabFileName, model, saver) ) {
+        COPYQ_LOG( QString("Tab \"%1\": Changes saved").arg(tabName) );
+        return true;
     }
 
-    COPYQ_LOG( QString("Tab \"%1\": Saving %2 items").arg(tabName).arg(model.rowCount()) );
+    return saveAllItems(tabName, tabFileName, model, saver);
+}
 
-    if ( !saver->saveItems(tabName, model, &tmpFile) ) {
-        printItemFileError("save tab (save items to temporary file)", tabName, tmpFile);
+void removeItems(const QString &tabName)
+{
+    const QString tabFileName = itemFileName(tabName);
+    QFile::remove(tabFileName);
+    QFile::remove(tabFileName + ".tmp");
+    QFile::remove( journalFileName(tabFileName) );
+    QFile::remove( pendingItemsFileName(tabFileName) );
+}
+
+bool savePendingItems(const QString &tabName, const QVector<PendingItem> &items, int maxItems)
+{
+    if ( items.isEmpty() )
+        return true;
+
+    if ( maxItems <= 0 || !createItemDirectory() )
+        return false;
+
+    QFile file( pendingItemsFileName(itemFileName(tabName)) );
+    if ( !file.open(QIODevice::ReadWrite) ) {
+        printItemFileError("save pending items", tabName, file);
         return false;
     }
 
-    // 1. Safely flush all data to temporary file.
-    if ( !tmpFile.flush() ) {
-        printItemFileError("save tab (flush temporary file)", tabName, tmpFile);
+    PendingItemCounts counts;
+    const qint64 oldSize = file.size();
+    if ( oldSize != 0 && !readPendingItemCounts(&file, &counts) ) {
+        log( QString("Tab \"%1\": Corrupted pending items").arg(tabName), LogWarning );
         return false;
     }
 
-    // 2. Remove old tab file.
-    {
-        QFile oldTabFile(tabFileName);
-        if (oldTabFile.exists() && !oldTabFile.remove()) {
-            printItemFileError("save tab (remove file)", tabName, oldTabFile);
-            return false;
-        }
+    // It's not known which items would be removed from the tab if some of the
+    // items can replace others so the tab needs to be loaded.
+    const bool hasUniqueItems = counts.uniqueItems > 0
+            || std::any_of( std::begin(items), std::end(items),
+                            [](const PendingItem &item) { return item.unique; } );
+    if ( hasUniqueItems && counts.items + items.size() > maxItems ) {
+        if (oldSize == 0)
+            file.remove();
+        return false;
     }
 
-    // 3. Overwrite previous file.
-    if ( !tmpFile.rename(tabFileName) ) {
-        printItemFileError("save tab (overwrite original file)", tabName, tmpFile);
+    if ( oldSize == 0 && !writePendingItemCounts(&file, counts) ) {
+        printItemFileError("save pending items (write header)", tabName, file);
+        file.remove();
         return false;
     }
 
-    COPYQ_LOG( QString("Tab \"%1\": Items saved").arg(tabName) );
+    if ( !appendPendingItems(&file, items, &counts) ) {
+        printItemFileError("save pending items (append)", tabName, file);
+        // Avoid adding the items twice if caller loads the tab instead.
+        if ( oldSize == 0 || !file.resize(oldSize) )
+            file.remove();
+        return false;
+    }
+
+    COPYQ_LOG( QString("Tab \"%1\": %2 items pending").arg(tabName).arg(counts.items) );
+
+    // Drop oldest items only once there are many more than the tab can hold
+    // so the file isn't rewritten on each addition.
+    if ( counts.items > 2 * maxItems ) {
+        COPYQ_LOG( QString("Tab \"%1\": Dropping oldest pending items").arg(tabName) );
+        dropOldestPendingItems(tabName, &file, counts.items - maxItems, &counts);
+    }
 
     return true;
 }
 
-void removeItems(const QString &tabName)
+QVector<PendingItem> loadPendingItems(const QString &tabName)
 {
-    const QString tabFileName = itemFileName(tabName);
-    QFile::remove(tabFileName);
-    QFile::remove(tabFileName + ".tmp");
+    QFile file( pendingItemsFileName(itemFileName(tabName)) );
+    if ( !file.exists() )
+        return QVector<PendingItem>();
+
+    if ( !file.open(QIODevice::ReadOnly) ) {
+        printItemFileError("load pending items", tabName, file);
+        return QVector<PendingItem>();
+    }
+
+    PendingItemCounts counts;
+    if ( !readPendingItemCounts(&file, &counts) ) {
+        log( QString("Tab \"%1\": Ignoring corrupted pending items").arg(tabName), LogWarning );
+        return QVector<PendingItem>();
+    }
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_4_7);
+
+    QVector<PendingItem> items;
+    items.reserve(counts.items);
+    while ( !in.atEnd() ) {
+        quint8 type;
+        QByteArray itemBytes;
+        in >> type >> itemBytes;
+        if ( in.status() != QDataStream::Ok ) {
+            log( QString("Tab \"%1\": Ignoring incomplete pending item").arg(tabName), LogWarning );
+            break;
+        }
+
+        PendingItem item;
+        if ( !deserializeData(&item.data, itemBytes) ) {
+            log( QString("Tab \"%1\": Ignoring corrupted pending item").arg(tabName), LogWarning );
+            continue;
+        }
+
+        item.unique = type != PendingItemAdd;
+        item.mode = type == PendingItemAddUniqueSelection
+                ? ClipboardMode::Selection
+                : ClipboardMode::Clipboard;
+        items.append(item);
+    }
+
+    COPYQ_LOG( QString("Tab \"%1\": %2 pending items loaded").arg(tabName).arg(items.size()) );
+
+    return items;
+}
+
+void removePendingItems(const QString &tabName)
+{
+    QFile::remove( pendingItemsFileName(itemFileName(tabName)) );
 }
 
 bool moveItems(const QString &oldId, const QString &newId)
@@ -193,17 +622,35 @@ bool moveItems(const QString &oldId, const QString &newId)
     const QString oldFileName = itemFileName(oldId);
     const QString newFileName = itemFileName(newId);
 
-    if ( oldFileName != newFileName && QFile::copy(oldFileName, newFileName) ) {
-        QFile::remove(oldFileName);
-        return true;
+    // Tab which was never loaded can have only pending items without tab file.
+    const bool hasTabFile = QFile::exists(oldFileName);
+    if ( oldFileName == newFileName || (hasTabFile && !QFile::copy(oldFileName, newFileName)) ) {
+        log( QString("Failed to move items from \"%1\" (tab \"%2\") to \"%3\" (tab \"%4\")").arg(
+                 oldFileName,
+                 oldId,
+                 newFileName,
+                 newId
+           ), LogError );
+        return false;
     }
 
-    log( QString("Failed to move items from \"%1\" (tab \"%2\") to \"%3\" (tab \"%4\")").arg(
-             oldFileName,
-             oldId,
-             newFileName,
-             newId
-       ), LogError );
+    QFile::remove(oldFileName);
+
+    const QString oldJournalFileName = journalFileName(oldFileName);
+    const QString newJournalFileName = journalFileName(newFileName);
+    QFile::remove(newJournalFileName);
+    if ( QFile::exists(oldJournalFileName) && !QFile::rename(oldJournalFileName, newJournalFileName) ) {
+        log( QString("Failed to move journal \"%1\" to \"%2\"")
+             .arg(oldJournalFileName, newJournalFileName), LogError );
+    }
 
-    return false;
+    const QString oldPendingFileName = pendingItemsFileName(oldFileName);
+    const QString newPendingFileName = pendingItemsFileName(newFileName);
+    QFile::remove(newPendingFileName);
+    if ( QFile::exists(oldPendingFileName) && !QFile::rename(oldPendingFileName, newPendingFileName) ) {
+        log( QString("Failed to move pending items \"%1\" to \"%2\"")
+             .arg(oldPendingFileName, newPendingFileName), LogError );
+    }
+
+    return true;
 }
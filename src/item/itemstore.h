@@ -19,12 +19,24 @@
 #ifndef ITEMSTORE_H
 #define ITEMSTORE_H
 
+#include "common/clipboardmode.h"
 #include "item/itemwidget.h"
 
+#include <QVariantMap>
+#include <QVector>
+
 class QAbstractItemModel;
 class ItemFactory;
 class QString;
 
+/** Item added to tab which is not loaded (see savePendingItems()). */
+struct PendingItem {
+    QVariantMap data;
+    /// Add as new clipboard content (see ClipboardBrowser::addUnique()).
+    bool unique = false;
+    ClipboardMode mode = ClipboardMode::Clipboard;
+};
+
 /** Load items from configuration file. */
 ItemSaverPtr loadItems(const QString &tabName, QAbstractItemModel &model //!< Model for items.
         , ItemFactory *itemFactory, int maxItems);
@@ -37,6 +49,26 @@ bool saveItems(const QString &tabName, const QAbstractItemModel &model //!< Mode
 void removeItems(const QString &tabName //!< See ClipboardBrowser::getID().
         );
 
+/**
+ * Store items to be added to top of a tab without loading the tab.
+ *
+ * Items are appended to a small file next to the tab file and are added to the
+ * tab once it's loaded. Oldest pending items are dropped if they would be
+ * removed from the tab anyway because of @a maxItems limit.
+ *
+ * Items are stored unencrypted so this must not be used for tabs saved by
+ * plugins (see ItemFactory::canSaveItems()).
+ *
+ * @return false if items couldn't be stored and the tab needs to be loaded
+ */
+bool savePendingItems(const QString &tabName, const QVector<PendingItem> &items, int maxItems);
+
+/** Load items to add to a tab (oldest first). */
+QVector<PendingItem> loadPendingItems(const QString &tabName);
+
+/** Remove items to add to a tab (after they were added and saved). */
+void removePendingItems(const QString &tabName);
+
 /** Move configuration file for items. */
 bool moveItems(
         const QString &oldId, //!< See ClipboardBrowser::getID().
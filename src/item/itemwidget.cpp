@@ -205,6 +205,20 @@ bool ItemSaverInterface::saveItems(const QString &, const QAbstractItemModel &,
     return false;
 }
 
+bool ItemSaverInterface::saveItemsInBackground(const QString &, const QAbstractItemModel &, const QString &)
+{
+    return false;
+}
+
+void ItemSaverInterface::waitForSavedItems()
+{
+}
+
+bool ItemSaverInterface::saveChanges(const QString &, const QAbstractItemModel &, QIODevice *)
+{
+    return false;
+}
+
 bool ItemSaverInterface::canRemoveItems(const QList<QModelIndex> &, QString *)
 {
     return true;
@@ -49,7 +49,14 @@ using ItemSaverPtr = std::shared_ptr<ItemSaverInterface>;
 class ItemScriptableFactoryInterface;
 using ItemScriptableFactoryPtr = std::shared_ptr<ItemScriptableFactoryInterface>;
 
-#define COPYQ_PLUGIN_ITEM_LOADER_ID "com.github.hluk.copyq.itemloader/3.9.3"
+/**
+ * Plugin interface ID.
+ *
+ * Change it whenever virtual functions of the interfaces below change
+ * (e.g. ItemSaverInterface::saveItemsInBackground()) so that plugins built
+ * against an older interface are not loaded.
+ */
+#define COPYQ_PLUGIN_ITEM_LOADER_ID "com.github.hluk.copyq.itemloader/3.9.4"
 
 /**
  * Handles item in list.
@@ -211,6 +218,32 @@ public:
      */
     virtual bool saveItems(const QString &tabName, const QAbstractItemModel &model, QIODevice *file);
 
+    /**
+     * Start saving items in background.
+     *
+     * The saver replaces the tab file itself once done. Saving must finish
+     * in waitForSavedItems().
+     *
+     * @return true if items are being saved, false to save items using saveItems()
+     */
+    virtual bool saveItemsInBackground(const QString &tabName, const QAbstractItemModel &model, const QString &tabFileName);
+
+    /**
+     * Wait until items saved in background are written.
+     *
+     * Called before tab is unloaded and before tab files are renamed or removed.
+     */
+    virtual void waitForSavedItems();
+
+    /**
+     * Save only changes made since items were last saved.
+     *
+     * Changes are appended to a journal which is replayed after items are loaded.
+     *
+     * @return true only if changes were saved, otherwise all items need to be saved
+     */
+    virtual bool saveChanges(const QString &tabName, const QAbstractItemModel &model, QIODevice *journal);
+
     /**
      * Called before items are deleted by user.
      * @return true if items can be removed, false to cancel the removal
@@ -366,6 +399,9 @@ public:
     /**
      * Return true if regular expression matches items content.
      * Returns false by default.
+     *
+     * Only text from text and internal formats should be matched, otherwise
+     * search index can skip the item (see contentType::searchText).
      */
     virtual bool matches(const QModelIndex &index, const QRegExp &re) const;
 
@@ -30,11 +30,32 @@
 #include <QList>
 #include <QPair>
 #include <QStringList>
-
-#include <unordered_map>
+#include <QVector>
 
 namespace {
 
+/// Data of this size or larger are not copied from mapped tab file.
+const quint32 minMappedDataSize = 4096;
+
+/// Smaller data are not compressed.
+const int minCompressedDataSize = 256;
+
+/// Fast compression level, saving items should not block the application.
+const int dataCompressionLevel = 1;
+
+/// Data codec in format version 3 (in version 2 it was just a compression flag).
+enum DataCodec {
+    DataCodecNone = 0,
+    DataCodecZlib = 1,
+};
+
+enum JournalRecordType {
+    JournalItemsInserted = 1,
+    JournalItemsChanged = 2,
+    JournalItemsRemoved = 3,
+    JournalItemsMoved = 4,
+};
+
 template <typename T>
 bool readOrError(QDataStream *out, T *value, const char *error)
 {
@@ -46,25 +67,31 @@ bool readOrError(QDataStream *out, T *value, const char *error)
     return false;
 }
 
-const std::unordered_map<int, QString> &idToMime()
+/**
+ * Common MIME type prefixes used to shorten stored formats (index is prefix ID).
+ *
+ * More specific prefixes have lower ID so the longest prefix matches first.
+ */
+const QVector<QString> &idToMime()
 {
-    static const std::unordered_map<int, QString> map({
-        {1, QString(mimeWindowTitle)},
-        {2, QString(mimeItemNotes)},
-
-        {3, QString(COPYQ_MIME_PREFIX)},
-
-        {4, QString(mimeText)},
-        {5, QString(mimeHtml)},
-        {6, QString(mimeUriList)},
-
-        {7, QString("image/")},
-        {8, QString("text/")},
-        {9, QString("application/")},
-        {10, QString("audio/")},
-        {11, QString("video/")}
-    });
-    return map;
+    static const QVector<QString> mimes = QVector<QString>()
+        << QString()
+
+        << QString(mimeWindowTitle)
+        << QString(mimeItemNotes)
+
+        << QString(COPYQ_MIME_PREFIX)
+
+        << QString(mimeText)
+        << QString(mimeHtml)
+        << QString(mimeUriList)
+
+        << QString("image/")
+        << QString("text/")
+        << QString("application/")
+        << QString("audio/")
+        << QString("video/");
+    return mimes;
 }
 
 QString decompressMime(QDataStream *out)
@@ -84,9 +111,8 @@ QString decompressMime(QDataStream *out)
     if (id == 0)
         return mime.mid(1);
 
-    const auto it = idToMime().find(id);
-    if ( it != std::end(idToMime()) )
-        return it->second + mime.mid(1);
+    if ( id < idToMime().size() )
+        return idToMime()[id] + mime.mid(1);
 
     log("Corrupted data: Failed to decompress MIME type", LogError);
     out->setStatus(QDataStream::ReadCorruptData);
@@ -95,36 +121,93 @@ QString decompressMime(QDataStream *out)
 
 QString compressMime(const QString &mime)
 {
-    for (const auto &idMime : idToMime()) {
-        if ( mime.startsWith(idMime.second) ) {
-            const auto prefixSize = idMime.second.size();
-            return QString::number(idMime.first, 16) + mime.mid(prefixSize);
-        }
+    const auto &mimes = idToMime();
+    for (int id = 1; id < mimes.size(); ++id) {
+        const auto &prefix = mimes[id];
+        if ( mime.startsWith(prefix) )
+            return QString::number(id, 16) + mime.mid( prefix.size() );
     }
 
     return "0" + mime;
 }
 
-bool deserializeDataV2(QDataStream *out, QVariantMap *data)
+/// Reads data referencing mapped file (without copying) if the data are large.
+bool readMappedBytes(QDataStream *out, const QByteArray &mappedFile, QByteArray *bytes)
+{
+    QIODevice *device = out->device();
+    const qint64 pos = device->pos();
+
+    quint32 size;
+    if ( !readOrError(out, &size, "Failed to read data size (v2)") )
+        return false;
+
+    // Null byte array has size 0xffffffff.
+    if ( size < minMappedDataSize || size == 0xffffffff ) {
+        device->seek(pos);
+        return readOrError(out, bytes, "Failed to read item data (v2)");
+    }
+
+    const qint64 dataPos = device->pos();
+    if ( dataPos + size > mappedFile.size() ) {
+        log("Corrupted data: Invalid data size (v2)", LogError);
+        out->setStatus(QDataStream::ReadCorruptData);
+        return false;
+    }
+
+    *bytes = QByteArray::fromRawData( mappedFile.constData() + dataPos, static_cast<int>(size) );
+    out->skipRawData( static_cast<int>(size) );
+    return true;
+}
+
+bool shouldCompress(const QString &mime, int size)
+{
+    if (size < minCompressedDataSize)
+        return false;
+
+    // Skip formats which are usually already compressed (e.g. PNG or JPEG images).
+    return mime.startsWith("text/")
+        || mime.startsWith("application/x-")
+        || mime.startsWith("application/json")
+        || mime.startsWith("application/xml")
+        || mime.startsWith("image/bmp")
+        || mime.startsWith("image/x-bmp")
+        || mime.startsWith("image/svg");
+}
+
+/// Version 3 is same as version 2 except compression flag is replaced with codec.
+bool deserializeDataV2(QDataStream *out, QVariantMap *data, const QByteArray *mappedFile, bool hasCodec)
 {
     qint32 size;
     if ( !readOrError(out, &size, "Failed to read size (v2)") )
         return false;
 
     QByteArray tmpBytes;
-    bool compress;
+    quint8 codec;
     for (qint32 i = 0; i < size; ++i) {
         const QString mime = decompressMime(out);
         if ( out->status() != QDataStream::Ok )
             return false;
 
-        if ( !readOrError(out, &compress, "Failed to read compression flag (v2)") )
+        if ( !readOrError(out, &codec, "Failed to read compression flag (v2)") )
             return false;
 
-        if ( !readOrError(out, &tmpBytes, "Failed to read item data (v2)") )
+        if (!hasCodec && codec != DataCodecNone)
+            codec = DataCodecZlib;
+
+        if (codec != DataCodecNone && codec != DataCodecZlib) {
+            log("Corrupted data: Unknown data codec (v3)", LogError);
+            out->setStatus(QDataStream::ReadCorruptData);
             return false;
+        }
+
+        if (mappedFile && codec == DataCodecNone) {
+            if ( !readMappedBytes(out, *mappedFile, &tmpBytes) )
+                return false;
+        } else if ( !readOrError(out, &tmpBytes, "Failed to read item data (v2)") ) {
+            return false;
+        }
 
-        if (compress) {
+        if (codec == DataCodecZlib) {
             tmpBytes = qUncompress(tmpBytes);
             if ( tmpBytes.isEmpty() ) {
                 log("Corrupted data: Failed to decompress data (v2)", LogError);
@@ -138,34 +221,18 @@ bool deserializeDataV2(QDataStream *out, QVariantMap *data)
     return out->status() == QDataStream::Ok;
 }
 
-} // namespace
-
-void serializeData(QDataStream *stream, const QVariantMap &data)
-{
-    *stream << static_cast<qint32>(-2);
-
-    const qint32 size = data.size();
-    *stream << size;
-
-    QByteArray bytes;
-    for (auto it = data.constBegin(); it != data.constEnd(); ++it) {
-        const auto &mime = it.key();
-        bytes = data[mime].toByteArray();
-        *stream << compressMime(mime)
-                << /* compressData = */ false
-                << bytes;
-    }
-}
-
-bool deserializeData(QDataStream *stream, QVariantMap *data)
+bool deserializeItemData(QDataStream *stream, QVariantMap *data, const QByteArray *mappedFile)
 {
     try {
         qint32 length;
         if ( !readOrError(stream, &length, "Failed to read length") )
             return false;
 
+        if (length == -3)
+            return deserializeDataV2(stream, data, mappedFile, true);
+
         if (length == -2)
-            return deserializeDataV2(stream, data);
+            return deserializeDataV2(stream, data, mappedFile, false);
 
         if (length < 0) {
             log("Corrupted data: Invalid length (v1)", LogError);
@@ -203,32 +270,35 @@ bool deserializeData(QDataStream *stream, QVariantMap *data)
     return stream->status() == QDataStream::Ok;
 }
 
-QByteArray serializeData(const QVariantMap &data)
+/// Serializes item data for storage (compresses some formats).
+void serializeDataV3(QDataStream *stream, const QVariantMap &data)
 {
-    QByteArray bytes;
-    QDataStream out(&bytes, QIODevice::WriteOnly);
-    serializeData(&out, data);
-    return bytes;
-}
+    *stream << static_cast<qint32>(-3);
 
-bool deserializeData(QVariantMap *data, const QByteArray &bytes)
-{
-    QDataStream out(bytes);
-    return deserializeData(&out, data);
-}
-
-bool serializeData(const QAbstractItemModel &model, QDataStream *stream)
-{
-    qint32 length = model.rowCount();
-    *stream << length;
+    const qint32 size = data.size();
+    *stream << size;
 
-    for(qint32 i = 0; i < length && stream->status() == QDataStream::Ok; ++i)
-        serializeData( stream, model.data(model.index(i, 0), contentType::data).toMap() );
+    QByteArray bytes;
+    for (auto it = data.constBegin(); it != data.constEnd(); ++it) {
+        const auto &mime = it.key();
+        bytes = it.value().toByteArray();
+
+        quint8 codec = DataCodecNone;
+        if ( shouldCompress(mime, bytes.size()) ) {
+            const QByteArray compressedBytes = qCompress(bytes, dataCompressionLevel);
+            if ( compressedBytes.size() < bytes.size() ) {
+                bytes = compressedBytes;
+                codec = DataCodecZlib;
+            }
+        }
 
-    return stream->status() == QDataStream::Ok;
+        *stream << compressMime(mime)
+                << codec
+                << bytes;
+    }
 }
 
-bool deserializeData(QAbstractItemModel *model, QDataStream *stream, int maxItems)
+bool deserializeItems(QAbstractItemModel *model, QDataStream *stream, int maxItems, const QByteArray *mappedFile)
 {
     qint32 length;
     if ( !readOrError(stream, &length, "Failed to read length") )
@@ -248,7 +318,7 @@ bool deserializeData(QAbstractItemModel *model, QDataStream *stream, int maxItem
 
     for(qint32 i = 0; i < length; ++i) {
         QVariantMap data;
-        if ( !deserializeData(stream, &data) )
+        if ( !deserializeItemData(stream, &data, mappedFile) )
             return false;
 
         if ( !model->setData(model->index(i, 0), data, contentType::data) ) {
@@ -261,6 +331,68 @@ bool deserializeData(QAbstractItemModel *model, QDataStream *stream, int maxItem
     return stream->status() == QDataStream::Ok;
 }
 
+} // namespace
+
+void serializeData(QDataStream *stream, const QVariantMap &data)
+{
+    *stream << static_cast<qint32>(-2);
+
+    const qint32 size = data.size();
+    *stream << size;
+
+    QByteArray bytes;
+    for (auto it = data.constBegin(); it != data.constEnd(); ++it) {
+        const auto &mime = it.key();
+        bytes = data[mime].toByteArray();
+        *stream << compressMime(mime)
+                << /* compressData = */ false
+                << bytes;
+    }
+}
+
+bool deserializeData(QDataStream *stream, QVariantMap *data)
+{
+    return deserializeItemData(stream, data, nullptr);
+}
+
+QByteArray serializeData(const QVariantMap &data)
+{
+    QByteArray bytes;
+    QDataStream out(&bytes, QIODevice::WriteOnly);
+    serializeData(&out, data);
+    return bytes;
+}
+
+bool deserializeData(QVariantMap *data, const QByteArray &bytes)
+{
+    QDataStream out(bytes);
+    return deserializeData(&out, data);
+}
+
+QByteArray serializeItemData(const QVariantMap &data)
+{
+    QByteArray bytes;
+    QDataStream out(&bytes, QIODevice::WriteOnly);
+    serializeDataV3(&out, data);
+    return bytes;
+}
+
+bool serializeData(const QAbstractItemModel &model, QDataStream *stream)
+{
+    qint32 length = model.rowCount();
+    *stream << length;
+
+    for(qint32 i = 0; i < length && stream->status() == QDataStream::Ok; ++i)
+        serializeDataV3( stream, model.data(model.index(i, 0), contentType::mappedData).toMap() );
+
+    return stream->status() == QDataStream::Ok;
+}
+
+bool deserializeData(QAbstractItemModel *model, QDataStream *stream, int maxItems)
+{
+    return deserializeItems(model, stream, maxItems, nullptr);
+}
+
 bool serializeData(const QAbstractItemModel &model, QIODevice *file)
 {
     QDataStream stream(file);
@@ -274,3 +406,99 @@ bool deserializeData(QAbstractItemModel *model, QIODevice *file, int maxItems)
     stream.setVersion(QDataStream::Qt_4_7);
     return deserializeData(model, &stream, maxItems);
 }
+
+bool deserializeMappedData(QAbstractItemModel *model, const QByteArray &mappedFile, int maxItems)
+{
+    QDataStream stream(mappedFile);
+    stream.setVersion(QDataStream::Qt_4_7);
+    return deserializeItems(model, &stream, maxItems, &mappedFile);
+}
+
+void serializeItemsInserted(const QAbstractItemModel &model, int first, int last, QDataStream *stream)
+{
+    *stream << static_cast<qint32>(JournalItemsInserted)
+            << static_cast<qint32>(first)
+            << static_cast<qint32>(last - first + 1);
+
+    for (int row = first; row <= last; ++row)
+        serializeDataV3( stream, model.data(model.index(row, 0), contentType::mappedData).toMap() );
+}
+
+void serializeItemsChanged(const QAbstractItemModel &model, int first, int last, QDataStream *stream)
+{
+    *stream << static_cast<qint32>(JournalItemsChanged)
+            << static_cast<qint32>(first)
+            << static_cast<qint32>(last - first + 1);
+
+    for (int row = first; row <= last; ++row)
+        serializeDataV3( stream, model.data(model.index(row, 0), contentType::mappedData).toMap() );
+}
+
+void serializeItemsRemoved(int first, int last, QDataStream *stream)
+{
+    *stream << static_cast<qint32>(JournalItemsRemoved)
+            << static_cast<qint32>(first)
+            << static_cast<qint32>(last - first + 1);
+}
+
+void serializeItemsMoved(int first, int last, int destinationRow, QDataStream *stream)
+{
+    *stream << static_cast<qint32>(JournalItemsMoved)
+            << static_cast<qint32>(first)
+            << static_cast<qint32>(last - first + 1)
+            << static_cast<qint32>(destinationRow);
+}
+
+bool deserializeChanges(QAbstractItemModel *model, QDataStream *stream)
+{
+    while ( !stream->atEnd() ) {
+        // Read whole record first; last record can be incomplete if application crashed.
+        qint32 type;
+        qint32 row;
+        qint32 count;
+        if ( !readOrError(stream, &type, "Failed to read journal record type")
+             || !readOrError(stream, &row, "Failed to read journal record row")
+             || !readOrError(stream, &count, "Failed to read journal record item count") )
+        {
+            return false;
+        }
+
+        if (row < 0 || count <= 0) {
+            log("Corrupted data: Invalid journal record", LogError);
+            return false;
+        }
+
+        bool ok;
+        if (type == JournalItemsInserted || type == JournalItemsChanged) {
+            QList<QVariantMap> items;
+            for (qint32 i = 0; i < count; ++i) {
+                QVariantMap data;
+                if ( !deserializeData(stream, &data) )
+                    return false;
+                items.append(data);
+            }
+
+            ok = type == JournalItemsChanged
+                    || (row <= model->rowCount() && model->insertRows(row, count));
+            for (qint32 i = 0; ok && i < count; ++i)
+                ok = model->setData( model->index(row + i, 0), items[i], contentType::data );
+        } else if (type == JournalItemsRemoved) {
+            ok = model->removeRows(row, count);
+        } else if (type == JournalItemsMoved) {
+            qint32 destinationRow;
+            if ( !readOrError(stream, &destinationRow, "Failed to read journal record destination row") )
+                return false;
+            ok = model->moveRows(QModelIndex(), row, count, QModelIndex(), destinationRow);
+        } else {
+            log("Corrupted data: Unknown journal record type", LogError);
+            return false;
+        }
+
+        if (!ok) {
+            log("Failed to replay journal record", LogError);
+            return false;
+        }
+    }
+
+    return stream->status() == QDataStream::Ok;
+}
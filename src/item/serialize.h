@@ -32,9 +32,30 @@ bool deserializeData(QDataStream *stream, QVariantMap *data);
 QByteArray serializeData(const QVariantMap &data);
 bool deserializeData(QVariantMap *data, const QByteArray &bytes);
 
+/** Serialize item data as in tab files (some formats are compressed). */
+QByteArray serializeItemData(const QVariantMap &data);
+
 bool serializeData(const QAbstractItemModel &model, QDataStream *stream);
 bool deserializeData(QAbstractItemModel *model, QDataStream *stream, int maxItems);
 bool serializeData(const QAbstractItemModel &model, QIODevice *file);
 bool deserializeData(QAbstractItemModel *model, QIODevice *file, int maxItems);
 
+/**
+ * Deserialize items from tab file mapped to memory.
+ *
+ * Large uncompressed data are not copied, items reference the mapped bytes instead.
+ */
+bool deserializeMappedData(QAbstractItemModel *model, const QByteArray &mappedFile, int maxItems);
+
+/** Append journal record for items inserted to model. */
+void serializeItemsInserted(const QAbstractItemModel &model, int first, int last, QDataStream *stream);
+/** Append journal record for items changed in model. */
+void serializeItemsChanged(const QAbstractItemModel &model, int first, int last, QDataStream *stream);
+/** Append journal record for items removed from model. */
+void serializeItemsRemoved(int first, int last, QDataStream *stream);
+/** Append journal record for items moved in model. */
+void serializeItemsMoved(int first, int last, int destinationRow, QDataStream *stream);
+/** Replay journal records on model. */
+bool deserializeChanges(QAbstractItemModel *model, QDataStream *stream);
+
 #endif // SERIALIZE_H
@@ -88,7 +88,7 @@ QString CopyQPasteboardMime::flavorFor(const QString &mime)
         return uti;
     }
 
-    if (mime.startsWith(COPYQ_MIME_PREFIX)) {
+    if (isInternalFormat(mime)) {
         return mime.mid(QLatin1String(COPYQ_MIME_PREFIX).size());
     }
 
@@ -65,6 +65,8 @@
 #include <QThread>
 #include <QTimer>
 
+#include <algorithm>
+
 Q_DECLARE_METATYPE(QByteArray*)
 Q_DECLARE_METATYPE(QFile*)
 
@@ -73,6 +75,11 @@ namespace {
 const char *const programName = "CopyQ Clipboard Manager";
 const char *const mimeIgnore = COPYQ_MIME_PREFIX "ignore";
 
+/// Maximum number of items transferred in single call to server.
+const int maxItemsPerCall = 1000;
+/// Maximum number of items returned in single array to scripts (to limit memory usage).
+const int maxItemsPerArray = 10000;
+
 class PerformanceLogger {
 public:
     explicit PerformanceLogger(const QString &label)
@@ -496,15 +503,6 @@ QString parseCommandLineArgument(const QString &arg)
     return result;
 }
 
-bool matchData(const QRegExp &re, const QVariantMap &data, const QString &format)
-{
-    if ( re.isEmpty() )
-        return true;
-
-    const QString text = getTextData(data, format);
-    return re.indexIn(text) != -1;
-}
-
 bool isInternalDataFormat(const QString &format)
 {
     return format == mimeWindowTitle
@@ -1865,6 +1863,84 @@ void Scriptable::setItem()
     insert(2);
 }
 
+QScriptValue Scriptable::getItems()
+{
+    m_skipArguments = 2;
+
+    QVector<int> rows;
+    if ( !toRows(argument(0), &rows) ) {
+        throwError(argumentError());
+        return QScriptValue();
+    }
+
+    return itemsData(rows, argument(1));
+}
+
+QScriptValue Scriptable::readRange()
+{
+    m_skipArguments = 4;
+
+    // Optional callback is always the last argument.
+    int argc = argumentCount();
+    QScriptValue callback;
+    if ( argc > 1 && argument(argc - 1).isFunction() ) {
+        --argc;
+        callback = argument(argc);
+    }
+
+    int row;
+    if ( !toInt(argument(0), &row) || row < 0 ) {
+        throwError(argumentError());
+        return QScriptValue();
+    }
+
+    const int size = m_proxy->browserLength(m_tabName);
+    int count = size - row;
+    if ( argc > 1 && !argument(1).isUndefined() ) {
+        int maxCount;
+        if ( !toInt(argument(1), &maxCount) ) {
+            throwError(argumentError());
+            return QScriptValue();
+        }
+        if (maxCount >= 0)
+            count = std::min(count, maxCount);
+    }
+
+    QVector<int> rows;
+    rows.reserve( std::max(0, count) );
+    for (int i = 0; i < count; ++i)
+        rows.append(row + i);
+
+    const QScriptValue formats = argc > 2 ? argument(2) : QScriptValue(QScriptValue::UndefinedValue);
+    return itemsData(rows, formats, callback);
+}
+
+void Scriptable::replaceItems()
+{
+    m_skipArguments = 2;
+
+    QVector<int> rows;
+    if ( !toRows(argument(0), &rows) || !argument(1).isArray() ) {
+        throwError(argumentError());
+        return;
+    }
+
+    const auto items = fromScriptValue<QVector<QVariantMap>>( argument(1), this );
+    if ( items.size() != rows.size() ) {
+        throwError("Number of rows and items must be the same");
+        return;
+    }
+
+    bool result = true;
+    for (int i = 0; i < rows.size() && canContinue(); i += maxItemsPerCall) {
+        if ( !m_proxy->browserSetItemsData(m_tabName, rows.mid(i, maxItemsPerCall), items.mid(i, maxItemsPerCall)) )
+            result = false;
+    }
+
+    if (!result)
+        throwError("Failed to set some items");
+}
+
 QScriptValue Scriptable::toBase64()
 {
     m_skipArguments = 1;
@@ -2531,6 +2607,64 @@ void Scriptable::runMenuCommandFilters()
         loop.exec();
 }
 
+void Scriptable::runCallbacks()
+{
+    QEventLoop loop;
+    connect(this, &Scriptable::finished, &loop, [&]() {
+        if (m_abort == Abort::AllEvaluations)
+            loop.exit();
+    });
+
+    QTimer timer;
+    timer.setSingleShot(true);
+    timer.setInterval(0);
+    connect(this, &Scriptable::dataReceived, &loop, [&](const QByteArray &receivedBytes) {
+        if (receivedBytes == "ABORT") {
+            abortEvaluation(Abort::AllEvaluations);
+            return;
+        }
+
+        timer.start();
+    });
+
+    bool running = false;
+    connect(&timer, &QTimer::timeout, &loop, [&]() {
+        if (running)
+            return;
+        running = true;
+
+        while ( canContinue() ) {
+            const QByteArray bytes = m_proxy->takeCallback(m_actionId);
+            if ( bytes.isEmpty() )
+                break;
+
+            if (bytes == "ABORT") {
+                abortEvaluation(Abort::AllEvaluations);
+                break;
+            }
+
+            QDataStream in(bytes);
+            QString script;
+            in >> script;
+            QVariantMap data;
+            if ( in.status() != QDataStream::Ok || !deserializeData(&in, &data) ) {
+                log("Failed to deserialize callback", LogError);
+                continue;
+            }
+
+            runCallback(script, data);
+        }
+
+        running = false;
+    });
+
+    emit receiveData();
+    timer.start();
+
+    if (m_abort == Abort::None)
+        loop.exec();
+}
+
 void Scriptable::monitorClipboard()
 {
     if (!verifyClipboardAccess())
@@ -2606,17 +2740,17 @@ void Scriptable::onMonitorClipboardChanged(const QVariantMap &data, ClipboardOwn
                .arg(isClipboardData(data) ? "clipboard" : "selection")
                .arg(getTextData(data, mimeOwner)) );
 
-    const QString command =
-        ownership == ClipboardOwnership::Own ? "copyq onOwnClipboardChanged"
-      : ownership == ClipboardOwnership::Hidden ? "copyq onHiddenClipboardChanged"
-      : "copyq onClipboardChanged";
+    const QString script =
+        ownership == ClipboardOwnership::Own ? "onOwnClipboardChanged()"
+      : ownership == ClipboardOwnership::Hidden ? "onHiddenClipboardChanged()"
+      : "onClipboardChanged()";
 
-    m_proxy->runInternalAction(data, command);
+    m_proxy->runCallback(data, script);
 }
 
 void Scriptable::onMonitorClipboardUnchanged(const QVariantMap &data)
 {
-    m_proxy->runInternalAction(data, "copyq onClipboardUnchanged");
+    m_proxy->runCallback(data, "onClipboardUnchanged()");
 }
 
 void Scriptable::onSynchronizeSelection(ClipboardMode sourceMode, const QString &text, uint targetTextHash)
@@ -2635,6 +2769,37 @@ void Scriptable::onSynchronizeSelection(ClipboardMode sourceMode, const QString
 #endif
 }
 
+void Scriptable::runCallback(const QString &script, const QVariantMap &data)
+{
+    PerformanceLogger logger( QString("Callback %1").arg(script) );
+
+    // Run as in-process action so abort() and fail() stop only the callback.
+    Action action;
+    const auto oldAction = m_action;
+    m_action = &action;
+    m_data = m_oldData = data;
+    engine()->pushContext();
+
+    eval(script);
+    if ( m_engine->hasUncaughtException() ) {
+        processUncaughtException(script);
+        m_engine->clearExceptions();
+    } else if (!m_failed && m_abort == Abort::None) {
+        setActionData();
+    }
+
+    m_failed = false;
+    if (m_abort != Abort::AllEvaluations)
+        m_abort = Abort::None;
+
+    engine()->popContext();
+    m_action = oldAction;
+    m_data.clear();
+    m_oldData.clear();
+
+    m_engine->collectGarbage();
+}
+
 bool Scriptable::sourceScriptCommands()
 {
     const auto commands = m_proxy->scriptCommands();
@@ -3033,6 +3198,7 @@ bool Scriptable::runAction(Action *action)
 
     // Update data for the new action.
     setActionData();
+    m_proxy->sendQueuedFunctionCalls();
 
     action->setWorkingDirectory( m_dirClass->getCurrentPath() );
     action->start();
@@ -3058,18 +3224,30 @@ bool Scriptable::runCommands(CommandType::CommandType type)
             ? "Automatic command \"%1\": %2"
             : "Display command \"%1\": %2";
 
-    auto commands = type == CommandType::Automatic
+    const auto commands = type == CommandType::Automatic
             ? m_proxy->automaticCommands()
             : m_proxy->displayCommands();
+
+    CommandMatcher &matcher = type == CommandType::Automatic
+            ? m_automaticCommandMatcher
+            : m_displayCommandMatcher;
+    if ( matcher.commands() != commands )
+        matcher = CommandMatcher(commands);
+
     const QString tabName = getTextData(m_data, mimeCurrentTab);
 
-    for (auto &command : commands) {
+    QVariantMap matchedData = m_data;
+    auto matchingCommands = matcher.matchingCommands(matchedData);
+
+    for (int i = 0; i < matchingCommands.size(); ++i) {
+        const int commandIndex = matchingCommands[i];
+        auto command = commands[commandIndex];
         PerformanceLogger logger( QString("Command \"%1\"").arg(command.name) );
 
         if ( command.outputTab.isEmpty() )
             command.outputTab = tabName;
 
-        if ( !canExecuteCommand(command) )
+        if ( !canExecuteCommandFilter(command.matchCmd) )
             continue;
 
         if ( canContinue() && !command.cmd.isEmpty() ) {
@@ -3108,33 +3286,16 @@ bool Scriptable::runCommands(CommandType::CommandType type)
         }
 
         COPYQ_LOG_VERBOSE( QString(label).arg(command.name, "Finished") );
-    }
 
-    return true;
-}
-
-bool Scriptable::canExecuteCommand(const Command &command)
-{
-    // Verify that data for given MIME is available.
-    if ( !command.input.isEmpty() ) {
-        if (command.input == mimeItems || command.input == "!OUTPUT") {
-            // Disallow applying action that takes serialized item more times.
-            if ( m_data.contains(command.output) )
-                return false;
-        } else if ( !m_data.contains(command.input) ) {
-            return false;
+        // Match remaining commands again if the command changed data.
+        if (m_data != matchedData) {
+            matchedData = m_data;
+            matchingCommands = matcher.matchingCommands(matchedData, commandIndex + 1);
+            i = -1;
         }
     }
 
-    // Verify that and text matches given regexp.
-    if ( !matchData(command.re, m_data, mimeText) )
-        return false;
-
-    // Verify that window title matches given regexp.
-    if ( !matchData(command.wndre, m_data, mimeWindowTitle) )
-        return false;
-
-    return canExecuteCommandFilter(command.matchCmd);
+    return true;
 }
 
 bool Scriptable::canExecuteCommandFilter(const QString &matchCommand)
@@ -3234,6 +3395,61 @@ void Scriptable::insert(int row, int argumentsBegin, int argumentsEnd)
         throwError(error);
 }
 
+QScriptValue Scriptable::itemsData(const QVector<int> &rows, const QScriptValue &formats, const QScriptValue &callback)
+{
+    const bool streamItems = callback.isFunction();
+    if ( !streamItems && rows.size() > maxItemsPerArray ) {
+        throwError( QString("Cannot return more than %1 items at once").arg(maxItemsPerArray) );
+        return QScriptValue();
+    }
+
+    QStringList formatList;
+    if ( formats.isArray() )
+        formatList = fromScriptValue<QStringList>(formats, this);
+    else if ( !formats.isUndefined() )
+        formatList.append( toString(formats, this) );
+
+    QScriptValue array = engine()->newArray( static_cast<uint>(streamItems ? 0 : rows.size()) );
+    quint32 i = 0;
+    for (int j = 0; j < rows.size() && canContinue(); j += maxItemsPerCall) {
+        const auto items = m_proxy->browserItemsData(m_tabName, rows.mid(j, maxItemsPerCall), formatList);
+
+        // Pass each chunk to callback instead of keeping all items in memory.
+        if (streamItems) {
+            array = engine()->newArray( static_cast<uint>(items.size()) );
+            i = 0;
+        }
+
+        for (const auto &item : items)
+            array.setProperty( i++, toScriptValue(item, this) );
+
+        if (streamItems) {
+            callback.call( QScriptValue(), QScriptValueList() << array << rows[j] );
+            if ( engine()->hasUncaughtException() )
+                return QScriptValue();
+        }
+    }
+
+    return streamItems ? QScriptValue() : array;
+}
+
+bool Scriptable::toRows(const QScriptValue &value, QVector<int> *rows)
+{
+    if ( !value.isArray() )
+        return false;
+
+    const quint32 length = value.property("length").toUInt32();
+    rows->reserve( static_cast<int>(length) );
+    for ( quint32 i = 0; i < length; ++i ) {
+        int row;
+        if ( !toInt(value.property(i), &row) )
+            return false;
+        rows->append(row);
+    }
+
+    return true;
+}
+
 QStringList Scriptable::arguments()
 {
     QStringList args;
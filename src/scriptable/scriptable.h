@@ -22,6 +22,7 @@
 
 #include "common/clipboardmode.h"
 #include "common/command.h"
+#include "common/commandmatcher.h"
 #include "common/mimetypes.h"
 
 #include <QObject>
@@ -286,6 +287,10 @@ public slots:
     void setItem();
     void setitem() { setItem(); }
 
+    QScriptValue getItems();
+    QScriptValue readRange();
+    void replaceItems();
+
     QScriptValue toBase64();
     QScriptValue tobase64() { return toBase64(); }
     QScriptValue fromBase64();
@@ -369,6 +374,8 @@ public slots:
 
     void runMenuCommandFilters();
 
+    void runCallbacks();
+
     void monitorClipboard();
     void provideClipboard();
     void provideSelection();
@@ -386,6 +393,8 @@ private:
     void onMonitorClipboardUnchanged(const QVariantMap &data);
     void onSynchronizeSelection(ClipboardMode sourceMode, const QString &text, uint targetTextHash);
 
+    void runCallback(const QString &script, const QVariantMap &data);
+
     bool sourceScriptCommands();
     void callDisplayFunctions(QScriptValueList displayFunctions);
     QString processUncaughtException(const QString &cmd);
@@ -400,7 +409,6 @@ private:
     QTextCodec *codecFromNameOrThrow(const QScriptValue &codecName);
     bool runAction(Action *action);
     bool runCommands(CommandType::CommandType type);
-    bool canExecuteCommand(const Command &command);
     bool canExecuteCommandFilter(const QString &matchCommand);
     bool canAccessClipboard() const;
     bool verifyClipboardAccess();
@@ -409,6 +417,10 @@ private:
     void insert(int argumentsEnd);
     void insert(int row, int argumentsBegin, int argumentsEnd);
 
+    QScriptValue itemsData(const QVector<int> &rows, const QScriptValue &formats,
+                           const QScriptValue &callback = QScriptValue());
+    bool toRows(const QScriptValue &value, QVector<int> *rows);
+
     QStringList arguments();
 
     void print(const QByteArray &message);
@@ -454,6 +466,9 @@ private:
     bool m_failed = false;
 
     QString m_tabName;
+
+    CommandMatcher m_automaticCommandMatcher;
+    CommandMatcher m_displayCommandMatcher;
 };
 
 class NetworkReply final : public QObject {
@@ -88,6 +88,8 @@
 const quint32 serializedFunctionCallMagicNumber = 0x58746908;
 const quint32 serializedFunctionCallVersion = 2;
 
+const int maxQueuedFunctionCalls = 100;
+
 #define BROWSER(tabName, call) \
     ClipboardBrowser *c = fetchBrowser(tabName); \
     if (c) \
@@ -98,7 +100,7 @@ const quint32 serializedFunctionCallVersion = 2;
 #define INVOKE_(function, arguments, functionCallId) \
     static const auto f = FunctionCallSerializer(STR(#function)).withSlotArguments arguments; \
     const auto args = f.argumentList arguments; \
-    emit sendMessage(f.serialize(functionCallId, args), CommandFunctionCall)
+    sendFunctionCall(f.serialize(functionCallId, args), functionCallId)
 
 #define INVOKE_NO_SNIP(function, arguments) \
     if (!m_wnd) { \
@@ -117,6 +119,21 @@ const quint32 serializedFunctionCallVersion = 2;
         return; \
     }
 
+// Queue call without waiting for it to finish.
+// Queued calls are sent in batch before next blocking call or once control returns to event loop.
+#define INVOKE_ASYNC_NO_SNIP(FUNCTION, ARGUMENTS) \
+    if (!m_wnd) { \
+        static const auto f = FunctionCallSerializer(STR(#FUNCTION)).withSlotArguments ARGUMENTS; \
+        const auto args = f.argumentList ARGUMENTS; \
+        queueFunctionCall(f.serialize(++m_lastFunctionCallId, args)); \
+        return; \
+    }
+
+#define INVOKE_ASYNC(FUNCTION, ARGUMENTS) \
+    INVOKE_ASYNC_NO_SNIP(FUNCTION, ARGUMENTS) \
+    if (m_wnd) \
+        m_wnd->snip()
+
 #define INVOKE(FUNCTION, ARGUMENTS) \
     INVOKE_NO_SNIP(FUNCTION, ARGUMENTS) \
     if (m_wnd) \
@@ -834,6 +851,43 @@ void ScriptableProxy::callFunction(const QByteArray &serializedFunctionCall)
     t->start(0);
 }
 
+void ScriptableProxy::callFunctions(const QByteArray &serializedFunctionCalls)
+{
+    if (m_shouldBeDeleted)
+        return;
+
+    ++m_functionCallStack;
+    auto t = new QTimer(this);
+    t->setSingleShot(true);
+    QObject::connect( t, &QTimer::timeout, this, [=]() {
+        QDataStream stream(serializedFunctionCalls);
+        stream.setVersion(QDataStream::Qt_5_0);
+
+        int functionCallId;
+        QVector<QByteArray> functionCalls;
+        stream >> functionCallId >> functionCalls;
+        if (stream.status() != QDataStream::Ok) {
+            log("Failed to read scriptable proxy slot calls", LogError);
+            Q_ASSERT(false);
+        } else {
+            // Only the last call in batch can wait for return value.
+            QByteArray result;
+            for (const auto &functionCall : functionCalls)
+                result = callFunctionHelper(functionCall);
+
+            if (functionCallId != -1)
+                emit sendMessage(result, CommandFunctionCallReturnValue);
+        }
+
+        t->deleteLater();
+
+        --m_functionCallStack;
+        if (m_shouldBeDeleted && m_functionCallStack == 0)
+            deleteLater();
+    });
+    t->start(0);
+}
+
 QByteArray ScriptableProxy::callFunctionHelper(const QByteArray &serializedFunctionCall)
 {
     QVector<QVariant> arguments;
@@ -973,6 +1027,17 @@ void ScriptableProxy::setInputDialogResult(const QByteArray &bytes)
     emit inputDialogFinished(dialogId, result);
 }
 
+void ScriptableProxy::sendQueuedFunctionCalls()
+{
+    if ( m_queuedFunctionCalls.isEmpty() )
+        return;
+
+    // Last queued call has the greatest ID.
+    const auto functionCallId = m_lastFunctionCallId;
+    sendFunctionCalls(functionCallId);
+    waitForFunctionCallFinished(functionCallId);
+}
+
 void ScriptableProxy::safeDeleteLater()
 {
     m_shouldBeDeleted = true;
@@ -994,7 +1059,7 @@ QVariantMap ScriptableProxy::getActionData(int id)
 
 void ScriptableProxy::setActionData(int id, const QVariantMap &data)
 {
-    INVOKE_NO_SNIP2(setActionData, (id, data));
+    INVOKE_ASYNC_NO_SNIP(setActionData, (id, data));
     m_wnd->setActionData(id, data);
 }
 
@@ -1407,13 +1472,8 @@ QString ScriptableProxy::browserInsert(const QString &tabName, int row, const QV
     if (!c)
         return "Invalid tab";
 
-    if ( !c->allocateSpaceForNewItems(items.size()) )
-        return "Tab is full (cannot remove any items)";
-
-    for (const auto &item : items) {
-        if ( !c->add(item, row) )
-            return "Failed to new add items";
-    }
+    if ( !c->addItems(items, row) )
+        return "Failed to new add items";
 
     return QString();
 }
@@ -1449,6 +1509,51 @@ QVariantMap ScriptableProxy::browserItemData(const QString &tabName, int arg1)
     return itemData(tabName, arg1);
 }
 
+QVector<QVariantMap> ScriptableProxy::browserItemsData(const QString &tabName, const QVector<int> &rows, const QStringList &formats)
+{
+    INVOKE(browserItemsData, (tabName, rows, formats));
+
+    QVector<QVariantMap> items;
+    ClipboardBrowser *c = fetchBrowser(tabName);
+    if (!c)
+        return items;
+
+    items.reserve( rows.size() );
+    for (const int row : rows) {
+        QVariantMap data = c->copyIndex( c->index(row) );
+        if ( !formats.isEmpty() ) {
+            for (auto it = data.begin(); it != data.end(); ) {
+                if ( formats.contains(it.key()) )
+                    ++it;
+                else
+                    it = data.erase(it);
+            }
+        }
+        items.append(data);
+    }
+
+    return items;
+}
+
+bool ScriptableProxy::browserSetItemsData(const QString &tabName, const QVector<int> &rows, const QVector<QVariantMap> &items)
+{
+    INVOKE(browserSetItemsData, (tabName, rows, items));
+    ClipboardBrowser *c = fetchBrowser(tabName);
+    if (!c)
+        return false;
+
+    bool result = true;
+    const auto model = c->model();
+    const auto count = std::min( rows.size(), items.size() );
+    for ( int i = 0; i < count; ++i ) {
+        const auto index = c->index(rows[i]);
+        if ( !index.isValid() || !model->setData(index, items[i], contentType::data) )
+            result = false;
+    }
+
+    return result;
+}
+
 void ScriptableProxy::setCurrentTab(const QString &tabName)
 {
     INVOKE2(setCurrentTab, (tabName));
@@ -1636,7 +1741,7 @@ QString ScriptableProxy::testSelected()
 
 void ScriptableProxy::serverLog(const QString &text)
 {
-    INVOKE2(serverLog, (text));
+    INVOKE_ASYNC(serverLog, (text));
     log(text, LogAlways);
 }
 
@@ -1971,7 +2076,7 @@ void ScriptableProxy::setClipboardData(const QVariantMap &data)
 
 void ScriptableProxy::setTitle(const QString &title)
 {
-    INVOKE2(setTitle, (title));
+    INVOKE_ASYNC(setTitle, (title));
 
     const QString sessionName = qApp->property("CopyQ_session_name").toString();
     if (title.isEmpty()) {
@@ -2003,11 +2108,7 @@ void ScriptableProxy::saveData(const QString &tab, const QVariantMap &data, Clip
 {
     INVOKE2(saveData, (tab, data, mode));
 
-    auto c = m_wnd->tab(tab);
-    if (c) {
-        c->addUnique(data, mode);
-        c->setCurrent(0);
-    }
+    m_wnd->addUniqueToTab(tab, data, mode);
 }
 
 void ScriptableProxy::showDataNotification(const QVariantMap &data)
@@ -2082,6 +2183,20 @@ QVariantMap ScriptableProxy::setDisplayData(int actionId, const QVariantMap &dis
     return m_actionData;
 }
 
+void ScriptableProxy::runCallback(const QVariantMap &data, const QString &script)
+{
+    INVOKE_NO_SNIP2(runCallback, (data, script));
+    m_wnd->runCallback(script, data);
+}
+
+QByteArray ScriptableProxy::takeCallback(int actionId)
+{
+    INVOKE_NO_SNIP(takeCallback, (actionId));
+    const auto bytes = m_wnd->takeCallback(actionId);
+    m_actionData = m_wnd->actionData(actionId);
+    return bytes;
+}
+
 QVector<Command> ScriptableProxy::automaticCommands()
 {
     INVOKE_NO_SNIP(automaticCommands, ());
@@ -2186,6 +2301,43 @@ QList<QPersistentModelIndex> ScriptableProxy::selectedIndexes() const
             .value< QList<QPersistentModelIndex> >();
 }
 
+void ScriptableProxy::sendFunctionCall(const QByteArray &serializedFunctionCall, int functionCallId)
+{
+    if ( m_queuedFunctionCalls.isEmpty() ) {
+        emit sendMessage(serializedFunctionCall, CommandFunctionCall);
+    } else {
+        m_queuedFunctionCalls.append(serializedFunctionCall);
+        sendFunctionCalls(functionCallId);
+    }
+}
+
+void ScriptableProxy::queueFunctionCall(const QByteArray &serializedFunctionCall)
+{
+    if ( m_queuedFunctionCalls.isEmpty() ) {
+        QTimer::singleShot(0, this, [this]() {
+            if ( !m_queuedFunctionCalls.isEmpty() )
+                sendFunctionCalls(-1);
+        });
+    }
+
+    m_queuedFunctionCalls.append(serializedFunctionCall);
+
+    if (m_queuedFunctionCalls.size() >= maxQueuedFunctionCalls)
+        sendFunctionCalls(-1);
+}
+
+void ScriptableProxy::sendFunctionCalls(int functionCallId)
+{
+    QByteArray bytes;
+    {
+        QDataStream stream(&bytes, QIODevice::WriteOnly);
+        stream.setVersion(QDataStream::Qt_5_0);
+        stream << functionCallId << m_queuedFunctionCalls;
+    }
+    m_queuedFunctionCalls.clear();
+    emit sendMessage(bytes, CommandFunctionCalls);
+}
+
 QVariant ScriptableProxy::waitForFunctionCallFinished(int functionCallId)
 {
     QVariant result;
@@ -83,12 +83,16 @@ public:
     explicit ScriptableProxy(MainWindow* mainWindow, QObject *parent = nullptr);
 
     void callFunction(const QByteArray &serializedFunctionCall);
+    void callFunctions(const QByteArray &serializedFunctionCalls);
 
     int actionId() const { return m_actionId; }
 
     void setFunctionCallReturnValue(const QByteArray &bytes);
     void setInputDialogResult(const QByteArray &bytes);
 
+    /** Send calls queued by asynchronous slots and wait until they finish. */
+    void sendQueuedFunctionCalls();
+
     void safeDeleteLater();
 
 public slots:
@@ -167,6 +171,8 @@ public slots:
 
     QByteArray browserItemData(const QString &tabName, int arg1, const QString &arg2);
     QVariantMap browserItemData(const QString &tabName, int arg1);
+    QVector<QVariantMap> browserItemsData(const QString &tabName, const QVector<int> &rows, const QStringList &formats);
+    bool browserSetItemsData(const QString &tabName, const QVector<int> &rows, const QVector<QVariantMap> &items);
 
     void setCurrentTab(const QString &tabName);
 
@@ -236,6 +242,9 @@ public slots:
 
     QVariantMap setDisplayData(int actionId, const QVariantMap &displayData);
 
+    void runCallback(const QVariantMap &data, const QString &script);
+    QByteArray takeCallback(int actionId);
+
     QVector<Command> automaticCommands();
     QVector<Command> displayCommands();
     QVector<Command> scriptCommands();
@@ -259,6 +268,10 @@ private:
     ClipboardBrowser *currentBrowser() const;
     QList<QPersistentModelIndex> selectedIndexes() const;
 
+    void sendFunctionCall(const QByteArray &serializedFunctionCall, int functionCallId);
+    void queueFunctionCall(const QByteArray &serializedFunctionCall);
+    void sendFunctionCalls(int functionCallId);
+
     QVariant waitForFunctionCallFinished(int functionId);
 
     QByteArray callFunctionHelper(const QByteArray &serializedFunctionCall);
@@ -273,6 +286,7 @@ private:
     int m_actionId = -1;
 
     int m_lastFunctionCallId = -1;
+    QVector<QByteArray> m_queuedFunctionCalls;
     int m_lastInputDialogId = -1;
 
     int m_functionCallStack = 0;
@@ -83,6 +83,10 @@ do { \
     if ( qgetenv(ENV) == "1" ) \
         SKIP("Unset " ENV " to run the tests")
 
+#define SKIP_UNLESS_ENV(ENV) \
+    if ( qgetenv(ENV) != "1" ) \
+        SKIP("Set " ENV "=1 to run the tests")
+
 /// Interval to wait (in ms) before and after setting clipboard.
 const int waitMsSetClipboard = 1000;
 
@@ -24,6 +24,7 @@
 #include "common/client_server.h"
 #include "common/common.h"
 #include "common/config.h"
+#include "common/contenttype.h"
 #include "common/log.h"
 #include "common/mimetypes.h"
 #include "common/settings.h"
@@ -31,12 +32,15 @@
 #include "common/sleeptimer.h"
 #include "common/textdata.h"
 #include "common/version.h"
+#include "item/clipboarditem.h"
+#include "item/clipboardmodel.h"
 #include "item/itemfactory.h"
 #include "item/itemwidget.h"
 #include "item/serialize.h"
 #include "gui/tabicons.h"
 #include "platform/platformnativeinterface.h"
 
+#include <QBuffer>
 #include <QClipboard>
 #include <QDebug>
 #include <QDir>
@@ -44,10 +48,12 @@
 #include <QFile>
 #include <QFileInfo>
 #include <QGuiApplication>
+#include <QImage>
 #include <QMap>
 #include <QMimeData>
 #include <QProcess>
 #include <QRegExp>
+#include <QStandardItemModel>
 #include <QTemporaryDir>
 #include <QTemporaryFile>
 #include <QTest>
@@ -703,6 +709,22 @@ QStringList splitLines(const QString &nativeText)
     return nativeText.split(QRegExp("\r\n|\n|\r"));
 }
 
+void addItemCountBenchmarkRows()
+{
+    QTest::addColumn<int>("itemCount");
+    for (int itemCount : {1000, 10000, 100000})
+        QTest::newRow( QByteArray::number(itemCount) ) << itemCount;
+}
+
+QVector<QVariantMap> createItemDataList(int itemCount)
+{
+    QVector<QVariantMap> dataList;
+    dataList.reserve(itemCount);
+    for (int i = 0; i < itemCount; ++i)
+        dataList.append( createDataMap(mimeText, QString::number(i)) );
+    return dataList;
+}
+
 } // namespace
 
 Tests::Tests(const TestInterfacePtr &test, QObject *parent)
@@ -1197,6 +1219,41 @@ void Tests::commandsGetSetItem()
     RUN(args << "eval" << "print(getitem(1)['text/html'])", "<b>HTML text 2</b>");
 }
 
+void Tests::commandsGetSetItems()
+{
+    const QString tab = testTab(1);
+    const Args args = Args("tab") << tab;
+
+    RUN(args << "add" << "C" << "B" << "A", "");
+    RUN(args << "change" << "1" << "text/html" << "<b>B</b>", "");
+
+    RUN(args << "eval" << "print(getItems([2, 0]).map(function(item) { return str(item[mimeText]) }))", "C,A");
+    RUN(args << "eval" << "print(readRange(0).length)", "3");
+    RUN(args << "eval" << "print(readRange(1, 1).map(function(item) { return str(item[mimeText]) }))", "B");
+    RUN(args << "eval" << "print(readRange(3).length)", "0");
+    RUN_EXPECT_ERROR_WITH_STDERR(
+        args << "eval" << "var rows = []; for (var i = 0; i <= 10000; ++i) rows.push(0); getItems(rows)",
+        CommandException, "Cannot return more than 10000 items at once");
+
+    // Filter formats.
+    RUN(args << "eval" << "print(Object.keys(readRange(1, 1, mimeHtml)[0]))", "text/html");
+    RUN(args << "eval" << "print(Object.keys(getItems([1], [mimeText])[0]))", "text/plain");
+
+    RUN(args << "eval" << "replaceItems([0, 2], [{'text/plain': 'X'}, {'text/plain': 'Z'}])", "");
+    RUN(args << "read" << "0" << "1" << "2", "X\nB\nZ");
+
+    RUN_EXPECT_ERROR_WITH_STDERR(
+        args << "eval" << "replaceItems([0], [])",
+        CommandException, "Number of rows and items must be the same");
+
+    // Stream items in chunks to callback.
+    RUN(args << "eval" << "var items = []; for (var i = 0; i < 2500; ++i) items.push(i); add.apply(this, items)", "");
+    RUN(args << "eval" << "readRange(1, function(items, row) { print(items.length + '@' + row + ',') })",
+        "1000@1,1000@1001,502@2001,");
+    RUN(args << "eval" << "readRange(2500, 10, mimeText, function(items) { print(items.map(function(item) { return str(item[mimeText]) })) })",
+        "X,B,Z");
+}
+
 void Tests::commandsChecksums()
 {
     RUN("md5sum" << "TEST", "033bd94b1168d7e4f0d644c3c95e35bf\n");
@@ -1426,6 +1483,33 @@ void Tests::commandsExportImport()
     RUN("tab" << tab2 << "read" << "0", "1");
 }
 
+void Tests::commandsExportImportManyItems()
+{
+    const auto tab = testTab(1);
+    const auto args = Args("tab") << tab;
+    RUN("config" << "maxitems" << "1000", "1000\n");
+    RUN(args << "for (i = 0; i < 500; ++i) add(i)", "");
+    RUN(args << "size", "500\n");
+
+    QTemporaryFile tmp;
+    QVERIFY(tmp.open());
+    tmp.close();
+    const auto fileName = tmp.fileName();
+
+    RUN("exportData" << fileName, "");
+    RUN("removetab" << tab, "");
+    RUN("config" << "maxitems" << "100", "100\n");
+
+    // Items are imported in batches before the configuration is imported,
+    // so no batch must be limited by the current lower "maxitems" value.
+    RUN("importData" << fileName, "");
+
+    RUN("config" << "maxitems", "1000\n");
+    RUN(args << "size", "500\n");
+    RUN(args << "read" << "0" << "1" << "499", "499\n498\n0");
+    RUN(args << "read" << "99" << "100" << "399" << "400", "400\n399\n100\n99");
+}
+
 void Tests::commandsGetSetCommands()
 {
     RUN("commands().length", "0\n");
@@ -1668,6 +1752,15 @@ void Tests::commandServerLogAndLogs()
     QVERIFY2( testStderr(stderrActual), stderrActual );
     QVERIFY( !stdoutActual.isEmpty() );
     QVERIFY( QString::fromUtf8(stdoutActual).contains(re) );
+
+    // Asynchronous calls are sent in batches.
+    const QString data2 = QString::fromUtf8(generateData());
+    RUN("for (i = 0; i < 250; ++i) serverLog('" + data2 + " ' + i)", "");
+
+    QCOMPARE( run(Args("logs"), &stdoutActual, &stderrActual), 0 );
+    QVERIFY2( testStderr(stderrActual), stderrActual );
+    QVERIFY( QString::fromUtf8(stdoutActual).contains(data2 + " 100") );
+    QVERIFY( QString::fromUtf8(stdoutActual).contains(data2 + " 249") );
 }
 
 void Tests::classByteArray()
@@ -2053,6 +2146,45 @@ void Tests::searchItemsAndSelect()
     RUN("testSelected", QString(clipboardTabName) + " 3 3\n");
 }
 
+void Tests::searchItemsUsingIndex()
+{
+    const auto tab = QString(clipboardTabName);
+    RUN("add" << "first item" << "other" << "second item", "");
+
+    RUN("filter" << "item", "");
+    RUN("keys" << "CTRL+A", "");
+    RUN("testSelected", tab + " 0 0 2\n");
+
+    // Search index is updated when items change.
+    RUN("filter" << "", "");
+    RUN("change" << "1" << "text/plain" << "item three", "");
+    RUN("add" << "new item", "");
+    RUN("remove" << "3", "");
+
+    RUN("filter" << "item", "");
+    RUN("keys" << "CTRL+A", "");
+    RUN("testSelected", tab + " 0 0 1 2\n");
+
+    RUN("filter" << "sec item", "");
+    RUN("testSelected", tab + " 1 1\n");
+}
+
+void Tests::searchManyItems()
+{
+    // Rows past the first ones are filtered in background.
+    const auto tab = QString(clipboardTabName);
+    RUN("add" << "needle", "");
+    const auto script = QString(
+            "var items = [];"
+            "for (var i = 0; i < 1500; ++i) items.push('item ' + i);"
+            "add.apply(this, items)");
+    RUN("eval" << script, "");
+    RUN("size", "1501\n");
+
+    RUN("filter" << "needle", "");
+    WAIT_ON_OUTPUT("testSelected", tab + " 1500 1500\n");
+}
+
 void Tests::searchRowNumber()
 {
     RUN("add" << "d2" << "c" << "b2" << "a", "");
@@ -2193,6 +2325,20 @@ void Tests::clipboardToItem()
     WAIT_ON_OUTPUT("read" << "0", bytes);
 }
 
+void Tests::clipboardToExistingItem()
+{
+    TEST( m_test->setClipboard("FIRST") );
+    WAIT_ON_OUTPUT("read" << "0", "FIRST");
+    TEST( m_test->setClipboard("SECOND") );
+    WAIT_ON_OUTPUT("read" << "0", "SECOND");
+
+    // Existing item is moved to top instead of adding new one.
+    TEST( m_test->setClipboard("FIRST") );
+    WAIT_ON_OUTPUT("read" << "0", "FIRST");
+    RUN("read" << "0" << "1", "FIRST\nSECOND");
+    RUN("size", "2\n");
+}
+
 void Tests::itemToClipboard()
 {
     RUN("add" << "TESTING2" << "TESTING1", "");
@@ -2241,6 +2387,435 @@ void Tests::tabAdd()
     RUN(args << "read" << "0" << "1" << "2", "abc def ghi");
 }
 
+void Tests::tabSaveChanges()
+{
+    const QString tab = testTab(1);
+    const Args args = Args("tab") << tab << "separator" << " ";
+
+    RUN(args << "add" << "ghi" << "def" << "abc", "");
+
+    // Restart server.
+    TEST( m_test->stopServer() );
+    TEST( m_test->startServer() );
+
+    RUN(args << "read" << "0" << "1" << "2", "abc def ghi");
+
+    RUN(args << "remove" << "1", "");
+    RUN(args << "insert" << "1" << "xyz", "");
+    RUN(args << "change" << "0" << "text/plain" << "ABC", "");
+    RUN(args << "add" << "jkl", "");
+
+    // Restart server.
+    TEST( m_test->stopServer() );
+    TEST( m_test->startServer() );
+
+    RUN(args << "size", "4\n");
+    RUN(args << "read" << "0" << "1" << "2" << "3", "jkl ABC xyz ghi");
+}
+
+void Tests::tabSaveLargeItems()
+{
+    const QString tab = testTab(1);
+    const Args args = Args("tab") << tab;
+
+    // Data large enough to be kept only in mapped tab file after loading.
+    const QByteArray data = generateData() + QByteArray(10000, 'x');
+    RUN(args << "write" << "0" << "text/plain" << "abc" << "test/large" << data, "");
+
+    // Restart server.
+    TEST( m_test->stopServer() );
+    TEST( m_test->startServer() );
+
+    RUN(args << "read" << "test/large" << "0", data);
+    RUN(args << "change" << "0" << "text/plain" << "ABC", "");
+
+    // Restart server.
+    TEST( m_test->stopServer() );
+    TEST( m_test->startServer() );
+
+    RUN(args << "read" << "text/plain" << "0", "ABC");
+    RUN(args << "read" << "test/large" << "0", data);
+}
+
+void Tests::tabItemsCompression()
+{
+    // Synthetic items with formats that should be compressed and some that shouldn't.
+    QStandardItemModel model(0, 1);
+    qint64 dataSize = 0;
+    quint32 seed = 1;
+    for (int row = 0; row < 100; ++row) {
+        const QByteArray text = "Item " + QByteArray::number(row) + ": "
+                + QByteArray(1000, static_cast<char>('a' + row % 26));
+
+        QByteArray randomBytes(20000, '\0');
+        for (auto &c : randomBytes) {
+            seed = seed * 1103515245 + 12345;
+            c = static_cast<char>(seed >> 16);
+        }
+
+        QVariantMap data;
+        data.insert(mimeText, text);
+        data.insert(mimeHtml, "<html><body><p>" + text.repeated(10) + "</p></body></html>");
+        data.insert("image/bmp", QByteArray(50000, static_cast<char>(row)));
+        data.insert("image/png", randomBytes);
+        for (const auto &value : data)
+            dataSize += value.toByteArray().size();
+
+        model.insertRow(row);
+        model.setData(model.index(row, 0), data, contentType::data);
+    }
+
+    QBuffer file;
+    QVERIFY( file.open(QIODevice::ReadWrite) );
+
+    QVERIFY( serializeData(model, &file) );
+
+    QStandardItemModel model2(0, 1);
+    QVERIFY( file.seek(0) );
+    QVERIFY( deserializeData(&model2, &file, model.rowCount()) );
+
+    QCOMPARE( model2.rowCount(), model.rowCount() );
+    for (int row = 0; row < model.rowCount(); ++row) {
+        QCOMPARE( model2.index(row, 0).data(contentType::data).toMap(),
+                  model.index(row, 0).data(contentType::data).toMap() );
+    }
+
+    // Only random PNG data should stay uncompressed.
+    QVERIFY( file.size() < dataSize / 2 );
+}
+
+void Tests::tabSharedItemData()
+{
+    const Args args1 = Args("tab") << testTab(1);
+    const Args args2 = Args("tab") << testTab(2);
+
+    // Same data in multiple tabs are kept in memory only once.
+    const QByteArray data = generateData() + QByteArray(2000, 'x');
+    RUN(args1 << "write" << "test/data" << data, "");
+    RUN(args2 << "write" << "test/data" << data, "");
+
+    RUN(args1 << "change" << "0" << "test/data" << "changed", "");
+    RUN(args1 << "read" << "test/data" << "0", "changed");
+    RUN(args2 << "read" << "test/data" << "0", data);
+
+    RUN(args1 << "remove" << "0", "");
+    RUN(args2 << "read" << "test/data" << "0", data);
+
+    // Items in different tabs (models) share the same memory.
+    const QString format = "test/data";
+    const auto itemData = [&](const ClipboardModel &model) {
+        return model.index(0).data(contentType::data).toMap().value(format).toByteArray();
+    };
+    QByteArray data1 = data;
+    data1.detach();
+    QByteArray data2 = data;
+    data2.detach();
+
+    ClipboardModel model1;
+    ClipboardModel model2;
+    model1.insertItem( createDataMap(format, data1), 0 );
+    model2.insertItem( createDataMap(format, data2), 0 );
+    QCOMPARE( itemData(model1).constData(), data1.constData() );
+    QCOMPARE( itemData(model2).constData(), data1.constData() );
+
+    // Data still used by other tab are kept.
+    QVERIFY( model1.removeRows(0, 1) );
+    data1.clear();
+    model1.insertItem( createDataMap(format, data2), 0 );
+    QCOMPARE( itemData(model1).constData(), itemData(model2).constData() );
+
+    // Data not used by any item are released after removing the items.
+    QVERIFY( model1.removeRows(0, 1) );
+    QVERIFY( model2.removeRows(0, 1) );
+    model1.insertItem( createDataMap(format, data2), 0 );
+    QCOMPARE( itemData(model1).constData(), data2.constData() );
+}
+
+void Tests::tabSharedItemDataReleased()
+{
+    const QString format = "test/data";
+    const QByteArray data = generateData() + QByteArray(2000, 'x');
+
+    // Equal data in different items share the same memory.
+    QByteArray data1 = data;
+    data1.detach();
+    QByteArray data2 = data;
+    data2.detach();
+    QVERIFY( data1.constData() != data2.constData() );
+
+    QVariantMap map1;
+    map1.insert(format, data1);
+    QVariantMap map2;
+    map2.insert(format, data2);
+
+    {
+        ClipboardItem item1(map1);
+        ClipboardItem item2(map2);
+        QCOMPARE( item1.data(format).constData(), data1.constData() );
+        QCOMPARE( item2.data(format).constData(), data1.constData() );
+    }
+
+    // Data not used by any item are released.
+    map1.clear();
+    data1.clear();
+    releaseUnusedItemData();
+
+    ClipboardItem item3(map2);
+    QCOMPARE( item3.data(format).constData(), data2.constData() );
+}
+
+void Tests::tabFindItemByHash()
+{
+    ClipboardModel model;
+    QVector<QVariantMap> dataList;
+    for (int i = 0; i < 10; ++i)
+        dataList.append( createDataMap(mimeText, QString::number(i)) );
+    model.insertItems(dataList, 0);
+
+    const auto hash = [&](int row) {
+        return model.index(row, 0).data(contentType::hash).toULongLong();
+    };
+    const quint64 hash2 = hash(2);
+    const quint64 hash5 = hash(5);
+    const quint64 hash9 = hash(9);
+    QCOMPARE( model.findItem(hash5), 5 );
+
+    // Move to top.
+    QVERIFY( model.moveRows(QModelIndex(), 5, 1, QModelIndex(), 0) );
+    QCOMPARE( model.findItem(hash5), 0 );
+    QCOMPARE( model.findItem(hash2), 3 );
+    QCOMPARE( model.findItem(hash9), 9 );
+
+    // Trim bottom.
+    QVERIFY( model.removeRows(9, 1) );
+    QCOMPARE( model.findItem(hash9), -1 );
+    QCOMPARE( model.findItem(hash2), 3 );
+
+    // Remove and insert in the middle.
+    QVERIFY( model.removeRows(1, 2) );
+    QCOMPARE( model.findItem(hash2), 1 );
+    model.insertItem( createDataMap(mimeText, QString("X")), 1 );
+    QCOMPARE( model.findItem(hash2), 2 );
+    QCOMPARE( model.findItem(hash5), 0 );
+
+    // Equal items.
+    model.insertItem( createDataMap(mimeText, QString("2")), 6 );
+    QCOMPARE( model.findItem(hash2), 2 );
+    QVERIFY( model.removeRows(2, 1) );
+    QCOMPARE( model.findItem(hash2), 5 );
+
+    // Top-most of equal items is returned.
+    model.insertItem( createDataMap(mimeText, QString("2")), 7 );
+    QCOMPARE( model.findItem(hash2), 5 );
+    QVERIFY( model.moveRows(QModelIndex(), 7, 1, QModelIndex(), 0) );
+    QCOMPARE( model.findItem(hash2), 0 );
+    QVERIFY( model.setData(model.index(3), createDataMap(mimeText, QString("2")), contentType::data) );
+    QCOMPARE( model.findItem(hash2), 0 );
+    QVERIFY( model.removeRows(0, 1) );
+    QCOMPARE( model.findItem(hash2), 2 );
+}
+
+void Tests::tabInsertItemsBenchmark_data()
+{
+    SKIP_UNLESS_ENV("COPYQ_TESTS_BENCHMARK");
+    addItemCountBenchmarkRows();
+}
+
+void Tests::tabInsertItemsBenchmark()
+{
+    QFETCH(int, itemCount);
+    ClipboardModel model;
+    model.insertItems( createItemDataList(itemCount), 0 );
+    const QVariantMap data = createDataMap(mimeText, QString("NEW"));
+
+    QBENCHMARK {
+        model.insertItem(data, 0);
+    }
+
+    QVERIFY( model.rowCount() > itemCount );
+}
+
+void Tests::tabMoveItemsBenchmark_data()
+{
+    SKIP_UNLESS_ENV("COPYQ_TESTS_BENCHMARK");
+    addItemCountBenchmarkRows();
+}
+
+void Tests::tabMoveItemsBenchmark()
+{
+    QFETCH(int, itemCount);
+    ClipboardModel model;
+    model.insertItems( createItemDataList(itemCount), 0 );
+
+    QBENCHMARK {
+        QVERIFY( model.moveRows(QModelIndex(), itemCount - 1, 1, QModelIndex(), 0) );
+    }
+
+    QCOMPARE( model.rowCount(), itemCount );
+}
+
+void Tests::tabRemoveItemsBenchmark_data()
+{
+    SKIP_UNLESS_ENV("COPYQ_TESTS_BENCHMARK");
+    addItemCountBenchmarkRows();
+}
+
+void Tests::tabRemoveItemsBenchmark()
+{
+    QFETCH(int, itemCount);
+    ClipboardModel model;
+    model.insertItems( createItemDataList(itemCount), 0 );
+
+    // Removed range is inserted back so each iteration starts with same number of items.
+    const int rangeSize = itemCount / 10;
+    const QVector<QVariantMap> range = createItemDataList(rangeSize);
+    QBENCHMARK {
+        QVERIFY( model.removeRows(itemCount / 2, rangeSize) );
+        model.insertItems(range, itemCount / 2);
+    }
+
+    QCOMPARE( model.rowCount(), itemCount );
+}
+
+void Tests::tabScanItemsBenchmark_data()
+{
+    SKIP_UNLESS_ENV("COPYQ_TESTS_BENCHMARK");
+    addItemCountBenchmarkRows();
+}
+
+void Tests::tabScanItemsBenchmark()
+{
+    QFETCH(int, itemCount);
+    ClipboardModel model;
+    model.insertItems( createItemDataList(itemCount), 0 );
+
+    int textItemCount = 0;
+    QBENCHMARK {
+        textItemCount = 0;
+        for (int row = 0; row < model.rowCount(); ++row) {
+            const QVariantMap data = model.index(row).data(contentType::data).toMap();
+            if ( data.contains(mimeText) )
+                ++textItemCount;
+        }
+    }
+
+    QCOMPARE( textItemCount, itemCount );
+}
+
+void Tests::tabLargeRichTextItems()
+{
+    const QString tab = testTab(1);
+    const Args args = Args("tab") << tab;
+
+    // Rich text large enough to be rendered in background.
+    const QByteArray html =
+            "<html><body>" + QByteArray("<p><b>TEST</b></p>").repeated(1000) + "</body></html>";
+    for (int i = 0; i < 20; ++i)
+        RUN(args << "write" << "text/html" << html, "");
+
+    RUN("show" << tab, "");
+
+    // Exit while items can still be rendered.
+    TEST( m_test->stopServer() );
+    TEST( m_test->startServer() );
+
+    RUN(args << "size", "20\n");
+    RUN(args << "read" << "text/html" << "0", html);
+}
+
+void Tests::tabImageItems()
+{
+    const QString tab = testTab(1);
+    const Args args = Args("tab") << tab;
+
+    QImage image(800, 600, QImage::Format_RGB32);
+    image.fill(Qt::red);
+    QByteArray png;
+    {
+        QBuffer buffer(&png);
+        QVERIFY( buffer.open(QIODevice::WriteOnly) );
+        QVERIFY( image.save(&buffer, "PNG") );
+    }
+
+    for (int i = 0; i < 20; ++i)
+        RUN(args << "write" << "image/png" << png, "");
+
+    RUN("show" << tab, "");
+
+    // Exit while thumbnails can still be loaded.
+    TEST( m_test->stopServer() );
+    TEST( m_test->startServer() );
+
+    RUN(args << "size", "20\n");
+    RUN(args << "read" << "image/png" << "0", png);
+}
+
+void Tests::tabImageItemsCached()
+{
+    const QString tab = testTab(1);
+    const Args args = Args("tab") << tab;
+
+    for (const auto color : {Qt::red, Qt::green, Qt::blue}) {
+        QImage image(800, 600, QImage::Format_RGB32);
+        image.fill(color);
+        QByteArray png;
+        QBuffer buffer(&png);
+        QVERIFY( buffer.open(QIODevice::WriteOnly) );
+        QVERIFY( image.save(&buffer, "PNG") );
+        RUN(args << "write" << "image/png" << png, "");
+    }
+
+    const QString marker = "TEST: tabImageItemsCached";
+    const auto loadedThumbnailCount = [&]() {
+        const QStringList lines = splitLines( readLogFile(maxReadLogSize) );
+        const int markerLine = lines.lastIndexOf( QRegExp(".*" + marker + "$") );
+        return count( lines.mid(markerLine), ".*ItemImage: Loading thumbnail .*" );
+    };
+
+    RUN("serverLog" << marker, "");
+    RUN("show" << tab, "");
+    QTRY_COMPARE( loadedThumbnailCount(), 3 );
+
+    // Thumbnails are not loaded again when the item widgets are recreated.
+    RUN("show" << clipboardTabName, "");
+    RUN("unload" << tab, tab + "\n");
+    RUN("show" << tab, "");
+    RUN(args << "size", "3\n");
+    waitFor(1000);
+    QCOMPARE( loadedThumbnailCount(), 3 );
+}
+
+void Tests::tabPaintItemsFromSnapshots()
+{
+    const QString tab = testTab(1);
+    const Args args = Args("tab") << tab;
+
+    RUN(args << "eval" << "for (var i = 0; i < 200; ++i) add(i)", "");
+
+    const auto snapshotCount = [&](const QString &marker) {
+        const QStringList lines = splitLines( readLogFile(maxReadLogSize) );
+        const int markerLine = lines.lastIndexOf( QRegExp(".*" + marker + "$") );
+        return count( lines.mid(markerLine), ".*Item \\d+: Painting from snapshot$" );
+    };
+
+    RUN("config" << "paint_items_from_snapshots" << "true", "true\n");
+    const QString markerEnabled = "TEST: tabPaintItemsFromSnapshots enabled";
+    RUN("serverLog" << markerEnabled, "");
+    RUN("show" << tab, "");
+    RUN("keys" << "END" << "HOME", "");
+    QTRY_VERIFY( snapshotCount(markerEnabled) > 0 );
+
+    // No snapshots are used after the option is disabled.
+    RUN("config" << "paint_items_from_snapshots" << "false", "false\n");
+    const QString markerDisabled = "TEST: tabPaintItemsFromSnapshots disabled";
+    RUN("serverLog" << markerDisabled, "");
+    RUN("show" << tab, "");
+    RUN("keys" << "END" << "HOME", "");
+    RUN("testSelected", tab + " 0 0\n");
+    waitFor(1000);
+    QCOMPARE( snapshotCount(markerDisabled), 0 );
+}
+
 void Tests::tabRemove()
 {
     const QString tab = testTab(1);
@@ -2294,6 +2869,22 @@ void Tests::action()
     RUN(args << "read" << "0" << "1" << "2", "C\nB\nA");
 }
 
+void Tests::actionManyOutputItems()
+{
+    const Args args = Args("tab") << testTab(1);
+    const Args argsAction = Args(args) << "action";
+    const QString action = QString("copyq %1 %2").arg(args.join(" "));
+
+    // action printing many items, these are added to tab in batches
+    RUN(argsAction << action.arg("eval 'for (var i = 0; i < 150; ++i) print(i + \",\")'") << ",", "");
+    WAIT_ON_OUTPUT(args << "size", "150\n");
+    RUN(args << "separator" << "," << "read" << "0" << "1" << "148" << "149", "149,148,1,0");
+
+    // insert multiple items to a row
+    RUN(args << "insert" << "1" << "A" << "B", "");
+    RUN(args << "separator" << "," << "read" << "0" << "1" << "2" << "3", "149,B,A,148");
+}
+
 void Tests::insertRemoveItems()
 {
     const Args args = Args("tab") << testTab(1) << "separator" << ",";
@@ -2347,6 +2938,26 @@ void Tests::renameTab()
     QVERIFY( !hasTab(tab2) );
 }
 
+void Tests::renameTabWithPendingItems()
+{
+    const QString tab1 = testTab(1);
+    const QString tab2 = testTab(2);
+
+    // New tab is not loaded and has only pending items.
+    const auto script = R"(
+        setCommands([{automatic: true, tab: ')" + tab1 + R"('}])
+        )";
+    RUN(script, "");
+    TEST( m_test->setClipboard("TEST1") );
+    WAIT_ON_OUTPUT("tab" << QString(clipboardTabName) << "read" << "0", "TEST1");
+    QTRY_VERIFY( hasTab(tab1) );
+
+    RUN("renametab" << tab1 << tab2, "");
+    QVERIFY( !hasTab(tab1) );
+    RUN("tab" << tab2 << "read" << "0", "TEST1");
+    RUN("tab" << tab2 << "size", "1\n");
+}
+
 void Tests::importExportTab()
 {
     const QString tab = testTab(1);
@@ -2853,6 +3464,45 @@ void Tests::shortcutCommandMatchCmd()
     WAIT_ON_OUTPUT(args << "keys('Ctrl+F1'); read(0)", "test2");
 }
 
+void Tests::shortcutCommandMatchCmdOutsideState()
+{
+    const auto tab = testTab(1);
+    const Args args = Args("tab") << tab;
+
+    // Filter result doesn't depend only on item data.
+    const auto script = R"(
+        settings('matchTest', 'off')
+        setCommands([{
+            name: 'test',
+            inMenu: true,
+            shortcuts: ['Ctrl+F1'],
+            matchCmd: 'copyq: str(settings("matchTest")) == "on" || fail()',
+            cmd: 'copyq tab )" + tab + R"( add test'
+        }])
+        )";
+    RUN(script, "");
+
+    RUN("add" << "B" << "A", "");
+    RUN("keys" << clipboardBrowserId << "CTRL+F1", "");
+    waitFor(waitMsPasteClipboard);
+    RUN(args << "size", "0\n");
+
+    // Filter result is cached while the selected item doesn't change.
+    RUN("settings" << "matchTest" << "on", "");
+    RUN("keys" << clipboardBrowserId << "CTRL+F1", "");
+    waitFor(waitMsPasteClipboard);
+    RUN(args << "size", "0\n");
+
+    // Showing item menu doesn't run the filters again.
+    RUN("keys" << clipboardBrowserId << "SHIFT+F10" << "focus::QMenu" << "ESCAPE", "");
+    RUN("keys" << clipboardBrowserId, "");
+    RUN(args << "size", "0\n");
+
+    // Filter runs again after selecting other item.
+    RUN("selectItems" << "1", "true\n");
+    WAIT_ON_OUTPUT(args << "keys('Ctrl+F1'); read(0)", "test");
+}
+
 void Tests::shortcutCommandSelectedItemData()
 {
     const auto tab1 = testTab(1);
@@ -3027,6 +3677,24 @@ void Tests::automaticCommandRegExp()
     RUN("read" << "0", "SHOULD NOT BE CHANGED");
 }
 
+void Tests::automaticCommandRegExpAfterChange()
+{
+    // Commands are matched again after data changes.
+    const auto script = R"(
+        setCommands([
+            { automatic: true, re: '^A$', cmd: 'copyq: setData("text/plain", "B")' },
+            { automatic: true, re: '^A$', cmd: 'copyq: setData("DATA1", "WRONG")' },
+            { automatic: true, re: '^B$', cmd: 'copyq: setData("DATA2", "OK")' },
+        ])
+        )";
+    RUN(script, "");
+
+    TEST( m_test->setClipboard("A") );
+    WAIT_ON_OUTPUT("read" << "DATA2" << "0", "OK");
+    RUN("read" << "0", "B");
+    RUN("read" << "DATA1" << "0", "");
+}
+
 void Tests::automaticCommandSetData()
 {
     const auto script = R"(
@@ -3087,6 +3755,28 @@ void Tests::automaticCommandCopyToTab()
     RUN("tab" << tab1 << "read" << "0", "TEST");
 }
 
+void Tests::automaticCommandCopyToUnloadedTab()
+{
+    const auto tab1 = testTab(1);
+    const auto script = R"(
+        setCommands([{automatic: true, tab: ')" + tab1 + R"('}])
+        )";
+    RUN(script, "");
+
+    RUN("tab" << tab1 << "add" << "A", "");
+    RUN("unload" << tab1, tab1 + "\n");
+
+    TEST( m_test->setClipboard("TEST1") );
+    WAIT_ON_OUTPUT("tab" << QString(clipboardTabName) << "read" << "0", "TEST1");
+    TEST( m_test->setClipboard("TEST2") );
+    WAIT_ON_OUTPUT("tab" << QString(clipboardTabName) << "read" << "0", "TEST2");
+    TEST( m_test->setClipboard("A") );
+    WAIT_ON_OUTPUT("tab" << QString(clipboardTabName) << "read" << "0", "A");
+
+    RUN("tab" << tab1 << "separator" << "," << "read" << "0" << "1" << "2" << "3", "A,TEST2,TEST1,");
+    RUN("tab" << tab1 << "size", "3\n");
+}
+
 void Tests::automaticCommandStoreSpecialFormat()
 {
     const auto script = R"(
@@ -84,6 +84,7 @@ private slots:
     void commandsPackUnpack();
     void commandsBase64();
     void commandsGetSetItem();
+    void commandsGetSetItems();
 
     void commandsChecksums();
 
@@ -112,6 +113,7 @@ private slots:
     void commandSelectItems();
 
     void commandsExportImport();
+    void commandsExportImportManyItems();
 
     void commandsGetSetCommands();
 
@@ -161,6 +163,8 @@ private slots:
     void deleteItems();
     void searchItems();
     void searchItemsAndSelect();
+    void searchItemsUsingIndex();
+    void searchManyItems();
     void searchRowNumber();
     void copyItems();
 
@@ -175,13 +179,34 @@ private slots:
     void toggleClipboardMonitoring();
 
     void clipboardToItem();
+    void clipboardToExistingItem();
     void itemToClipboard();
     void tabAdd();
+    void tabSaveChanges();
+    void tabSaveLargeItems();
+    void tabItemsCompression();
+    void tabSharedItemData();
+    void tabSharedItemDataReleased();
+    void tabFindItemByHash();
+    void tabInsertItemsBenchmark_data();
+    void tabInsertItemsBenchmark();
+    void tabMoveItemsBenchmark_data();
+    void tabMoveItemsBenchmark();
+    void tabRemoveItemsBenchmark_data();
+    void tabRemoveItemsBenchmark();
+    void tabScanItemsBenchmark_data();
+    void tabScanItemsBenchmark();
+    void tabLargeRichTextItems();
+    void tabImageItems();
+    void tabImageItemsCached();
+    void tabPaintItemsFromSnapshots();
     void tabRemove();
     void tabIcon();
     void action();
+    void actionManyOutputItems();
     void insertRemoveItems();
     void renameTab();
+    void renameTabWithPendingItems();
     void importExportTab();
 
     void removeAllFoundItems();
@@ -215,6 +240,7 @@ private slots:
     void shortcutCommandOverrideEnter();
     void shortcutCommandMatchInput();
     void shortcutCommandMatchCmd();
+    void shortcutCommandMatchCmdOutsideState();
 
     void shortcutCommandSelectedItemData();
     void shortcutCommandSetSelectedItemData();
@@ -226,11 +252,13 @@ private slots:
     void automaticCommandRemove();
     void automaticCommandInput();
     void automaticCommandRegExp();
+    void automaticCommandRegExpAfterChange();
     void automaticCommandSetData();
     void automaticCommandOutputTab();
     void automaticCommandNoOutputTab();
     void automaticCommandChaining();
     void automaticCommandCopyToTab();
+    void automaticCommandCopyToUnloadedTab();
     void automaticCommandStoreSpecialFormat();
     void automaticCommandIgnoreSpecialFormat();
 